@@ -120,6 +120,7 @@ interfaces/api/storage/IMapManager.h \
 interfaces/api/storage/IMasks2DManager.h \
 interfaces/api/tracking/IOpticalFlowEstimator.h \
 interfaces/core/Log.h \
+interfaces/core/ThreadPool.h \
 interfaces/core/Timer.h \
 interfaces/core/Messages.h \
 interfaces/core/SerializationDefinitions.h \
@@ -130,36 +131,49 @@ interfaces/datastructure/CameraDefinitions.h \
 interfaces/datastructure/CameraParametersCollection.h \
 interfaces/datastructure/CloudPoint.h \
 interfaces/datastructure/CoordinateSystem.h \
+interfaces/datastructure/CopyOnWrite.h \
 interfaces/datastructure/DescriptorBuffer.h \
+interfaces/datastructure/DescriptorDistance.h \
+interfaces/datastructure/DescriptorIndex.h \
 interfaces/datastructure/DescriptorMatch.h \
 interfaces/datastructure/FiducialMarker.h \
 interfaces/datastructure/QRCode.h \
 interfaces/datastructure/Frame.h \
+interfaces/datastructure/FramePool.h \
 interfaces/datastructure/GeometryDefinitions.h \
 interfaces/datastructure/GlobalDescriptor.h \
 interfaces/datastructure/Identification.h \
 interfaces/datastructure/Image.h \
+interfaces/datastructure/ImageBufferPool.h \
+interfaces/datastructure/ImageView.h \
+interfaces/datastructure/IVFDescriptorIndex.h \
 interfaces/datastructure/ImageMarker.h \
 interfaces/datastructure/Keyframe.h \
 interfaces/datastructure/Keypoint.h \
+interfaces/datastructure/KeypointGrid.h \
+interfaces/datastructure/KeypointSet.h \
 interfaces/datastructure/Mask2D.h \
 interfaces/datastructure/Mask2DCollection.h \
 interfaces/datastructure/MathDefinitions.h \
 interfaces/datastructure/Mesh.h \
 interfaces/datastructure/PointCloud.h \
 interfaces/datastructure/PrimitiveInformation.h \
+interfaces/datastructure/ProductQuantizer.h \
+interfaces/datastructure/SmallVector.h \
 interfaces/datastructure/SquaredBinaryPattern.h \
 interfaces/datastructure/Trackable.h \
 interfaces/datastructure/Trackable2D.h \
 interfaces/datastructure/CovisibilityGraph.h \
 interfaces/datastructure/KeyframeRetrieval.h \
 interfaces/datastructure/KeyframeCollection.h \
+interfaces/datastructure/LSHDescriptorIndex.h \
 interfaces/datastructure/Lockable.h \
 interfaces/datastructure/Map.h \
 interfaces/datastructure/StorageTrackable.h \
 interfaces/datastructure/StorageWorldAnchor.h \
 interfaces/datastructure/StorageWorldElement.h \
 interfaces/datastructure/StorageWorldLink.h \
+interfaces/datastructure/UndistortionMap.h \
 interfaces/datastructure/UnitSystem.h \
 interfaces/base/features/ADescriptorMatcher.h \
 interfaces/base/features/ADescriptorMatcherGeometric.h \
@@ -183,25 +197,37 @@ src/datastructure/RelocalizationInformation.cpp \
 src/datastructure/StorageCapabilities.cpp \
 src/core/Log.cpp \
 src/core/SolARFramework.cpp \
+src/core/ThreadPool.cpp \
 src/datastructure/CameraParametersCollection.cpp \
 src/datastructure/CloudPoint.cpp \
 src/datastructure/CoordinateSystem.cpp \
 src/datastructure/DescriptorBuffer.cpp \
+src/datastructure/DescriptorDistance.cpp \
+src/datastructure/DescriptorIndex.cpp \
 src/datastructure/DescriptorMatch.cpp \
 src/datastructure/FiducialMarker.cpp \
 src/datastructure/GlobalDescriptor.cpp \
 src/datastructure/QRCode.cpp \
 src/datastructure/Frame.cpp \
+src/datastructure/FramePool.cpp \
 src/datastructure/Identification.cpp \
 src/datastructure/Image.cpp \
+src/datastructure/ImageBufferPool.cpp \
+src/datastructure/ImageView.cpp \
+src/datastructure/IVFDescriptorIndex.cpp \
 src/datastructure/ImageMarker.cpp \
 src/datastructure/Keyframe.cpp \
 src/datastructure/Keypoint.cpp \
+src/datastructure/KeypointGrid.cpp \
+src/datastructure/KeypointSet.cpp \
+src/datastructure/LSHDescriptorIndex.cpp \
 src/datastructure/PointCloud.cpp \
 src/datastructure/PrimitiveInformation.cpp \
+src/datastructure/ProductQuantizer.cpp \
 src/datastructure/SquaredBinaryPattern.cpp \
 src/datastructure/Trackable.cpp \
 src/datastructure/Trackable2D.cpp \
+src/datastructure/UndistortionMap.cpp \
 src/datastructure/CovisibilityGraph.cpp \
 src/datastructure/KeyframeRetrieval.cpp \
 src/datastructure/KeyframeCollection.cpp \
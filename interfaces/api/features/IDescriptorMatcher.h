@@ -23,6 +23,7 @@
 
 #include <vector>
 #include "datastructure/DescriptorBuffer.h"
+#include "datastructure/DescriptorIndex.h"
 #include "datastructure/DescriptorMatch.h"
 #include "datastructure/Frame.h"
 #include "datastructure/CameraDefinitions.h"
@@ -38,7 +39,7 @@ namespace features {
  * @class IDescriptorMatcher
  * @brief <B>Matches two sets of descriptors together.</B>
  * <TT>UUID: dda38a40-c50a-4e7d-8433-0f04c7c98518</TT>
- * Just implement the first interface, the second interface is implemented in ADescriptorMatcher.
+ * Just implement the first interface, the other ones are implemented in ADescriptorMatcher.
  */
 class XPCF_IGNORE IDescriptorMatcher :
     virtual public org::bcom::xpcf::IComponentIntrospect {
@@ -73,6 +74,23 @@ public:
                                       const SRef<SolAR::datastructure::DescriptorBuffer>descriptors2,
                                       std::vector<SolAR::datastructure::DescriptorMatch> & matches)=0;
 
+    /// @brief Match a set of descriptors against several sets of descriptors, e.g. the descriptors of a frame against the descriptors of candidate keyframes.
+    /// @param[in] descriptors1 The set of descriptors organized in a dedicated buffer structure.
+    /// @param[in] descriptors2 The sets of descriptors to match with, each one organized in a dedicated buffer structure.
+    /// @param[out] matches For each set of descriptors2, a vector of matches representing pairs of indices relatively to the first set and to this set.
+    /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const std::vector<SRef<SolAR::datastructure::DescriptorBuffer>> & descriptors2,
+                                      std::vector<std::vector<SolAR::datastructure::DescriptorMatch>> & matches) = 0;
+
+    /// @brief Match a set of descriptors against an indexed set of descriptors (e.g. the descriptors of a point cloud or of a keyframe collection)
+    /// @param[in] descriptors1 The set of descriptors organized in a dedicated buffer structure.
+    /// @param[in] index2 The index of the second set of descriptors.
+    /// @param[out] matches A vector of matches representing pairs of indices relatively to the first set of descriptors and ids of the index.
+    /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorIndex> index2,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> & matches) = 0;
 
 };
 
@@ -111,6 +111,17 @@ public:
     /// @return The number of points
     virtual int getNbPoints() const = 0;
 
+    /// @brief This method allows to get the product quantizer used to compress the descriptors of the points (see ProductQuantizer::encode)
+    /// @return the quantizer, nullptr if the descriptors are not compressed
+    virtual SRef<SolAR::datastructure::ProductQuantizer> getQuantizer() const = 0;
+
+    /// @brief This method allows to get the product quantization codes of the descriptors of a set of points.
+    /// The codes are read from the contiguous code buffer of the point cloud (see PointCloud::getCodes), under the lock of the point cloud.
+    /// @param[in] ids the ids of the points
+    /// @param[out] codes the codes of the points in the order of ids, of type DescriptorType::PQ
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR if a point has no code.
+    virtual FrameworkReturnCode getDescriptorCodes(const std::vector<uint32_t> & ids, SolAR::datastructure::DescriptorBuffer & codes) const = 0;
+
 	/// @brief This method allows to save the point cloud to the external file
 	/// @param[in] file the file name
 	/// @return FrameworkReturnCode::_SUCCESS_ if the suppression succeed, else FrameworkReturnCode::_ERROR.
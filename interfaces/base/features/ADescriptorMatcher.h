@@ -38,15 +38,16 @@ public:
 
     virtual ~ADescriptorMatcher() override = default;    
 
-    /// @brief Match two sets of descriptors together
+    /// @brief Match two sets of descriptors together.
+    /// The default implementation is a multithreaded brute force matching with the ratio test (defaultDistanceRatio property) and the mutual check (defaultCrossCheck property),
+    /// see SolAR::datastructure::matchDescriptors.
     /// @param[in] descriptors1 The first set of descriptors organized in a dedicated buffer structure.
     /// @param[in] descriptors2 The second set of descriptors organized in a dedicated buffer structure.
     /// @param[out] matches A vector of matches representing pairs of indices relatively to the first and second set of descriptors.
     /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
-    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> /*descriptors1*/,
-                                      const SRef<SolAR::datastructure::DescriptorBuffer> /*descriptors2*/,
-                                      std::vector<SolAR::datastructure::DescriptorMatch> & /*matches*/) override
-    { return FrameworkReturnCode::_NOT_IMPLEMENTED; }
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> & matches) override;
 
 	/// @brief Match two sets of descriptors together. The second set is organized in a vector of descriptors buffer and can be used if the descriptors have been extracted on subsets of an image.
 	/// @param[in] descriptors1 The first set of descriptors organized in a dedicated buffer structure.
@@ -63,7 +64,36 @@ public:
                                       const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
                                       std::vector<SolAR::datastructure::DescriptorMatch> & matches) override;
 
+    /// @brief Match a set of descriptors against several sets of descriptors, e.g. the descriptors of a frame against the descriptors of candidate keyframes.
+    /// The default implementation matches each set with the matching of two sets above, so that the results are those of this matching.
+    /// @param[in] descriptors1 The set of descriptors organized in a dedicated buffer structure.
+    /// @param[in] descriptors2 The sets of descriptors to match with, each one organized in a dedicated buffer structure.
+    /// @param[out] matches For each set of descriptors2, a vector of matches representing pairs of indices relatively to the first set and to this set.
+    /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const std::vector<SRef<SolAR::datastructure::DescriptorBuffer>> & descriptors2,
+                                      std::vector<std::vector<SolAR::datastructure::DescriptorMatch>> & matches) override;
+
+    /// @brief Match a set of descriptors against an indexed set of descriptors (e.g. the descriptors of a point cloud or of a keyframe collection).
+    /// Each descriptor is matched with its nearest neighbour in the index if it passes the ratio test (defaultDistanceRatio property).
+    /// @param[in] descriptors1 The set of descriptors organized in a dedicated buffer structure.
+    /// @param[in] index2 The index of the second set of descriptors.
+    /// @param[out] matches A vector of matches representing pairs of indices relatively to the first set of descriptors and ids of the index.
+    /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorIndex> index2,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> & matches) override;
+
+protected:
+    /// @brief distance ratio between the nearest and the second nearest neighbours of a matched descriptor, 1 or more to disable the ratio test.
+    /// Declared as the defaultDistanceRatio property, so that it does not collide with the properties of the components.
+    float m_defaultDistanceRatio = 0.75f;
+
+    /// @brief if not 0, a match is kept only if the descriptors are the nearest neighbours of each other (defaultCrossCheck property)
+    int32_t m_defaultCrossCheck = 1;
 
+    /// @brief maximum number of threads used for matching, 0 for all the hardware threads (defaultNbThreads property)
+    uint32_t m_defaultNbThreads = 0;
 };
 }
 }
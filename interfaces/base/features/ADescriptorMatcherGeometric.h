@@ -38,6 +38,10 @@ public:
     virtual ~ADescriptorMatcherGeometric() override = default;
 
     /// @brief Match two sets of descriptors from two frames based on epipolar constraint.
+    /// The default implementation computes the fundamental matrix from the poses, and compares each descriptor of the first set
+    /// only with the descriptors of the second set whose keypoints are close to its epipolar line (defaultEpipolarBand property, in pixels).
+    /// The keypoints of the second set are sorted by the direction of their epipolar line, so the candidates of a descriptor are
+    /// found by a binary search. The descriptors are matched among their candidates with matchCandidateDescriptors.
     /// @param[in] descriptors1 The first set of descriptors.
     /// @param[in] descriptors2 The second set of descriptors.
     /// @param[in] undistortedKeypoints1 The first set of undistorted keypoints.
@@ -50,18 +54,17 @@ public:
     /// @param[in] mask1 The indices of descriptors in the first frame are used for matching to the second frame. If it is empty then all will be used.
     /// @param[in] mask2 The indices of descriptors in the second frame are used for matching to the first frame. If it is empty then all will be used.
     /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
-    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> /* descriptors1 */,
-                                      const SRef<SolAR::datastructure::DescriptorBuffer> /* descriptors2 */,
-                                      const std::vector<SolAR::datastructure::Keypoint> & /* undistortedKeypoints1, */,
-                                      const std::vector<SolAR::datastructure::Keypoint> & /* undistortedKeypoints2 */,
-                                      const SolAR::datastructure::Transform3Df& /* pose1, */,
-                                      const SolAR::datastructure::Transform3Df& /* pose2 */,
-                                      const SolAR::datastructure::CameraParameters & /* camParams1, */,
-                                      const SolAR::datastructure::CameraParameters & /* camParams2 */,
-                                      std::vector<SolAR::datastructure::DescriptorMatch> & /* matches */,
-                                      const std::vector<uint32_t>& /* mask1 */,
-                                      const std::vector<uint32_t>& /* mask2 */) override
-    { return FrameworkReturnCode::_NOT_IMPLEMENTED; }
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
+                                      const std::vector<SolAR::datastructure::Keypoint> & undistortedKeypoints1,
+                                      const std::vector<SolAR::datastructure::Keypoint> & undistortedKeypoints2,
+                                      const SolAR::datastructure::Transform3Df& pose1,
+                                      const SolAR::datastructure::Transform3Df& pose2,
+                                      const SolAR::datastructure::CameraParameters & camParams1,
+                                      const SolAR::datastructure::CameraParameters & camParams2,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> & matches,
+                                      const std::vector<uint32_t>& mask1 = {},
+                                      const std::vector<uint32_t>& mask2 = {}) override;
 
     /// @brief Match two sets of descriptors from two frames based on epipolar constraint.
     /// @param[in] frame1 The first frame containing descriptors and undistorted keypoints.
@@ -79,6 +82,16 @@ public:
                                       std::vector<SolAR::datastructure::DescriptorMatch> & matches,
                                       const std::vector<uint32_t>& mask1 = {},
                                       const std::vector<uint32_t>& mask2 = {}) override;
+
+protected:
+    /// @brief maximum distance in pixels between a keypoint of the second frame and the epipolar line of its match (defaultEpipolarBand property)
+    float m_defaultEpipolarBand = 2.f;
+
+    /// @brief distance ratio of the ratio test of matchCandidateDescriptors, 1 or more to disable it (defaultDistanceRatio property)
+    float m_defaultDistanceRatio = 1.f;
+
+    /// @brief if not 0, enables the unicity check of matchCandidateDescriptors (defaultCrossCheck property)
+    int32_t m_defaultCrossCheck = 1;
 };
 }
 }
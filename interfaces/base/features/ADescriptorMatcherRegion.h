@@ -38,6 +38,8 @@ public:
     virtual ~ADescriptorMatcherRegion() override = default;
 
     /// @brief Match each descriptor of the first set to descriptors in its searching region of the second set.
+    /// The default implementation indexes the second set of points in a KeypointGrid and matches in this grid
+    /// with the protected overload below.
     /// @param[in] descriptors1 The first set of descriptors.
     /// @param[in] descriptors2 The second set of descriptors.
     /// @param[in] points2D1 The positions of the first set of descriptors.
@@ -46,16 +48,16 @@ public:
     /// @param[in] radius the radius of search region around each keypoint of the first set.
     /// @param[in] matchingDistanceMax the maximum distance to valid a match.
     /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
-    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> /*descriptors1*/,
-                                      const SRef<SolAR::datastructure::DescriptorBuffer> /*descriptors2*/,
-                                      const std::vector<SolAR::datastructure::Point2Df> & /*points2D1*/,
-                                      const std::vector<SolAR::datastructure::Point2Df> & /*points2D2*/,
-                                      std::vector<SolAR::datastructure::DescriptorMatch> &/*matches*/,
-                                      const float /*radius  = -1.f */,
-                                      const float /*matchingDistanceMax = -1.f */) override
-    { return FrameworkReturnCode::_NOT_IMPLEMENTED;}
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
+                                      const std::vector<SolAR::datastructure::Point2Df> & points2D1,
+                                      const std::vector<SolAR::datastructure::Point2Df> & points2D2,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> &matches,
+                                      const float radius = -1.f,
+                                      const float matchingDistanceMax = -1.f) override;
 
     /// @brief Match each descriptor input to descriptors of a frame in a region. The searching space is a circle which is defined by a 2D center and a radius
+    /// The default implementation dispatches to the protected overload below with the keypoints of the frame and their keypoint grid.
     /// @param[in] points2D The center points of searching regions
     /// @param[in] descriptors The descriptors organized in a vector of dedicated buffer structure.
     /// @param[in] frame The frame contains descriptors to match.
@@ -71,6 +73,7 @@ public:
                                       const float matchingDistanceMax = -1.f) override;
 
     /// @brief Match each descriptor of the current frame to descriptors of the last frame in a region. The searching space is a circle which is defined by a 2D center and a radius
+    /// The default implementation dispatches to the protected overload below with the keypoints of the frames and the keypoint grid of the last frame.
     /// @param[in] currentFrame the current frame.
     /// @param[in] lastFrame the last frame.
     /// @param[out] matches a vector of matches between two frames representing pairs of keypoint indices relatively.
@@ -82,6 +85,37 @@ public:
                                       std::vector<SolAR::datastructure::DescriptorMatch> &matches,
                                       const float radius = -1.f,
                                       const float matchingDistanceMax = -1.f) override;
+
+protected:
+    /// @brief Match each descriptor of the first set to the nearest descriptor of the second set in its searching region, the second set of points being indexed in a grid.
+    /// It is called by the default implementations of all the public overloads, the Frame overloads passing the keypoint grid of the frame:
+    /// a component overriding the matching of two sets overrides this overload too so that the Frame overloads use its matching.
+    /// The default implementation matches with matchCandidateDescriptors, the candidates of a descriptor being the points of the grid
+    /// at a distance less or equal than radius from its position.
+    /// @param[in] descriptors1 The first set of descriptors.
+    /// @param[in] descriptors2 The second set of descriptors.
+    /// @param[in] points2D1 The positions of the first set of descriptors.
+    /// @param[in] points2D2 The positions of the second set of descriptors.
+    /// @param[in] grid2 The grid of the positions of the second set of descriptors.
+    /// @param[out] matches A vector of matches representing pairs of indices relatively to the first and second set of descriptors.
+    /// @param[in] radius the radius of search region around each keypoint of the first set, negative to search in all the second set.
+    /// @param[in] matchingDistanceMax the maximum distance to valid a match, negative to disable it.
+    /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
+                                      const std::vector<SolAR::datastructure::Point2Df> & points2D1,
+                                      const std::vector<SolAR::datastructure::Point2Df> & points2D2,
+                                      const SolAR::datastructure::KeypointGrid & grid2,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> & matches,
+                                      const float radius,
+                                      const float matchingDistanceMax);
+
+protected:
+    /// @brief distance ratio of the ratio test of matchCandidateDescriptors, 1 or more to disable it (defaultDistanceRatio property)
+    float m_defaultDistanceRatio = 1.f;
+
+    /// @brief if not 0, enables the unicity check of matchCandidateDescriptors (defaultCrossCheck property)
+    int32_t m_defaultCrossCheck = 1;
 };
 }
 }
@@ -38,6 +38,10 @@ public:
     virtual ~ADescriptorMatcherStereo() override = default;
 
     /// @brief Match two sets of descriptors from stereo images.
+    /// The default implementation indexes the keypoints of the second image by row (by column for vertical stereo) with a tolerance in pixels (defaultRowBand property),
+    /// and compares each descriptor of the first image only with the descriptors on its row whose disparity is in [defaultMinDisparity, defaultMaxDisparity].
+    /// The disparity is the coordinate along the baseline in the first image minus the one in the second image.
+    /// The descriptors are matched among their candidates with matchCandidateDescriptors.
     /// @param[in] descriptors1 Descirptors of the first image.
     /// @param[in] descriptors2 Descirptors of the second image.
     /// @param[in] undistortedKeypoints1 Undistorted keypoints of the first image.
@@ -45,13 +49,12 @@ public:
     /// @param[in] type Stereo type (horizontal or vertical).
     /// @param[out] matches A vector of matches representing pairs of indices relatively to the first and second set of descriptors.
     /// @return FrameworkReturnCode::_SUCCESS if matching succeed, else FrameworkReturnCode::_ERROR_
-    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer>& /*descriptors1*/,
-                                      const SRef<SolAR::datastructure::DescriptorBuffer>& /*descriptors2*/,
-                                      const std::vector<SolAR::datastructure::Keypoint>& /*undistortedKeypoints1*/,
-                                      const std::vector<SolAR::datastructure::Keypoint>& /*undistortedKeypoints2*/,
-                                      SolAR::datastructure::StereoType /*type*/,
-                                      std::vector<SolAR::datastructure::DescriptorMatch> &/*matches*/) override
-	{ return FrameworkReturnCode::_NOT_IMPLEMENTED; }
+    virtual FrameworkReturnCode match(const SRef<SolAR::datastructure::DescriptorBuffer>& descriptors1,
+                                      const SRef<SolAR::datastructure::DescriptorBuffer>& descriptors2,
+                                      const std::vector<SolAR::datastructure::Keypoint>& undistortedKeypoints1,
+                                      const std::vector<SolAR::datastructure::Keypoint>& undistortedKeypoints2,
+                                      SolAR::datastructure::StereoType type,
+                                      std::vector<SolAR::datastructure::DescriptorMatch> &matches) override;
 
     /// @brief Match two sets of descriptors from stereo images.
     /// @param[in] frame1 The first frame containing descriptors and undistorted keypoints.
@@ -64,7 +67,21 @@ public:
                                       SolAR::datastructure::StereoType type,
                                       std::vector<SolAR::datastructure::DescriptorMatch> &matches) override;
 
+protected:
+    /// @brief maximum difference in pixels between the rows (columns for vertical stereo) of matched keypoints (defaultRowBand property)
+    float m_defaultRowBand = 2.f;
+
+    /// @brief minimum disparity in pixels of a match (defaultMinDisparity property)
+    float m_defaultMinDisparity = 0.f;
+
+    /// @brief maximum disparity in pixels of a match, negative for no maximum (defaultMaxDisparity property)
+    float m_defaultMaxDisparity = -1.f;
+
+    /// @brief distance ratio of the ratio test of matchCandidateDescriptors, 1 or more to disable it (defaultDistanceRatio property)
+    float m_defaultDistanceRatio = 1.f;
 
+    /// @brief if not 0, enables the unicity check of matchCandidateDescriptors (defaultCrossCheck property)
+    int32_t m_defaultCrossCheck = 1;
 };
 }
 }
@@ -24,6 +24,9 @@
 #include "core/SolARFrameworkDefinitions.h"
 #include <xpcf/component/ConfigurableBase.h>
 #include "api/geom/I2DPointsRectification.h"
+#include "datastructure/UndistortionMap.h"
+
+#include <mutex>
 
 namespace SolAR {
 namespace base {
@@ -38,18 +41,21 @@ public:
     virtual ~A2DPointsRectification() override = default;
 
     /// @brief Rectify 2D points
+    /// The default implementation undistorts the points in one pass with an UndistortionMap of the camera, built at the first call
+    /// and rebuilt when the camera parameters change, then applies the rotation and the projection of the rectification.
     /// @param[in] points2D The input 2D points
     /// @param[in] camParams The camera parameters of camera
     /// @param[in] rectParams The rectification parameters of camera
     /// @param[out] rectifiedPoints2D The rectified 2D points
     /// @return FrameworkReturnCode::_SUCCESS if rectifying succeed, else FrameworkReturnCode::_ERROR_
-    virtual FrameworkReturnCode rectify(const std::vector<SolAR::datastructure::Point2Df>& /*points2D*/,
-                                        const SolAR::datastructure::CameraParameters& /*camParams*/,
-                                        const SolAR::datastructure::RectificationParameters& /*rectParams*/,
-                                        std::vector<SolAR::datastructure::Point2Df>& /*rectifiedPoints2D*/) override
-    { return FrameworkReturnCode::_NOT_IMPLEMENTED; }
+    virtual FrameworkReturnCode rectify(const std::vector<SolAR::datastructure::Point2Df>& points2D,
+                                        const SolAR::datastructure::CameraParameters& camParams,
+                                        const SolAR::datastructure::RectificationParameters& rectParams,
+                                        std::vector<SolAR::datastructure::Point2Df>& rectifiedPoints2D) override;
 
     /// @brief Rectify 2D keypoints
+    /// The default implementation rectifies the positions of the keypoints with the rectification of 2D points above,
+    /// so that the keypoints are rectified as the points by a component overriding it.
     /// @param[in] keypoints The input 2D keypoints
     /// @param[in] camParams The camera parameters of camera
     /// @param[in] rectParams The rectification parameters of camera
@@ -59,6 +65,11 @@ public:
                                         const SolAR::datastructure::CameraParameters& camParams,
                                         const SolAR::datastructure::RectificationParameters& rectParams,
                                         std::vector<SolAR::datastructure::Keypoint>& rectifiedKeypoints) override;
+
+private:
+    // undistortion map of the last camera rectified by the default implementation
+    SRef<SolAR::datastructure::UndistortionMap> m_undistortionMap;
+    std::mutex m_mutexUndistortionMap;
 };
 }
 }
@@ -30,6 +30,7 @@
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/set.hpp>
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/utility.hpp>
 #include <boost/serialization/binary_object.hpp>
 #include <boost/uuid/uuid_serialize.hpp>
 #include <boost/serialization/export.hpp>
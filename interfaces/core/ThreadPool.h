@@ -0,0 +1,83 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOLAR_THREADPOOL_H
+#define SOLAR_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/SolARFrameworkDefinitions.h"
+
+namespace SolAR {
+
+/**
+ * @class ThreadPool
+ * @brief <B>A pool of worker threads running data parallel loops.</B>
+ *
+ * parallelFor runs the tasks of a loop on the workers and on the calling thread, and returns when all of them are done.
+ * A pool runs one loop at a time: a loop started while another one is running, or from inside a task, runs on the calling thread.
+ */
+class SOLARFRAMEWORK_API ThreadPool {
+public:
+    /// @brief ThreadPool constructor
+    /// @param[in] nbThreads the number of threads running the tasks, the calling thread included
+    explicit ThreadPool(uint32_t nbThreads);
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool();
+
+    /// @brief return the pool shared by the framework, with one thread per hardware thread
+    static ThreadPool & instance();
+
+    /// @brief return the number of threads running the tasks, the calling thread included
+    uint32_t getNbThreads() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    /// @brief run task(i) for i in [0, nbTasks)
+    /// @param[in] nbTasks the number of tasks
+    /// @param[in] task the task, called concurrently. It must not throw.
+    /// @param[in] maxThreads the maximum number of threads running the tasks, 0 for all the threads of the pool
+    void parallelFor(uint32_t nbTasks, const std::function<void(uint32_t)> & task, uint32_t maxThreads = 0);
+
+private:
+    void work(uint32_t workerIndex);
+    void runTasks();
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_loopMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const std::function<void(uint32_t)> * m_task = nullptr;
+    uint32_t m_nbTasks = 0;
+    std::atomic<uint32_t> m_nextTask{0};
+    uint32_t m_nbActiveWorkers = 0;
+    uint32_t m_nbRunningWorkers = 0;
+    uint64_t m_loop = 0;
+    bool m_stop = false;
+};
+
+}  // end of namespace SolAR
+
+#endif // SOLAR_THREADPOOL_H
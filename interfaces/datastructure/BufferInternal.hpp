@@ -17,7 +17,13 @@
 
 #ifndef SOLAR_BUFFERINTERNAL_H
 #define SOLAR_BUFFERINTERNAL_H
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
 
 #include <core/SerializationDefinitions.h>
 #include <xpcf/core/helpers.h>
@@ -25,9 +31,50 @@
 namespace SolAR {
 namespace datastructure {
 
+/**
+ * @class AlignedAllocator
+ * @brief <B>A std allocator returning memory aligned on Alignment bytes.</B>
+ */
+template <typename T, std::size_t Alignment>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, std::size_t /* n */) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept { return false; }
+};
+
+/// @brief alignment (in bytes) of the BufferInternal storage, i.e. the size of a cache line
+constexpr uint32_t BUFFER_ALIGNMENT = 64;
+
 /**
  * @class BufferInternal
  * @brief <B>A Buffer used to store any data such as descriptors.</B>
+ *
+ * The storage is aligned on BUFFER_ALIGNMENT bytes. When the buffer stores rows (e.g. descriptors)
+ * a row layout can be defined so that each row starts on a padded stride. Padding bytes are zeroed
+ * and are never serialized: archives always contain the packed rows.
+ *
+ * A buffer can also wrap external memory without copy (borrowed memory released through a callback,
+ * or an adopted std::vector). Such memory is copied into the buffer's own storage (copy-on-write)
+ * as soon as the buffer is resized or its layout changed.
  */
 
 class BufferInternal {
@@ -44,9 +91,32 @@ public:
        setData(data,size);
 
     }
+
+    /// @brief wrap an external memory block without copying it
+    /// @param[in] data the external memory
+    /// @param[in] size the size in bytes of the external memory
+    /// @param[in] release called with data when the buffer no longer references the memory.
+    /// If empty, the caller must keep the memory alive as long as the buffer uses it.
+    BufferInternal(void* data, uint32_t size, std::function<void(void*)> release) : m_bufferSize(size)
+    {
+        m_externalData = std::shared_ptr<uint8_t>(static_cast<uint8_t*>(data), [release](uint8_t* p) {
+            if (release)
+                release(p);
+        });
+    }
+
+    /// @brief adopt a vector without copying it
+    /// @param[in] data the vector moved into the buffer
+    explicit BufferInternal(std::vector<uint8_t> && data) : m_bufferSize(static_cast<uint32_t>(data.size()))
+    {
+        auto holder = std::make_shared<std::vector<uint8_t>>(std::move(data));
+        m_externalData = std::shared_ptr<uint8_t>(holder, holder->data());
+    }
+
     ~BufferInternal() = default;
     void setSize(uint32_t size)
     {
+        detach();
         m_bufferSize = size;
         if (m_bufferSize == 0) { // invalid size
             return;
@@ -62,33 +132,149 @@ public:
     inline uint32_t getSize() { return m_bufferSize; }
 
     void setData (void * data, uint32_t size){
+        m_externalData.reset();
         if (m_bufferSize < size) {
             setSize(size);
         }
         m_storageData = {static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + m_bufferSize};
     }
 
+    /// @brief reserve memory for size bytes, so that appending data up to this size does not reallocate
+    void reserve(uint32_t size)
+    {
+        detach();
+        if (size > m_storageData.capacity())
+            m_storageData.reserve(size);
+    }
+
+    /// @brief return the number of bytes the buffer can hold without reallocation
+    inline uint32_t getCapacity() const
+    {
+        return m_externalData ? m_bufferSize : static_cast<uint32_t>(m_storageData.capacity());
+    }
+
     void appendData (const void * data, uint32_t size){
+        appendData(data, size, size);
+    }
+
+    /// @brief append size bytes of data followed by zeroed padding up to paddedSize bytes.
+    /// The storage grows geometrically, so that successive appends have an amortized constant cost.
+    void appendData (const void * data, uint32_t size, uint32_t paddedSize){
+        // data may point into this buffer: keep the external memory alive, and locate data in the storage if it moves
+        std::shared_ptr<uint8_t> external = m_externalData;
+        const uint8_t * src = static_cast<const uint8_t *>(data);
+        const uint8_t * storageBegin = m_storageData.data();
+        bool inStorage = !m_externalData && (src >= storageBegin) && (src < storageBegin + m_storageData.size());
+        size_t srcOffset = inStorage ? static_cast<size_t>(src - storageBegin) : 0;
         uint32_t endOffset = m_bufferSize;
-        setSize(m_bufferSize + size);
-        auto startIt = std::next(m_storageData.begin(), endOffset);
-        m_storageData.insert(startIt, static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+        uint32_t newSize = m_bufferSize + paddedSize;
+        detach();
+        if (newSize > m_storageData.capacity())
+            m_storageData.reserve(std::max<size_t>(newSize, 2 * m_storageData.capacity()));
+        m_storageData.resize(newSize);
+        m_bufferSize = newSize;
+        if (inStorage)
+            src = m_storageData.data() + srcOffset;
+        std::memcpy(m_storageData.data() + endOffset, src, size);
+        std::memset(m_storageData.data() + endOffset + size, 0, paddedSize - size);
     }
 
-    inline void* data() { return m_storageData.data(); }
-    inline const void* data() const  { return m_storageData.data(); }
+    /// @brief define the layout of the rows stored in the buffer, and move the existing rows to this layout.
+    /// @param[in] nbRows the number of rows currently stored in the buffer
+    /// @param[in] rowSize the number of useful bytes per row
+    /// @param[in] rowStride the number of bytes between the start of two consecutive rows (rowStride >= rowSize)
+    void setRowLayout(uint32_t nbRows, uint32_t rowSize, uint32_t rowStride)
+    {
+        uint32_t currentStride = getRowStride(rowSize);
+        if (currentStride != rowStride) {
+            const uint8_t * rows = static_cast<const uint8_t *>(std::as_const(*this).data());
+            std::vector<uint8_t, AlignedAllocator<uint8_t, BUFFER_ALIGNMENT>> storage(static_cast<size_t>(nbRows) * rowStride, 0);
+            for (uint32_t i = 0; i < nbRows; i++)
+                std::memcpy(storage.data() + static_cast<size_t>(i) * rowStride,
+                            rows + static_cast<size_t>(i) * currentStride, rowSize);
+            m_storageData.swap(storage);
+            m_externalData.reset();
+            m_bufferSize = nbRows * rowStride;
+        }
+        m_rowSize = rowSize;
+        m_rowStride = rowStride;
+    }
+
+    /// @brief return the data, copied into the buffer's own storage first if it is borrowed (copy-on-write)
+    inline void* data() { detach(); return m_storageData.data(); }
+    inline const void* data() const  { return m_externalData ? m_externalData.get() : m_storageData.data(); }
+
+    /// @brief return true if the buffer wraps external memory
+    inline bool isExternal() const { return static_cast<bool>(m_externalData); }
+
+    /// @brief copy the external memory into the buffer's own storage before a modification
+    void detach()
+    {
+        if (!m_externalData)
+            return;
+        m_storageData.assign(m_externalData.get(), m_externalData.get() + m_bufferSize);
+        m_externalData.reset();
+    }
+
+    /// @brief resize the buffer to size bytes of packed data, without preserving its content.
+    /// The storage is reused when its capacity is large enough.
+    void reset(uint32_t size)
+    {
+        m_externalData.reset();
+        m_storageData.resize(size);
+        m_bufferSize = size;
+        m_rowSize = 0;
+        m_rowStride = 0;
+    }
 
 private:
+
+    inline uint32_t getRowStride(uint32_t rowSize) const {
+        return (m_rowStride > 0) ? m_rowStride : rowSize;
+    }
+
 	friend class boost::serialization::access;
 	template<class Archive>
-    void serialize(Archive &ar, const unsigned int /* version */) {
-		ar & m_storageData;
-		ar & m_bufferSize;
-	}
+    void save(Archive &ar, const unsigned int /* version */) const {
+        // the archive stores a std::vector<uint8_t> of the packed rows,
+        // to keep the format independent of the allocator and of the memory layout
+        const uint8_t * rows = static_cast<const uint8_t *>(data());
+        std::vector<uint8_t> packedData;
+        uint32_t packedSize = m_bufferSize;
+        if (m_rowStride > m_rowSize) {
+            uint32_t nbRows = m_bufferSize / m_rowStride;
+            packedSize = nbRows * m_rowSize;
+            packedData.resize(packedSize);
+            for (uint32_t i = 0; i < nbRows; i++)
+                std::memcpy(packedData.data() + static_cast<size_t>(i) * m_rowSize,
+                            rows + static_cast<size_t>(i) * m_rowStride, m_rowSize);
+        }
+        else if (m_externalData)
+            packedData.assign(rows, rows + m_bufferSize);
+        else
+            packedData.assign(m_storageData.begin(), m_storageData.end());
+        ar & packedData;
+        ar & packedSize;
+    }
+
+    template<class Archive>
+    void load(Archive &ar, const unsigned int /* version */) {
+        std::vector<uint8_t> packedData;
+        ar & packedData;
+        ar & m_bufferSize;
+        m_storageData.assign(packedData.begin(), packedData.end());
+        m_externalData.reset();
+        m_rowSize = 0;
+        m_rowStride = 0;
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
 
 private:
-    std::vector<uint8_t> m_storageData;
+    std::vector<uint8_t, AlignedAllocator<uint8_t, BUFFER_ALIGNMENT>> m_storageData;
     uint32_t m_bufferSize = 0;
+    uint32_t m_rowSize = 0;
+    uint32_t m_rowStride = 0;
+    std::shared_ptr<uint8_t> m_externalData;
 
 };
 
@@ -4,11 +4,13 @@
 #include <core/SolARFrameworkDefinitions.h>
 #include <datastructure/GeometryDefinitions.h>
 #include <datastructure/CameraDefinitions.h>
+#include <datastructure/UndistortionMap.h>
 #include <datastructure/Lockable.h>
 #include <core/Messages.h>
 #include <core/SerializationDefinitions.h>
 #include <xpcf/core/refs.h>
 #include <map>
+#include <mutex>
 
 
 // Definition of CameraParametersCollection Class //
@@ -29,8 +31,8 @@ public:
     /// @brief CameraParametersCollection constructor.
 	///
     CameraParametersCollection() = default;
-    CameraParametersCollection(const CameraParametersCollection& other) = default;
-    CameraParametersCollection& operator=(const CameraParametersCollection& other) = default;
+    CameraParametersCollection(const CameraParametersCollection& other): m_cameraParameters(other.m_cameraParameters), m_id(other.m_id), m_undistortionMaps(other.m_undistortionMaps) {};
+    CameraParametersCollection& operator=(const CameraParametersCollection& other);
 
 	///
     /// \brief ~CameraParametersCollection
@@ -89,6 +91,13 @@ public:
     /// @return The number of cameraParameters
     int getNbCameraParameters() const;
 
+    /// @brief This method allows to get the undistortion map of a cameraParameters by its id.
+    /// The map is built on the first request and cached, then rebuilt when the cameraParameters change.
+    /// @param[in] id of the cameraParameters
+    /// @param[out] undistortionMap the undistortion map of the cameraParameters
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR.
+    FrameworkReturnCode getUndistortionMap(const uint32_t id, SRef<const SolAR::datastructure::UndistortionMap> & undistortionMap) const;
+
 private:
 	friend class boost::serialization::access;
 	template <typename Archive>
@@ -96,6 +105,32 @@ private:
 
     std::map<uint32_t, SRef<SolAR::datastructure::CameraParameters>> m_cameraParameters;
     uint32_t                                                         m_id = 0;
+    // cached maps with their lock: a copy takes the maps under the lock of the copied ones, and has a lock of its own
+    struct UndistortionMaps {
+        UndistortionMaps() = default;
+        UndistortionMaps(const UndistortionMaps & other) : maps(other.copy()) {}
+        UndistortionMaps & operator=(const UndistortionMaps & other)
+        {
+            if (this != &other) {
+                std::map<uint32_t, SRef<const SolAR::datastructure::UndistortionMap>> copied = other.copy();
+                std::unique_lock lock(mutex);
+                maps.swap(copied);
+            }
+            return *this;
+        }
+
+        std::map<uint32_t, SRef<const SolAR::datastructure::UndistortionMap>> copy() const
+        {
+            std::unique_lock lock(mutex);
+            return maps;
+        }
+
+        mutable std::mutex mutex;
+        std::map<uint32_t, SRef<const SolAR::datastructure::UndistortionMap>> maps;
+    };
+
+    // undistortion maps built by getUndistortionMap, not serialized
+    mutable UndistortionMaps                                         m_undistortionMaps;
 };
 
 DECLARESERIALIZE(CameraParametersCollection);
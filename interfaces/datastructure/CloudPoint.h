@@ -23,9 +23,11 @@
 
 #include <xpcf/api/IComponentIntrospect.h>
 #include <core/SolARFrameworkDefinitions.h>
+#include <core/Messages.h>
 #include <datastructure/GeometryDefinitions.h>
 #include <datastructure/DescriptorBuffer.h>
 #include <datastructure/PrimitiveInformation.h>
+#include <datastructure/SmallVector.h>
 #include <core/SerializationDefinitions.h>
 
 // Definition of CloudPoint Class //
@@ -43,9 +45,14 @@ public:
         ViewDirection = 0x02,
         ReprojectionError = 0x04,
         Visibility = 0x08,
-        Descriptor = 0x10
+        Descriptor = 0x10,
+        CompressedDescriptor = 0x20 /**< the descriptor is stored as a product quantization code by the point cloud */
     } CloudPointType;
 
+    /// @brief The visibility of a cloud point: (keyframe id, keypoint id) pairs sorted by keyframe id.
+    /// Most cloud points are seen by a few keyframes, which are stored inline.
+    typedef SmallVector<std::pair<uint32_t, uint32_t>, 4> SortedVisibility;
+
     CloudPoint() = default;
 
 	/// @brief CloudPoint constructor with a Point3Df.
@@ -199,14 +206,24 @@ public:
 	const SRef<DescriptorBuffer>& getDescriptor() const;
 
 	///
-	/// @brief This method sets the descriptor of the cloud point
+	/// @brief This method sets the descriptor of the cloud point, which is then no longer compressed
 	/// @param[in] descriptor: the descriptor
 	///
 	void setDescriptor(const SRef<DescriptorBuffer> &descriptor);
 
+	///
+	/// @brief This method releases the descriptor of the cloud point once it is stored compressed by its point cloud (see ProductQuantizer::encode)
+	///
+	void releaseDescriptor();
+
+	/// @brief This method returns true if the descriptor of the cloud point was released to be stored compressed by its point cloud
+	bool isDescriptorCompressed() const;
+
 	/// @brief This method updates the descriptor of the cloud point by taking into account the descriptor of new keyframe
 	/// @param[in] descriptor: the new descriptor
-	void addNewDescriptor(const DescriptorView &descriptor);
+	/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if the descriptor does not match the descriptor of the cloud point
+	/// or if the descriptor of the cloud point is compressed (it has to be set again with setDescriptor then encoded), the cloud point being then left unchanged
+	FrameworkReturnCode addNewDescriptor(const DescriptorView &descriptor);
 
     ///
     /// @brief These methods returns the color components of the CloudPoint
@@ -255,9 +272,27 @@ public:
 
 	///
     /// @brief return the visibility map of the CloudPoint
+    /// The map is built on the first call, then kept up to date with the visibility of the CloudPoint.
+    /// Loops on many cloud points should prefer getSortedVisibility or getVisibility(keyframe_id, keypoint_id).
     /// @return The visibility, a map where the key corresponds to the id of the keyframe, and the value to the id of the keypoint in this keyframe.
 	///
 	const std::map<uint32_t, uint32_t>& getVisibility() const;
+	///
+    /// @brief return the visibility of the CloudPoint
+    /// @return the (keyframe id, keypoint id) pairs seeing the CloudPoint, sorted by keyframe id
+	///
+	const SortedVisibility& getSortedVisibility() const;
+	///
+    /// @brief get the keypoint of a keyframe seeing the CloudPoint
+    /// @param[in] keyframe_id: the id of the keyframe
+    /// @param[out] keypoint_id: the id of the keypoint of the keyframe
+    /// @return true if the keyframe sees the CloudPoint
+	///
+	bool getVisibility(const uint32_t& keyframe_id, uint32_t& keypoint_id) const;
+	///
+    /// @brief return the number of keyframes seeing the CloudPoint
+	///
+	uint32_t getNbVisibilities() const;
 
 	///
     /// @brief add a keypoint to the visibility map of the CloudPoint
@@ -288,11 +323,24 @@ private:
     template <typename Archive>
     void serialize(Archive &ar, const unsigned int version);
 
+    void setVisibility(const std::map<uint32_t, uint32_t>& visibility);
+
+    ///
+    /// @brief The visibility map returned by getVisibility, which is not copied with the cloud point
+    ///
+    struct VisibilityMap {
+        VisibilityMap() = default;
+        VisibilityMap(const VisibilityMap &) {}
+        VisibilityMap & operator=(const VisibilityMap &) { map.reset(); return *this; }
+        SRef<std::map<uint32_t, uint32_t>> map;
+    };
+
 private:	
     uint32_t                                m_cloudPointSupportedTypes = 0;
     uint32_t								m_id = 0;
     SRef<DescriptorBuffer>					m_descriptor = nullptr;
-    std::map<unsigned int, unsigned int>	m_visibility = {};
+    SortedVisibility                        m_visibility;
+    mutable VisibilityMap                   m_visibilityMap;
     Vector3f								m_rgb = {0.0, 0.0, 0.0};
     Vector3f								m_viewDirection = {0.0, 0.0, 0.0};
     double                                  m_reproj_error = 0.0;
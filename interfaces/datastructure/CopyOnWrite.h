@@ -0,0 +1,125 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/** @file */
+
+#ifndef SOLAR_COPYONWRITE_H
+#define SOLAR_COPYONWRITE_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class CopyOnWrite
+ * @brief <B>A value shared by its copies until one of them modifies it.</B>
+ *
+ * Copying a CopyOnWrite only copies a reference to its value: the value itself is copied by the first modification
+ * through edit or set of a CopyOnWrite sharing it. Bulky members of data structures (e.g. the keypoints of a frame)
+ * are stored this way, so that cloning the data structure costs O(1) until the clone is written.
+ * As for a plain value, concurrent accesses to one CopyOnWrite must be synchronized by its owner, while distinct
+ * copies sharing a value can be used from different threads.
+ */
+template <typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() = default;
+
+    CopyOnWrite(const T & value) : m_value(std::make_shared<T>(value)) {}
+
+    CopyOnWrite(T && value) : m_value(std::make_shared<T>(std::move(value))) {}
+
+    // moves copy the reference too: a moved-from CopyOnWrite keeps its value
+    CopyOnWrite(const CopyOnWrite &) = default;
+    CopyOnWrite & operator=(const CopyOnWrite &) = default;
+
+    ~CopyOnWrite() = default;
+
+    /// @brief return the value, a default T if it was never set
+    const T & get() const
+    {
+        return m_value ? *m_value : empty();
+    }
+
+    /// @brief return a reference to the value, which stays unchanged: the next modification of this CopyOnWrite copies it first
+    std::shared_ptr<const T> share() const
+    {
+        if (m_value)
+            return m_value;
+        // a value never set is shared as the default T, without owning it
+        return std::shared_ptr<const T>(std::shared_ptr<const T>(), &empty());
+    }
+
+    const T & operator*() const { return get(); }
+    const T * operator->() const { return &get(); }
+
+    /// @brief return the value for modification, copying it first if it is shared
+    T & edit()
+    {
+        if (!isOwned())
+            m_value = m_value ? std::make_shared<T>(*m_value) : std::make_shared<T>();
+        return *m_value;
+    }
+
+    /// @brief return the value to be overwritten: an unshared value is kept with its storage, a shared one is replaced by a default T
+    T & overwrite()
+    {
+        if (!isOwned())
+            m_value = std::make_shared<T>();
+        return *m_value;
+    }
+
+    /// @brief replace the value, without copying the current one if it is shared
+    template <typename U>
+    void set(U && value)
+    {
+        if (isOwned())
+            *m_value = std::forward<U>(value);
+        else
+            m_value = std::make_shared<T>(std::forward<U>(value));
+    }
+
+    /// @brief return true if the value is shared with other copies
+    bool isShared() const { return m_value && (m_value.use_count() > 1); }
+
+private:
+    static const T & empty()
+    {
+        static const T value{};
+        return value;
+    }
+
+    bool isOwned() const
+    {
+        if (!m_value || (m_value.use_count() > 1))
+            return false;
+        // the last other owner released the value before: see its accesses before modifying it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+private:
+    std::shared_ptr<T> m_value;
+};
+
+}  // end of namespace datastructure
+}  // end of namespace SolAR
+
+#endif // SOLAR_COPYONWRITE_H
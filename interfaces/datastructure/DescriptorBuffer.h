@@ -18,6 +18,7 @@
 #define SOLAR_DESCRIPTORS_H
 
 #include <utility>
+#include <functional>
 #include <map>
 #include <cstdint>
 #include <optional>
@@ -51,6 +52,7 @@ enum DescriptorType{
     ORB, /**<ORB descriptor, assumes 32 elements per descriptor stores as one byte per element */
     SBPATTERN, /**<Squared Binary Pattern descriptor, assumes nxn elements per descriptor stores as one byte per element, n is the size of the pattern */
     DISK, /**<DISK descriptor, assumes 128 elements per descriptor stores as one byte per element */
+    PQ, /**<Product quantization codes of a real valued descriptor (see ProductQuantizer), one byte per sub-quantizer stored as one byte per element */
     UNDEFINED = 1000,
 };
 
@@ -76,6 +78,8 @@ static std::string toString(const DescriptorType descriptorType)
             return "SBPATTERN";
         case DescriptorType::DISK:
             return "DISK";
+        case DescriptorType::PQ:
+            return "PQ";
         case DescriptorType::UNDEFINED:
             return "UNDEFINED";
         default:
@@ -96,6 +100,7 @@ static std::optional<DescriptorType> parseDescriptorType(const std::string & tex
     if (textDefinition == "ORB") return DescriptorType::ORB;
     if (textDefinition == "SBPATTERN") return DescriptorType::SBPATTERN;
     if (textDefinition == "DISK") return DescriptorType::DISK;
+    if (textDefinition == "PQ") return DescriptorType::PQ;
     if (textDefinition == "UNDEFINED") return DescriptorType::UNDEFINED;
 
     LOG_ERROR("Unknown descriptor type: {}", textDefinition);
@@ -103,6 +108,20 @@ static std::optional<DescriptorType> parseDescriptorType(const std::string & tex
     return {};
 }
 
+/**
+ * @enum DescriptorRowAlignment
+ * @brief <B>The memory layout of the descriptors stored in a DescriptorBuffer.</B>
+ *
+ * Aligned layouts pad each descriptor to a stride multiple of the alignment, so that SIMD code can stream
+ * descriptors with aligned loads and without tail handling (e.g. 61 bytes AKAZE descriptors are stored on 64 bytes).
+ */
+enum DescriptorRowAlignment {
+    ROW_PACKED = 1, /**< descriptors are stored back-to-back (default) */
+    ROW_ALIGNED_16 = 16, /**< each descriptor starts on a 16 bytes boundary */
+    ROW_ALIGNED_32 = 32, /**< each descriptor starts on a 32 bytes boundary */
+    ROW_ALIGNED_64 = 64 /**< each descriptor starts on a 64 bytes (cache line) boundary */
+};
+
 template <class T> inline static constexpr DescriptorDataType inferDescriptorDataType();
 
 template <> inline constexpr DescriptorDataType inferDescriptorDataType<uint8_t>()
@@ -135,9 +154,82 @@ struct inferType<DescriptorDataType::TYPE_32F>
     typedef float InnerType;
 };
 
+/**
+ * @enum DescriptorDistanceType
+ * @brief <B>The distance used to compare two descriptors of a given DescriptorType.</B>
+ */
+enum class DescriptorDistanceType {
+    HAMMING, /**< number of differing bits, used for binary descriptors (AKAZE, ORB, SBPATTERN) */
+    L2, /**< euclidean distance, used for real valued descriptors (SIFT, SIFT_UINT8, SURF, DISK) */
+    ADC /**< asymmetric euclidean distance between a descriptor and product quantization codes (PQ), computed by a ProductQuantizer */
+};
+
+/**
+ * @struct DescriptorProperties
+ * @brief <B>The compile-time properties of a DescriptorType.</B>
+ */
+struct DescriptorProperties {
+    uint32_t nbElements; /**< number of elements per descriptor, 0 when the length is only known at runtime (SBPATTERN, PQ) */
+    DescriptorDataType dataType; /**< storage type of each element */
+    DescriptorDistanceType distanceType; /**< distance used to compare descriptors */
+};
+
+/// @brief Return the properties of a DescriptorType
+/// @param[in] descriptorType the descriptor type
+/// @return the descriptor properties, with nbElements = 0 for dynamic length or undefined types
+inline constexpr DescriptorProperties getDescriptorProperties(const DescriptorType descriptorType)
+{
+    switch (descriptorType) {
+        case DescriptorType::AKAZE:
+            return {61, DescriptorDataType::TYPE_8U, DescriptorDistanceType::HAMMING};
+        case DescriptorType::SIFT:
+            return {128, DescriptorDataType::TYPE_32F, DescriptorDistanceType::L2};
+        case DescriptorType::SIFT_UINT8:
+            return {128, DescriptorDataType::TYPE_8U, DescriptorDistanceType::L2};
+        case DescriptorType::SURF_64:
+            return {64, DescriptorDataType::TYPE_32F, DescriptorDistanceType::L2};
+        case DescriptorType::SURF_128:
+            return {128, DescriptorDataType::TYPE_32F, DescriptorDistanceType::L2};
+        case DescriptorType::ORB:
+            return {32, DescriptorDataType::TYPE_8U, DescriptorDistanceType::HAMMING};
+        case DescriptorType::SBPATTERN:
+            return {0, DescriptorDataType::TYPE_8U, DescriptorDistanceType::HAMMING};
+        case DescriptorType::DISK:
+            return {128, DescriptorDataType::TYPE_8U, DescriptorDistanceType::L2};
+        case DescriptorType::PQ:
+            return {0, DescriptorDataType::TYPE_8U, DescriptorDistanceType::ADC};
+        case DescriptorType::UNDEFINED:
+        default:
+            return {0, DescriptorDataType::TYPE_8U, DescriptorDistanceType::L2};
+    }
+}
+
+/// @brief Return the distance used to compare descriptors of a given type
+/// @param[in] descriptorType the descriptor type
+/// @return DescriptorDistanceType::HAMMING for binary descriptors, DescriptorDistanceType::L2 otherwise
+inline constexpr DescriptorDistanceType getDescriptorDistanceType(const DescriptorType descriptorType)
+{
+    return getDescriptorProperties(descriptorType).distanceType;
+}
+
+/**
+ * @struct DescriptorTraits
+ * @brief <B>Compile-time traits of a DescriptorType.</B>
+ */
+template<DescriptorType descriptorType>
+struct DescriptorTraits
+{
+    static constexpr uint32_t nbElements = getDescriptorProperties(descriptorType).nbElements;
+    static constexpr DescriptorDataType dataType = getDescriptorProperties(descriptorType).dataType;
+    static constexpr DescriptorDistanceType distanceType = getDescriptorProperties(descriptorType).distanceType;
+    static constexpr bool isFixedLength = (nbElements > 0);
+    typedef typename inferType<dataType>::InnerType ElementType;
+};
+
 class SOLARFRAMEWORK_API DescriptorView {
 public:
-    explicit DescriptorView(void * startAddress, uint32_t length, DescriptorType type);
+    explicit DescriptorView(void * startAddress, uint32_t length, DescriptorType type):
+        m_dataType(getDescriptorProperties(type).dataType), m_baseAddress(startAddress), m_length(length), m_type(type) {}
     DescriptorView(const DescriptorView & desc) = default;
     DescriptorView(DescriptorView && desc) noexcept :
         m_dataType(std::exchange(desc.m_dataType, DescriptorDataType::TYPE_8U)),
@@ -171,20 +263,49 @@ private:
 
 
 
-template<typename T>
+/**
+ * @class DescriptorViewTemplate
+ * @brief <B>A typed view on a descriptor.</B>
+ *
+ * When N > 0 the length of the descriptor is known at compile time, which lets the compiler fully unroll the code
+ * processing it (see FixedDescriptorView). N = 0 is the runtime length view.
+ */
+template<typename T, uint32_t N = 0>
 class DescriptorViewTemplate {
 public:
-    DescriptorViewTemplate(T * startAddress, uint32_t length, DescriptorType type):m_length(length),m_baseAddress(startAddress), m_type(type) {}
+    DescriptorViewTemplate(T * startAddress, DescriptorType type):m_baseAddress(startAddress), m_type(type) {}
+    DescriptorViewTemplate(const DescriptorViewTemplate & desc) = default;
+    DescriptorViewTemplate& operator= (const DescriptorViewTemplate & desc) = default;
+
+    static constexpr uint32_t length() { return N; }
+    const T* data() const { return m_baseAddress; }
+    T* data() { return m_baseAddress; }
+    DescriptorType type() const { return m_type; }
+
+    static constexpr DescriptorDataType sDataType = inferDescriptorDataType<T>();
+    static constexpr uint32_t sLength = N;
+
+private:
+    T * m_baseAddress;
+    DescriptorType m_type;
+};
+
+template<typename T>
+class DescriptorViewTemplate<T, 0> {
+public:
+    DescriptorViewTemplate(T * startAddress, uint32_t length, DescriptorType type):m_baseAddress(startAddress),m_length(length), m_type(type) {}
     DescriptorViewTemplate(const DescriptorViewTemplate & desc) = default;
     DescriptorViewTemplate(DescriptorViewTemplate && desc) :
         m_baseAddress(std::exchange(desc.m_baseAddress, nullptr)),
-        m_length(std::exchange(desc.m_length, 0)) {}
+        m_length(std::exchange(desc.m_length, 0)),
+        m_type(desc.m_type) {}
 
     DescriptorViewTemplate& operator= (const DescriptorViewTemplate & desc) = default;
     DescriptorViewTemplate& operator= ( DescriptorViewTemplate && desc)
     {
         m_baseAddress = std::exchange(desc.m_baseAddress, nullptr);
         m_length = std::exchange(desc.m_length, 0);
+        m_type = desc.m_type;
         return *this;
     }
 
@@ -204,6 +325,16 @@ private:
 using DescriptorView8U = DescriptorViewTemplate<uint8_t>;
 using DescriptorView32F = DescriptorViewTemplate<float>;
 
+/// @brief fixed length view of a descriptor type, e.g. FixedDescriptorView<DescriptorType::ORB> is a view on 32 uint8_t
+template<DescriptorType descriptorType>
+using FixedDescriptorView = DescriptorViewTemplate<typename DescriptorTraits<descriptorType>::ElementType,
+                                                   DescriptorTraits<descriptorType>::nbElements>;
+
+using DescriptorViewORB = FixedDescriptorView<DescriptorType::ORB>;
+using DescriptorViewAKAZE = FixedDescriptorView<DescriptorType::AKAZE>;
+using DescriptorViewSIFT = FixedDescriptorView<DescriptorType::SIFT>;
+using DescriptorViewDISK = FixedDescriptorView<DescriptorType::DISK>;
+
 class DescriptorBuffer;
 class SOLARFRAMEWORK_API DescriptorBufferIterator {
 public:
@@ -276,6 +407,52 @@ public :
     */
     explicit DescriptorBuffer( DescriptorType descriptor_type, DescriptorDataType data_type, uint32_t nb_elements, uint32_t nb_descriptors);
 
+    /** @brief  DescriptorBuffer
+    *  @param descriptorData: pointer to an existing array structure
+    *  @param descriptor_type: enum to describe the descriptors vector
+    *  @param nb_descriptors: the number of descriptors stored in the buffer
+    *  @param release: called with descriptorData when the buffer no longer uses it, or if the construction fails.
+    *  If empty, the caller must keep descriptorData alive as long as the buffer uses it.
+    * The data are not copied: the buffer borrows the memory until it is resized (copy-on-write).
+    * @throws std::invalid_argument if the properties of descriptor_type are unknown or the descriptors exceed the maximum size of a buffer
+    */
+    explicit DescriptorBuffer( unsigned char* descriptorData, DescriptorType descriptor_type, uint32_t nb_descriptors,
+                               std::function<void(void*)> release);
+
+    /** @brief  DescriptorBuffer
+    *  @param descriptorData: pointer to an existing array structure
+    *  @param descriptor_type: enum to describe the descriptors vector
+    *  @param data_type: number of bits per descriptor element
+    *  @param nb_elements: number of elements per descriptor
+    *  @param nb_descriptors: the number of descriptors stored in the buffer
+    *  @param release: called with descriptorData when the buffer no longer uses it, or if the construction fails.
+    *  If empty, the caller must keep descriptorData alive as long as the buffer uses it.
+    * The data are not copied: the buffer borrows the memory until it is resized (copy-on-write).
+    * @throws std::invalid_argument if the descriptors exceed the maximum size of a buffer
+    */
+    explicit DescriptorBuffer( unsigned char* descriptorData, DescriptorType descriptor_type, DescriptorDataType data_type,
+                               uint32_t nb_elements, uint32_t nb_descriptors, std::function<void(void*)> release);
+
+    /** @brief  DescriptorBuffer
+    *  @param descriptorData: the descriptors, moved into the buffer without copy
+    *  @param descriptor_type: enum to describe the descriptors vector
+    *  @param nb_descriptors: the number of descriptors stored in the buffer
+    * @throws std::invalid_argument if the properties of descriptor_type are unknown or descriptorData does not hold nb_descriptors packed descriptors.
+    * descriptorData is then left unchanged.
+    */
+    explicit DescriptorBuffer( std::vector<uint8_t> && descriptorData, DescriptorType descriptor_type, uint32_t nb_descriptors);
+
+    /** @brief  DescriptorBuffer
+    *  @param descriptorData: the descriptors, moved into the buffer without copy
+    *  @param descriptor_type: enum to describe the descriptors vector
+    *  @param data_type: number of bits per descriptor element
+    *  @param nb_elements: number of elements per descriptor
+    *  @param nb_descriptors: the number of descriptors stored in the buffer
+    * @throws std::invalid_argument if descriptorData does not hold nb_descriptors packed descriptors. descriptorData is then left unchanged.
+    */
+    explicit DescriptorBuffer( std::vector<uint8_t> && descriptorData, DescriptorType descriptor_type, DescriptorDataType data_type,
+                               uint32_t nb_elements, uint32_t nb_descriptors);
+
     /** @brief  DescriptorBuffer
     * default constructor
     */
@@ -315,15 +492,89 @@ public :
         return m_nb_elements * m_data_type;
     }
 
+    /** @brief  return the number of bytes between the start of two consecutive descriptors
+    *  @note equals getDescriptorByteSize() for the ROW_PACKED layout. Padding bytes are zeroed.
+    */
+    inline uint32_t getDescriptorStride(void) const
+    {
+        return (getDescriptorByteSize() + m_row_alignment - 1) / m_row_alignment * m_row_alignment;
+    }
+
+    /** @brief  return the memory layout of the descriptors
+    */
+    inline DescriptorRowAlignment getRowAlignment() const
+    {
+        return m_row_alignment;
+    }
+
+    /** @brief  return true if the descriptors are stored in borrowed or adopted memory (no copy was made)
+    */
+    inline bool isBorrowed() const
+    {
+        return m_buffer->isExternal();
+    }
+
+    /** @brief  change the memory layout of the descriptors. The buffer start is always 64 bytes aligned,
+    *  so with an aligned layout each descriptor starts on an alignment boundary.
+    *  @param alignment: the new layout, the existing descriptors are moved to this layout
+    *  @note serialization always stores packed descriptors, a deserialized buffer uses the ROW_PACKED layout.
+    */
+    void setRowAlignment(DescriptorRowAlignment alignment);
+
     void append(const DescriptorView & descriptor);
     void append(const DescriptorView8U & descriptor);
     void append(const DescriptorView32F & descriptor);
 
+    /** @brief  append all the descriptors of another buffer
+    *  @param descriptors: the descriptors to append, of the same type, data type and number of elements
+    */
+    void append(const DescriptorBuffer & descriptors);
+
+    /** @brief  append a subset of the descriptors of another buffer (gather)
+    *  @param descriptors: the descriptors to append from, of the same type, data type and number of elements
+    *  @param indices: the indices of the descriptors to append, in the order they will be appended.
+    *  Nothing is appended if an index is out of range.
+    */
+    void append(const DescriptorBuffer & descriptors, const std::vector<uint32_t> & indices);
+
+    /** @brief  reserve memory so that the buffer can hold nb_descriptors without reallocation
+    *  @param nb_descriptors: the total number of descriptors to hold
+    */
+    void reserve(uint32_t nb_descriptors);
+
 	DescriptorBuffer convertTo(DescriptorDataType type) const;
 	DescriptorBuffer operator+ (const DescriptorBuffer &desc) const;
 	DescriptorBuffer operator* (float fac) const;
 	DescriptorBuffer operator/ (float div) const;
 
+    /** @brief  convert the descriptors to another data type into an existing buffer, reusing its memory
+    *  @param type: the data type of the converted descriptors (rounded and saturated when converting to TYPE_8U)
+    *  @param output: the converted descriptors, with a ROW_PACKED layout. It can be this buffer.
+    */
+    void convertTo(DescriptorDataType type, DescriptorBuffer & output) const;
+
+    /** @brief  change the type and size of the buffer, reusing its memory when it is large enough.
+    *  The content of the descriptors is undefined and the layout is ROW_PACKED.
+    */
+    void reshape(DescriptorType descriptor_type, DescriptorDataType data_type, uint32_t nb_elements, uint32_t nb_descriptors);
+
+    /** @brief  fused in-place update of a descriptor: descriptor[index] = scale * descriptor[index] + weight * descriptor.
+    *  The computation is done in float, and rounded when the buffer stores TYPE_8U data.
+    *  @param index: the index of the updated descriptor
+    *  @param descriptor: the added descriptor, of the same number of elements, with TYPE_8U or TYPE_32F data
+    *  @param weight: the factor applied to the added descriptor
+    *  @param scale: the factor applied to the updated descriptor. When 0, its previous content is ignored.
+    */
+    void accumulate(uint32_t index, const DescriptorView & descriptor, float weight = 1.f, float scale = 1.f);
+
+    /** @brief  in-place versions of operator+, operator* and operator/.
+    *  As for these operators the result is stored as TYPE_32F: a TYPE_8U buffer is converted once,
+    *  further operations do not allocate memory.
+    */
+    DescriptorBuffer& operator+= (const DescriptorBuffer &desc);
+    DescriptorBuffer& operator*= (float fac);
+    DescriptorBuffer& operator/= (float div);
+
 
     DescriptorView getDescriptor(uint32_t index) const;
 
@@ -332,6 +583,16 @@ public :
     template <DescriptorDataType datatype, typename T = typename inferType<datatype>::InnerType>
     DescriptorViewTemplate<T> getDescriptor(uint32_t index);
 
+    /** @brief  return a fixed length view of a descriptor
+    *  @note the buffer must store descriptors of type descriptorType with their default data type
+    */
+    template <DescriptorType descriptorType>
+    FixedDescriptorView<descriptorType> getFixedDescriptor(uint32_t index) const;
+
+    /** @brief  return the start of the descriptors storage
+    *  @note descriptors are getDescriptorStride() bytes apart.
+    *  Borrowed memory is copied into the buffer's own storage first (copy-on-write), use the const overload to read it without copy.
+    */
     void* data();
 
     const void* data() const;
@@ -339,6 +600,9 @@ public :
 private:
     bool deduceProperties(const DescriptorType & type);
 
+    /// copy the storage before an in-place modification if it is shared with another buffer or borrowed
+    void makeWritable();
+
 	friend class boost::serialization::access;
 	template<typename Archive>
 	void serialize(Archive &ar, const unsigned int version);
@@ -349,6 +613,7 @@ private:
     DescriptorDataType m_data_type;
     uint32_t m_nb_elements;
     DescriptorType m_descriptor_type;
+    DescriptorRowAlignment m_row_alignment = DescriptorRowAlignment::ROW_PACKED;
 };
 DECLARESERIALIZE(DescriptorBuffer);
 
@@ -367,8 +632,16 @@ template <DescriptorDataType datatype, typename T> DescriptorViewTemplate<T> Des
 {
     static_assert (std::is_same<std::uint8_t,T>::value || std::is_same<std::float_t, T>::value,
                    "getDescriptor() only works for T = uint8_t or T = float" );
-    T* pDescriptor = static_cast<T*>(data());
-    return DescriptorViewTemplate<T>(&pDescriptor[index * m_nb_elements], m_nb_elements, m_descriptor_type);
+    uint8_t* pDescriptor = static_cast<uint8_t*>(data()) + index * getDescriptorStride();
+    return DescriptorViewTemplate<T>(reinterpret_cast<T*>(pDescriptor), m_nb_elements, m_descriptor_type);
+}
+
+template <DescriptorType descriptorType> FixedDescriptorView<descriptorType> DescriptorBuffer::getFixedDescriptor(uint32_t index) const
+{
+    static_assert (DescriptorTraits<descriptorType>::isFixedLength, "getFixedDescriptor() only works for fixed length descriptor types");
+    typedef typename DescriptorTraits<descriptorType>::ElementType T;
+    const uint8_t* pDescriptor = static_cast<const uint8_t*>(data()) + index * getDescriptorStride();
+    return FixedDescriptorView<descriptorType>(const_cast<T*>(reinterpret_cast<const T*>(pDescriptor)), m_descriptor_type);
 }
 
 template <DescriptorDataType datatype, typename T = typename inferType<datatype>::InnerType>
@@ -379,8 +652,8 @@ DescriptorViewTemplate<T> getDescriptor(const SRef<DescriptorBuffer> buffer, uin
     if (buffer->getDescriptorDataType() != sizeof (T)) {
         // throw exception
     }
-    T* pDescriptor = static_cast<T*>(buffer->data());
-    return DescriptorViewTemplate<T>(&pDescriptor[index * buffer->getNbElements()], buffer->getNbElements(), buffer->getDescriptorType());
+    uint8_t* pDescriptor = static_cast<uint8_t*>(buffer->data()) + index * buffer->getDescriptorStride();
+    return DescriptorViewTemplate<T>(reinterpret_cast<T*>(pDescriptor), buffer->getNbElements(), buffer->getDescriptorType());
 }
 
 } // namespace datastructure
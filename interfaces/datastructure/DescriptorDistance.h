@@ -0,0 +1,277 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOLAR_DESCRIPTORDISTANCE_H
+#define SOLAR_DESCRIPTORDISTANCE_H
+
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <core/SolARFrameworkDefinitions.h>
+#include <core/Messages.h>
+#include <datastructure/DescriptorBuffer.h>
+#include <datastructure/DescriptorMatch.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @enum DistanceKernelISA
+ * @brief <B>The instruction set used by the descriptor distance kernels.</B>
+ */
+enum class DistanceKernelISA {
+    SCALAR = 0, /**< portable C++ implementation */
+    SSE42, /**< x86 SSE4.2 and hardware popcount */
+    AVX2, /**< x86 AVX2 and FMA */
+    AVX512, /**< x86 AVX-512 (F, BW and VPOPCNTDQ when available) */
+    NEON /**< ARM Advanced SIMD */
+};
+
+/// @brief Return the text definition (string) of a DistanceKernelISA object
+/// @param[in] isa the instruction set
+/// @return the text definition (string)
+SOLARFRAMEWORK_API std::string toString(const DistanceKernelISA isa);
+
+/// @brief Return the instruction set currently used by the distance kernels.
+/// The best instruction set supported by the CPU is selected at first use.
+SOLARFRAMEWORK_API DistanceKernelISA getDistanceKernelISA();
+
+/// @brief Force the instruction set used by the distance kernels (mainly for benchmarking and debugging).
+/// @param[in] isa the requested instruction set
+/// @return the instruction set actually selected: the requested one if the CPU supports it, the best supported one otherwise
+SOLARFRAMEWORK_API DistanceKernelISA setDistanceKernelISA(const DistanceKernelISA isa);
+
+/// @brief Compute the Hamming distance between two binary descriptors
+/// @param[in] desc1 the first descriptor
+/// @param[in] desc2 the second descriptor
+/// @param[in] nbBytes the number of bytes of each descriptor
+/// @return the number of bits differing between the two descriptors
+SOLARFRAMEWORK_API uint32_t hammingDistance(const uint8_t * desc1, const uint8_t * desc2, uint32_t nbBytes);
+
+/// @brief Compute the squared euclidean distance between two float descriptors
+/// @param[in] desc1 the first descriptor
+/// @param[in] desc2 the second descriptor
+/// @param[in] nbElements the number of elements of each descriptor
+/// @return the squared L2 distance
+SOLARFRAMEWORK_API float l2SquaredDistance(const float * desc1, const float * desc2, uint32_t nbElements);
+
+/// @brief Compute the squared euclidean distance between two uint8 descriptors (SIFT_UINT8, DISK)
+/// @param[in] desc1 the first descriptor
+/// @param[in] desc2 the second descriptor
+/// @param[in] nbElements the number of elements of each descriptor
+/// @return the squared L2 distance
+SOLARFRAMEWORK_API uint32_t l2SquaredDistance(const uint8_t * desc1, const uint8_t * desc2, uint32_t nbElements);
+
+/// @brief Compute the dot product between two float descriptors
+/// @param[in] desc1 the first descriptor
+/// @param[in] desc2 the second descriptor
+/// @param[in] nbElements the number of elements of each descriptor
+/// @return the dot product
+SOLARFRAMEWORK_API float dotProduct(const float * desc1, const float * desc2, uint32_t nbElements);
+
+/// @brief Convert uint8 descriptor elements to float
+/// @param[in] src the uint8 elements
+/// @param[out] dst the float elements
+/// @param[in] nbElements the number of elements to convert
+SOLARFRAMEWORK_API void convertDescriptorData(const uint8_t * src, float * dst, uint32_t nbElements);
+
+/// @brief Convert float descriptor elements to uint8, rounded to the nearest value and saturated to [0, 255]
+/// @param[in] src the float elements
+/// @param[out] dst the uint8 elements
+/// @param[in] nbElements the number of elements to convert
+SOLARFRAMEWORK_API void convertDescriptorData(const float * src, uint8_t * dst, uint32_t nbElements);
+
+/// @brief Compute y = alpha * y + beta * x in place
+/// @param[in] x the added elements
+/// @param[in] beta the factor applied to x
+/// @param[in,out] y the accumulated elements (may be equal to x)
+/// @param[in] alpha the factor applied to y
+/// @param[in] nbElements the number of elements
+SOLARFRAMEWORK_API void scaleAdd(const float * x, float beta, float * y, float alpha, uint32_t nbElements);
+
+/// @brief Compute y = alpha * y + beta * x in place, for uint8 elements x
+SOLARFRAMEWORK_API void scaleAdd(const uint8_t * x, float beta, float * y, float alpha, uint32_t nbElements);
+
+/// @brief Compute the distance between two descriptors of the same type
+/// @param[in] desc1 the first descriptor
+/// @param[in] desc2 the second descriptor
+/// @return the Hamming distance for binary descriptors, the euclidean (not squared) distance otherwise.
+/// A negative value is returned if the descriptors are not comparable.
+SOLARFRAMEWORK_API float descriptorDistance(const DescriptorView & desc1, const DescriptorView & desc2);
+
+/// @brief Compute the distances between one descriptor and all the descriptors of a buffer
+/// @param[in] query the query descriptor
+/// @param[in] train the descriptors to compare with
+/// @param[out] distances the distance between the query and each train descriptor (Hamming or euclidean distance)
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors are not comparable
+SOLARFRAMEWORK_API FrameworkReturnCode computeDistances(const DescriptorView & query,
+                                                        const DescriptorBuffer & train,
+                                                        std::vector<float> & distances);
+
+/// @brief Compute the distance matrix between two sets of descriptors
+/// @param[in] query the first set of descriptors
+/// @param[in] train the second set of descriptors
+/// @param[out] distances the row major distance matrix of size query.getNbDescriptors() x train.getNbDescriptors() (Hamming or euclidean distance)
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors are not comparable
+SOLARFRAMEWORK_API FrameworkReturnCode computeDistanceMatrix(const DescriptorBuffer & query,
+                                                             const DescriptorBuffer & train,
+                                                             std::vector<float> & distances);
+
+/// @brief Match two sets of descriptors by brute force, with the ratio test on the two nearest neighbours and an optional mutual check.
+/// The distance matrix is computed by tiles fitting in cache, in parallel on the ThreadPool shared by the framework.
+/// @param[in] descriptors1 the query descriptors
+/// @param[in] descriptors2 the train descriptors
+/// @param[in] distanceRatio a query is matched with its nearest neighbour if the distance to this neighbour is lower than
+/// distanceRatio times the distance to the second nearest neighbour. The ratio test is disabled for a ratio of 1 or more.
+/// @param[in] crossCheck if true, a match is kept only if the query is also the nearest neighbour of the train descriptor among the queries
+/// @param[out] matches the matches sorted by query index: index in descriptors1, index in descriptors2 and distance
+/// @param[in] maxThreads the maximum number of threads, 0 for all the threads of the pool
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors are not comparable
+SOLARFRAMEWORK_API FrameworkReturnCode matchDescriptors(const DescriptorBuffer & descriptors1,
+                                                        const DescriptorBuffer & descriptors2,
+                                                        float distanceRatio, bool crossCheck,
+                                                        std::vector<DescriptorMatch> & matches,
+                                                        uint32_t maxThreads = 0);
+
+/// @brief Match a set of descriptors against several sets of descriptors (e.g. a frame against candidate keyframes), see matchDescriptors above.
+/// The sets are matched in parallel while the query descriptors are read from cache.
+/// @param[in] descriptors1 the query descriptors
+/// @param[in] descriptors2 the sets of train descriptors
+/// @param[in] distanceRatio the ratio of the ratio test, 1 or more to disable it
+/// @param[in] crossCheck if true, a match is kept only if the query is also the nearest neighbour of the train descriptor among the queries
+/// @param[out] matches for each set of train descriptors, the matches sorted by query index: index in descriptors1, index in the set and distance
+/// @param[in] maxThreads the maximum number of threads, 0 for all the threads of the pool
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors are not comparable
+SOLARFRAMEWORK_API FrameworkReturnCode matchDescriptors(const DescriptorBuffer & descriptors1,
+                                                        const std::vector<SRef<DescriptorBuffer>> & descriptors2,
+                                                        float distanceRatio, bool crossCheck,
+                                                        std::vector<std::vector<DescriptorMatch>> & matches,
+                                                        uint32_t maxThreads = 0);
+
+/// @brief Match each descriptor of a first set to the nearest of its candidates in a second set (e.g. the descriptors of the keypoints
+/// in a searching region or along an epipolar line), with the ratio test on the two nearest candidates and an optional unicity check.
+/// The nearest candidate is the one with the lowest index among the candidates at the same distance.
+/// @param[in] descriptors1 the query descriptors
+/// @param[in] descriptors2 the train descriptors
+/// @param[in] getCandidates fills the distinct indices in descriptors2 of the candidates of a query given by its index in descriptors1,
+/// the vector being empty at the call. A query without candidate is not matched.
+/// @param[in] distanceRatio a query is matched with its nearest candidate if the distance to this candidate is lower than
+/// distanceRatio times the distance to the second nearest candidate. The ratio test is disabled for a ratio of 1 or more.
+/// @param[in] crossCheck if true, a train descriptor is matched at most once, with the nearest of the queries matched to it
+/// (the lower query index wins ties)
+/// @param[in] maxDistance the maximum distance of a match, negative to disable it
+/// @param[out] matches the matches sorted by query index: index in descriptors1, index in descriptors2 and distance
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors are not comparable
+SOLARFRAMEWORK_API FrameworkReturnCode matchCandidateDescriptors(const DescriptorBuffer & descriptors1,
+                                                                 const DescriptorBuffer & descriptors2,
+                                                                 const std::function<void(uint32_t, std::vector<uint32_t> &)> & getCandidates,
+                                                                 float distanceRatio, bool crossCheck, float maxDistance,
+                                                                 std::vector<DescriptorMatch> & matches);
+
+/// @brief Return the index of the nearest of a set of float vectors (squared euclidean distance)
+/// @param[in] vector the vector
+/// @param[in] centroids the nbCentroids x dimension candidate vectors, stored contiguously
+/// @param[in] nbCentroids the number of candidates
+/// @param[in] dimension the number of elements of each vector
+/// @param[out] distance the squared distance to the nearest candidate
+/// @return the index of the nearest candidate
+SOLARFRAMEWORK_API uint32_t findNearestCentroid(const float * vector, const float * centroids, uint32_t nbCentroids,
+                                                uint32_t dimension, float & distance);
+
+/// @brief Cluster float vectors with the k-means algorithm (Lloyd iterations, deterministic random initialization)
+/// @param[in] vectors the nbVectors x dimension vectors, stored contiguously
+/// @param[in] nbVectors the number of vectors, at least nbClusters
+/// @param[in] dimension the number of elements of each vector
+/// @param[in] nbClusters the number of clusters
+/// @param[in] nbIterations the maximum number of iterations, the clustering stops earlier when it converges
+/// @param[out] centroids the nbClusters x dimension centroids
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if there are less vectors than clusters
+SOLARFRAMEWORK_API FrameworkReturnCode computeKMeans(const float * vectors, uint32_t nbVectors, uint32_t dimension,
+                                                     uint32_t nbClusters, uint32_t nbIterations, std::vector<float> & centroids);
+
+/// @brief Compute the mean of a set of descriptors
+/// @param[in] descriptors the descriptors to average
+/// @param[out] mean a buffer holding one descriptor, the mean of the descriptors with their data type (rounded for TYPE_8U).
+/// The memory of mean is reused when possible.
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors is empty
+SOLARFRAMEWORK_API FrameworkReturnCode computeMeanDescriptor(const DescriptorBuffer & descriptors, DescriptorBuffer & mean);
+
+/// @brief Find the medoid of a set of descriptors, i.e. the descriptor minimizing the sum of the distances to the other descriptors.
+/// The medoid is the usual representative of binary descriptors, for which a mean is not meaningful.
+/// @param[in] descriptors the descriptors
+/// @param[out] medoidIndex the index of the medoid in descriptors
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if descriptors is empty or not comparable
+SOLARFRAMEWORK_API FrameworkReturnCode computeMedoidDescriptor(const DescriptorBuffer & descriptors, uint32_t & medoidIndex);
+
+/// @brief Update in place the running mean of the observations of a descriptor: mean = (mean * nbObservations + descriptor) / (nbObservations + 1)
+/// @param[in,out] mean a buffer holding one descriptor, the mean of the nbObservations previous observations
+/// @param[in] nbObservations the number of observations already averaged in mean
+/// @param[in] descriptor the new observation, of the same type and number of elements as mean
+/// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_ if the descriptor does not match the mean
+SOLARFRAMEWORK_API FrameworkReturnCode updateRunningMeanDescriptor(DescriptorBuffer & mean, uint32_t nbObservations,
+                                                                   const DescriptorView & descriptor);
+
+/// @brief Compute the distance between two fixed length descriptors of the same type.
+/// The descriptor length is a compile-time constant, so the loop is fully unrolled and vectorized by the compiler.
+/// Usage: descriptorDistance<DescriptorType::ORB>(buffer.getFixedDescriptor<DescriptorType::ORB>(i), ...)
+/// @param[in] desc1 the first descriptor
+/// @param[in] desc2 the second descriptor
+/// @return the Hamming distance for binary descriptors, the euclidean (not squared) distance otherwise.
+template<DescriptorType descriptorType>
+inline float descriptorDistance(const FixedDescriptorView<descriptorType> & desc1, const FixedDescriptorView<descriptorType> & desc2)
+{
+    typedef DescriptorTraits<descriptorType> Traits;
+    if constexpr (Traits::distanceType == DescriptorDistanceType::HAMMING) {
+        static_assert (Traits::dataType == DescriptorDataType::TYPE_8U, "Hamming distance requires binary descriptors");
+        uint32_t distance = 0;
+        uint32_t i = 0;
+        for (; i + sizeof(uint64_t) <= Traits::nbElements; i += sizeof(uint64_t)) {
+            uint64_t a, b;
+            std::memcpy(&a, desc1.data() + i, sizeof(uint64_t));
+            std::memcpy(&b, desc2.data() + i, sizeof(uint64_t));
+            distance += static_cast<uint32_t>(std::bitset<64>(a ^ b).count());
+        }
+        for (; i < Traits::nbElements; i++)
+            distance += static_cast<uint32_t>(std::bitset<8>(desc1.data()[i] ^ desc2.data()[i]).count());
+        return static_cast<float>(distance);
+    }
+    else if constexpr (Traits::dataType == DescriptorDataType::TYPE_8U) {
+        uint32_t distance = 0;
+        for (uint32_t i = 0; i < Traits::nbElements; i++) {
+            int32_t diff = static_cast<int32_t>(desc1.data()[i]) - static_cast<int32_t>(desc2.data()[i]);
+            distance += static_cast<uint32_t>(diff * diff);
+        }
+        return std::sqrt(static_cast<float>(distance));
+    }
+    else {
+        float distance = 0.f;
+        for (uint32_t i = 0; i < Traits::nbElements; i++) {
+            float diff = desc1.data()[i] - desc2.data()[i];
+            distance += diff * diff;
+        }
+        return std::sqrt(distance);
+    }
+}
+
+}
+}
+
+#endif // SOLAR_DESCRIPTORDISTANCE_H
@@ -0,0 +1,154 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file */
+
+#ifndef SOLAR_DESCRIPTORINDEX_H
+#define SOLAR_DESCRIPTORINDEX_H
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <core/Messages.h>
+#include <core/SerializationDefinitions.h>
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/DescriptorBuffer.h>
+#include <datastructure/DescriptorMatch.h>
+
+#include <boost/serialization/assume_abstract.hpp>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class DescriptorIndex
+ * @brief <B>An index of descriptors for nearest neighbour search.</B>
+ *
+ * Each indexed descriptor is identified by an id, usually the id of a CloudPoint. Descriptors can be added
+ * incrementally, and a descriptor added with the id of an indexed descriptor replaces it in place.
+ * Removed descriptors are only marked as removed (tombstones) and skipped by the searches,
+ * they are purged by compact(), which is automatically called when they represent a quarter of the index.
+ *
+ * Implementations define the search structure: IVFDescriptorIndex for real valued descriptors and
+ * LSHDescriptorIndex for binary descriptors.
+ */
+class SOLARFRAMEWORK_API DescriptorIndex {
+public:
+    DescriptorIndex() = default;
+
+    /// @brief DescriptorIndex constructor
+    /// @param[in] descriptorType the type of the indexed descriptors
+    explicit DescriptorIndex(DescriptorType descriptorType);
+
+    virtual ~DescriptorIndex() = default;
+
+    /// @brief return a deep copy of the index
+    virtual SRef<DescriptorIndex> clone() const = 0;
+
+    /// @brief return the type of the indexed descriptors
+    DescriptorType getDescriptorType() const { return m_descriptorType; }
+
+    /// @brief add a descriptor to the index, or replace the descriptor of this id if it is already indexed
+    /// @param[in] id the id of the descriptor
+    /// @param[in] descriptor the descriptor, of the index descriptor type
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode add(uint32_t id, const DescriptorView & descriptor);
+
+    /// @brief add a set of descriptors to the index
+    /// @param[in] ids the ids of the descriptors
+    /// @param[in] descriptors the descriptors, of the index descriptor type
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode add(const std::vector<uint32_t> & ids, const DescriptorBuffer & descriptors);
+
+    /// @brief remove a descriptor from the index
+    /// @param[in] id the id of the descriptor, ignored if it is not indexed
+    void remove(uint32_t id);
+
+    /// @brief return true if the descriptor has been removed and not purged yet
+    bool isRemoved(uint32_t id) const;
+
+    /// @brief return the number of descriptors in the index, removed descriptors excluded
+    uint32_t getNbDescriptors() const;
+
+    /// @brief find the k nearest neighbours of a descriptor
+    /// @param[in] query the query descriptor, of the index descriptor type
+    /// @param[in] k the number of neighbours
+    /// @param[out] neighbours the (id, distance) of the neighbours, sorted by increasing distance. There can be less than k neighbours.
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode search(const DescriptorView & query, uint32_t k,
+                                       std::vector<std::pair<uint32_t, float>> & neighbours) const = 0;
+
+    /// @brief find the k nearest neighbours of a set of descriptors
+    /// @param[in] queries the query descriptors
+    /// @param[in] k the number of neighbours
+    /// @param[out] matches for each query, its matches sorted by increasing distance: index of the query, id of the neighbour and distance
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode search(const DescriptorBuffer & queries, uint32_t k, std::vector<std::vector<DescriptorMatch>> & matches) const;
+
+    /// @brief match a set of descriptors with the ratio test on the two nearest neighbours
+    /// @param[in] queries the query descriptors
+    /// @param[in] distanceRatio a query is matched with its nearest neighbour if the distance to this neighbour is lower than
+    /// distanceRatio times the distance to the second nearest neighbour
+    /// @param[out] matches the matches: index of the query, id of the neighbour and distance
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode match(const DescriptorBuffer & queries, float distanceRatio, std::vector<DescriptorMatch> & matches) const;
+
+    /// @brief train the search structure on the indexed descriptors, if it needs training.
+    /// Training is never done implicitly by add(): it is up to the owner of the index to call it, e.g. from a background task.
+    /// @param[in] nbIterations the number of iterations of the training
+    /// @return FrameworkReturnCode::_SUCCESS if succeed or if no training is needed, else FrameworkReturnCode::_ERROR_
+    virtual FrameworkReturnCode train(uint32_t nbIterations = 10);
+
+    /// @brief purge the removed descriptors
+    virtual void compact() = 0;
+
+protected:
+    /// insert a descriptor checked by add(), of an id which is not indexed
+    virtual void insert(uint32_t id, const DescriptorView & descriptor) = 0;
+
+    /// overwrite in place the descriptor of an indexed id checked by add(), return false if the id is not indexed
+    virtual bool update(uint32_t id, const DescriptorView & descriptor) = 0;
+
+    /// return true if a descriptor of this id is stored, removed or not
+    virtual bool isIndexed(uint32_t id) const = 0;
+
+    /// return the number of descriptors stored, removed descriptors included
+    virtual uint32_t getNbEntries() const = 0;
+
+    /// return true if the view can be stored in or compared with the index
+    bool isCompatible(const DescriptorView & descriptor) const;
+
+    friend class boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive &ar, const unsigned int version);
+
+protected:
+    DescriptorType m_descriptorType = DescriptorType::UNDEFINED;
+    DescriptorDataType m_dataType = DescriptorDataType::TYPE_8U;
+    uint32_t m_nbElements = 0;
+    std::set<uint32_t> m_removed;
+};
+
+DECLARESERIALIZE(DescriptorIndex);
+
+}
+}
+
+BOOST_SERIALIZATION_ASSUME_ABSTRACT(SolAR::datastructure::DescriptorIndex);
+
+#endif // SOLAR_DESCRIPTORINDEX_H
@@ -6,11 +6,17 @@
 #include <datastructure/GeometryDefinitions.h>
 #include <datastructure/Image.h>
 #include <datastructure/Keypoint.h>
+#include <datastructure/KeypointGrid.h>
+#include <datastructure/KeypointSet.h>
 #include <datastructure/DescriptorMatch.h>
 #include <datastructure/CloudPoint.h>
+#include <datastructure/CopyOnWrite.h>
 #include <datastructure/CameraDefinitions.h>
 #include <datastructure/GlobalDescriptor.h>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 namespace SolAR {
 namespace datastructure {
@@ -21,6 +27,9 @@ class Keyframe;
  * @brief <B>A frame.</B>
  *
  * This class provides frame definition.
+ * The keypoints, mask IDs and visibilities are shared between a frame and its copies until one of them modifies them,
+ * so that copying a frame does not duplicate them. A modification of a shared member moves the frame to a copy of it,
+ * which invalidates the references to the member returned before: the snapshot getters return them as shared pointers instead.
  */
 class SOLARFRAMEWORK_API Frame {
 public:
@@ -57,7 +66,8 @@ public:
     const SRef<Image>& getView() const;
 
     /// @brief get mask IDs
-    /// @return vector of mask IDs
+    /// @return vector of mask IDs, valid until the next call to setMaskIDs or recycle, which replace it by a new vector
+    /// if it is shared with a copy of the frame.
     const std::vector<uint32_t>& getMaskIDs() const;
 
 	/// @brief set view image
@@ -69,8 +79,8 @@ public:
     void setMaskIDs(const std::vector<uint32_t>& maskIDs);
 
 	/// @brief get camera pose
-	/// @return camera pose
-    const Transform3Df& getPose() const;
+	/// @return a copy of the camera pose
+    Transform3Df getPose() const;
 
 	/// @brief set pose
 	/// @param[in] pose: camera pose
@@ -85,17 +95,43 @@ public:
     void setFixedPose(bool value);
 
 	/// @brief get keypoints
-	/// @return keypoints
+	/// Not thread-safe: the reference is not protected against a concurrent modification of the keypoints, use getKeypointsSnapshot instead.
+	/// @return keypoints, valid until the next call to setKeypoints, setKeypointSet, updateKeypointClassId or recycle,
+	/// which replace them by a copy if they are shared with a copy of the frame or a snapshot. The snapshot keeps them across these calls.
 	const std::vector<Keypoint> & getKeypoints() const;
+
+	/// @brief get keypoints, unchanged by later modifications of the keypoints of the frame
+	/// The keypoints are shared with the frame, which copies them on its next modification.
+	/// @return keypoints
+	SRef<const std::vector<Keypoint>> getKeypointsSnapshot() const;
 	
     /// @brief get the i-th keypoint
 	/// @param[in] i: index of keypoint
-	/// @return i-th keypoint
+	/// @return i-th keypoint, valid as the keypoints returned by getKeypoints
     const Keypoint & getKeypoint(int i) const;
 
 	/// @brief set keypoints
 	/// @param[in] kpts: keypoints
     void setKeypoints(const std::vector<Keypoint>& kpts);
+
+    /// @brief set keypoints
+    /// @param[in] kpts: keypoints stored as a structure of arrays
+    void setKeypointSet(const KeypointSet& kpts);
+
+    /// @brief get keypoints stored as a structure of arrays, with all their attributes
+    /// The set is built at the first call and rebuilt after a modification of the keypoints.
+    /// @return keypoints
+    SRef<const KeypointSet> getKeypointSet() const;
+
+    /// @brief get a grid of the keypoints for radius searches
+    /// The grid is built at the first call and rebuilt after a call to setKeypoints.
+    /// @return the keypoint grid
+    SRef<KeypointGrid> getKeypointGrid() const;
+
+    /// @brief get a grid of the keypoints for radius searches, with the keypoints it indexes
+    /// @param[out] keypoints the keypoints indexed by the grid, read with the grid under the lock of the keypoints
+    /// @return the keypoint grid
+    SRef<KeypointGrid> getKeypointGrid(SRef<const std::vector<Keypoint>> & keypoints) const;
 	
     /// @brief update keypoint class id
     /// @param[in] i index of keypoint
@@ -104,39 +140,86 @@ public:
     bool updateKeypointClassId(int i, int classId);
 
 	/// @brief get undistorted keypoints
-	/// @return undistorted keypoints
+	/// Not thread-safe: the reference is not protected against a concurrent modification of the undistorted keypoints, use getUndistortedKeypointsSnapshot instead.
+	/// @return undistorted keypoints, valid until the next call to setUndistortedKeypoints, setUndistortedKeypointSet, updateKeypointClassId or recycle,
+	/// which replace them by a copy if they are shared with a copy of the frame or a snapshot. The snapshot keeps them across these calls.
 	const std::vector<Keypoint> & getUndistortedKeypoints() const;
 
+	/// @brief get undistorted keypoints, unchanged by later modifications of the undistorted keypoints of the frame
+	/// @return undistorted keypoints
+	SRef<const std::vector<Keypoint>> getUndistortedKeypointsSnapshot() const;
+
 	/// @brief get the i-th undistorted keypoint
 	/// @param[in] i: index of undistorted keypoint
-	/// @return i-th undistorted keypoint
+	/// @return i-th undistorted keypoint, valid as the undistorted keypoints returned by getUndistortedKeypoints
 	const Keypoint & getUndistortedKeypoint(int i) const;
 
 	/// @brief set undistorted keypoints
 	/// @param[in] kpts: undistorted keypoints
 	void setUndistortedKeypoints(const std::vector<Keypoint>& kpts);
 
+    /// @brief set undistorted keypoints
+    /// @param[in] kpts: undistorted keypoints stored as a structure of arrays
+    void setUndistortedKeypointSet(const KeypointSet& kpts);
+
+    /// @brief get undistorted keypoints stored as a structure of arrays, with all their attributes
+    /// The set is built at the first call and rebuilt after a modification of the undistorted keypoints.
+    /// @return undistorted keypoints
+    SRef<const KeypointSet> getUndistortedKeypointSet() const;
+
 	/// @brief set reference keyframe
 	/// @param[in] keyframe: reference keyframe
     void setReferenceKeyframe(const SRef<Keyframe>& keyframe);
 
 	/// @brief get reference keyframe
 	/// @return reference keyframe
-	const SRef<Keyframe>& getReferenceKeyframe() const;
+	SRef<Keyframe> getReferenceKeyframe() const;
 
 	/// @brief get descriptors
 	/// @return descriptors
-    const SRef<DescriptorBuffer>& getDescriptors() const;
+    SRef<DescriptorBuffer> getDescriptors() const;
 
 	/// @brief set descriptors
 	/// @param[in] descriptors: descriptors
 	void setDescriptors(const SRef<DescriptorBuffer> &descriptors);
 
+	/// @brief the cloud point id of the keypoints which do not see any cloud point in getDenseVisibility
+	static constexpr uint32_t NO_VISIBILITY = std::numeric_limits<uint32_t>::max();
+
 	///
 	/// @brief Get all cloud point visibilities
+	/// The map is built on the first call, then kept up to date with the visibilities of the frame.
+	/// Loops on the keypoints should prefer getDenseVisibility or getVisibility(id_keypoint, id_cloudPoint).
+	/// Not thread-safe: the reference is not protected against a concurrent modification of the visibilities, use getVisibilitySnapshot instead.
+	/// The map is valid until the next call to setVisibility, addVisibility, addVisibilities, removeVisibility or recycle,
+	/// which replace it by a copy if it is shared with a copy of the frame or a snapshot. The snapshot keeps it across these calls.
 	///
 	const std::map<uint32_t, uint32_t> & getVisibility() const;
 
+	/// @brief Get all cloud point visibilities, unchanged by later modifications of the visibilities of the frame
+	SRef<const std::map<uint32_t, uint32_t>> getVisibilitySnapshot() const;
+
+	///
+	/// @brief Get all cloud point visibilities indexed by keypoint id
+	/// Not thread-safe: the reference is not protected against a concurrent modification of the visibilities, use getDenseVisibilitySnapshot instead.
+	/// @return the id of the cloud point seen by each keypoint, NO_VISIBILITY if none. Keypoints beyond the end of the vector see no cloud point.
+	/// The vector is valid until the next call to setVisibility, addVisibility, addVisibilities, removeVisibility or recycle,
+	/// which replace it by a copy if it is shared with a copy of the frame or a snapshot. The snapshot keeps it across these calls.
+	///
+	const std::vector<uint32_t> & getDenseVisibility() const;
+
+	/// @brief Get all cloud point visibilities indexed by keypoint id, unchanged by later modifications of the visibilities of the frame
+	SRef<const std::vector<uint32_t>> getDenseVisibilitySnapshot() const;
+
+	/// @brief Get the cloud point seen by a keypoint
+	/// @param[in] id_keypoint: id of keypoint
+	/// @param[out] id_cloudPoint: id of cloud point
+	/// @return true if the keypoint sees a cloud point
+	bool getVisibility(const uint32_t& id_keypoint, uint32_t& id_cloudPoint) const;
+
+	/// @brief Get the number of keypoints seeing a cloud point
+	uint32_t getNbVisibilities() const;
+
 	/// @brief set visibility
 	/// @param[in] visibilities: a map of cloud pont visibilities, the first element is keypoint id, the second one is cloud point id
 	void setVisibility(const std::map<uint32_t, uint32_t> &visibilities);
@@ -186,6 +269,7 @@ public:
 private:
 	friend class boost::serialization::access;
     friend class KeyframeCollection;
+    friend class FramePool;
     template<typename Archive>
 	void serialize(Archive &ar, const unsigned int version);
 
@@ -194,22 +278,54 @@ private:
     ///
     void nextSerializationWithoutImage();
 
+    ///
+    /// @brief Reset the frame to an empty frame, keeping the storage of its keypoints, visibilities and unshared descriptors
+    ///
+    void recycle();
+
+    void buildMapVisibility() const;
+    void setDenseVisibility(const std::map<uint32_t, uint32_t>& visibilities);
+
+    ///
+    /// @brief A mutex which is not copied with the frame: a copy of a frame has its own locks
+    ///
+    template <typename Mutex>
+    struct FrameMutex : public Mutex {
+        FrameMutex() = default;
+        FrameMutex(const FrameMutex &) : Mutex() {}
+        FrameMutex & operator=(const FrameMutex &) { return *this; }
+    };
+
 protected:
     Transform3Df                    m_pose;    
     SRef<Image>                     m_view;
-    std::vector<uint32_t>           m_maskIDs;
+    CopyOnWrite<std::vector<uint32_t>>  m_maskIDs;
     SRef<Keyframe>                  m_referenceKeyFrame ;
     SRef<DescriptorBuffer>          m_descriptors;
     SRef<GlobalDescriptor>          m_globalDescriptor;
-    std::vector<Keypoint>			m_keypoints;
-    std::vector<Keypoint>			m_keypointsUndistort;
+    CopyOnWrite<std::vector<Keypoint>>  m_keypoints;
+    CopyOnWrite<std::vector<Keypoint>>  m_keypointsUndistort;
+    mutable SRef<KeypointGrid>      m_keypointGrid;
+    mutable SRef<KeypointSet>       m_keypointSet;
+    mutable SRef<KeypointSet>       m_keypointSetUndistort;
     std::string                     m_imageName;
     uint32_t                        m_camID;
     bool							m_isFixedPose = false;
     bool                            m_serializeImage = true;
 
-	//A map storing the 3D points visibility, where the first element corresponds to the index of the keypoint of the frame, and the second element to the index of the corresponding cloudPoint.
-	std::map<uint32_t, uint32_t>	m_mapVisibility;
+	//The 3D points visibility: the index of the cloudPoint seen by each keypoint of the frame, NO_VISIBILITY if none.
+	CopyOnWrite<std::vector<uint32_t>>  m_visibility;
+	uint32_t                        m_nbVisibilities = 0;
+	//The same visibility as a map from keypoint index to cloudPoint index, built by getVisibility
+	mutable CopyOnWrite<std::map<uint32_t, uint32_t>>   m_mapVisibility;
+	mutable bool                    m_hasMapVisibility = false;
+
+    // locks of this frame: readers of the keypoints and of the visibilities share their lock
+    mutable FrameMutex<std::mutex>          m_mutexPose;
+    mutable FrameMutex<std::shared_mutex>   m_mutexKeypoint;
+    mutable FrameMutex<std::mutex>          m_mutexReferenceKeyframe;
+    mutable FrameMutex<std::mutex>          m_mutexDescriptors;
+    mutable FrameMutex<std::shared_mutex>   m_mutexVisibility;
 };
 
 DECLARESERIALIZE(Frame);
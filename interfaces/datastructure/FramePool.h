@@ -0,0 +1,64 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SOLAR_FRAMEPOOL_H
+#define SOLAR_FRAMEPOOL_H
+
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/Frame.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class FramePool
+ * @brief <B>A pool of frames recycled once released.</B>
+ *
+ * acquire returns an empty frame which goes back to the pool when its last reference is dropped.
+ * A recycled frame keeps the capacity of its keypoint and visibility vectors, and its descriptor buffer when it is not shared,
+ * so that a tracking loop creating a frame per image runs without allocating them again.
+ * The pool can be destroyed before the frames it handed out: they are then deleted when released.
+ */
+class SOLARFRAMEWORK_API FramePool {
+public:
+    /// @brief FramePool constructor
+    /// @param[in] maxFreeFrames the maximum number of released frames kept for recycling
+    explicit FramePool(uint32_t maxFreeFrames = 8);
+
+    FramePool(const FramePool &) = delete;
+    FramePool & operator=(const FramePool &) = delete;
+
+    ~FramePool() = default;
+
+    /// @brief return an empty frame, recycled if a released frame is available
+    SRef<Frame> acquire();
+
+    /// @brief return the number of released frames kept for recycling
+    uint32_t getNbFreeFrames() const;
+
+    /// @brief delete the released frames kept for recycling
+    void clear();
+
+private:
+    struct FreeFrames;
+    SRef<FreeFrames> m_freeFrames;
+};
+
+}
+}
+
+#endif // SOLAR_FRAMEPOOL_H
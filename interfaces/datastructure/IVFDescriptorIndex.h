@@ -0,0 +1,131 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file */
+
+#ifndef SOLAR_IVFDESCRIPTORINDEX_H
+#define SOLAR_IVFDESCRIPTORINDEX_H
+
+#include <unordered_map>
+
+#include <datastructure/DescriptorIndex.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class IVFDescriptorIndex
+ * @brief <B>An inverted file index of real valued descriptors (SIFT, SIFT_UINT8, SURF, DISK).</B>
+ *
+ * The descriptor space is partitioned by a k-means coarse quantizer of nbLists centroids. Each descriptor is
+ * stored in the list of its nearest centroid, and a query only scans the nbProbes lists nearest to it,
+ * so that the search cost is about nbProbes / nbLists of a brute force search.
+ *
+ * Until it is trained the index is a single list searched by brute force. Training is explicit: once the index
+ * holds about TRAINING_FACTOR x nbLists descriptors, train() learns the coarse quantizer on them. It can be called
+ * again later, e.g. from a background task, to adapt the lists to the descriptors added since.
+ */
+class SOLARFRAMEWORK_API IVFDescriptorIndex : public DescriptorIndex {
+public:
+    /// @brief number of descriptors per list used to train the coarse quantizer
+    static constexpr uint32_t TRAINING_FACTOR = 40;
+
+    IVFDescriptorIndex() = default;
+
+    /// @brief IVFDescriptorIndex constructor
+    /// @param[in] descriptorType the type of the indexed descriptors, compared with the euclidean distance
+    /// @param[in] nbLists the number of lists, typically about the square root of the number of descriptors
+    /// @param[in] nbProbes the number of lists scanned by a query. The higher, the more accurate and the slower.
+    IVFDescriptorIndex(DescriptorType descriptorType, uint32_t nbLists, uint32_t nbProbes = 8);
+
+    ~IVFDescriptorIndex() override = default;
+
+    SRef<DescriptorIndex> clone() const override;
+
+    /// @brief train the coarse quantizer, and distribute the descriptors already indexed in the lists
+    /// @param[in] descriptors the training descriptors, at least nbLists
+    /// @param[in] nbIterations the number of k-means iterations
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode train(const DescriptorBuffer & descriptors, uint32_t nbIterations = 10);
+
+    /// @brief train or retrain the coarse quantizer on the descriptors already indexed, at least nbLists
+    /// @param[in] nbIterations the number of k-means iterations
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode train(uint32_t nbIterations = 10) override;
+
+    /// @brief return true if the coarse quantizer is trained
+    bool isTrained() const { return !m_centroids.empty(); }
+
+    /// @brief return the number of lists
+    uint32_t getNbLists() const { return m_nbLists; }
+
+    /// @brief return the number of lists scanned by a query
+    uint32_t getNbProbes() const { return m_nbProbes; }
+
+    /// @brief set the number of lists scanned by a query
+    void setNbProbes(uint32_t nbProbes) { m_nbProbes = nbProbes; }
+
+    FrameworkReturnCode search(const DescriptorView & query, uint32_t k,
+                               std::vector<std::pair<uint32_t, float>> & neighbours) const override;
+
+    void compact() override;
+
+protected:
+    void insert(uint32_t id, const DescriptorView & descriptor) override;
+
+    bool update(uint32_t id, const DescriptorView & descriptor) override;
+
+    bool isIndexed(uint32_t id) const override { return m_slots.find(id) != m_slots.end(); }
+
+    uint32_t getNbEntries() const override { return m_nbEntries; }
+
+private:
+    /// id of a slot whose descriptor moved to another list, skipped by the searches until compact()
+    static constexpr uint32_t MOVED_ID = UINT32_MAX;
+
+    /// index of the nearest list of a descriptor
+    uint32_t findList(const DescriptorView & descriptor) const;
+
+    /// move all the descriptors to the lists of their nearest centroids
+    void distribute();
+
+    /// rebuild the slots of the ids from the lists
+    void buildSlots();
+
+    friend class boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive &ar, const unsigned int version);
+
+private:
+    uint32_t m_nbLists = 1;
+    uint32_t m_nbProbes = 1;
+    uint32_t m_nbEntries = 0;
+    std::vector<float> m_centroids;
+    std::vector<DescriptorBuffer> m_listDescriptors;
+    std::vector<std::vector<uint32_t>> m_listIds;
+    // (list, row) of each indexed id, rebuilt when the lists are reorganized
+    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> m_slots;
+    uint32_t m_nbMoved = 0;
+};
+
+DECLARESERIALIZE(IVFDescriptorIndex);
+
+}
+}
+
+BOOST_CLASS_EXPORT_KEY(SolAR::datastructure::IVFDescriptorIndex);
+
+#endif // SOLAR_IVFDESCRIPTORINDEX_H
@@ -21,7 +21,12 @@
 #include <core/SolARFrameworkDefinitions.h>
 #include <core/Messages.h>
 #include <datastructure/GeometryDefinitions.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <functional>
+#include <utility>
+#include <vector>
 #include <core/SerializationDefinitions.h>
 #include <boost/serialization/export.hpp>
 
@@ -32,27 +37,65 @@ namespace datastructure {
 * @class ImageInternal
 * @brief <B>A 2D image buffer.</B>.
 *
+* The buffer's own storage is acquired from ImageBufferPool::instance() and is not initialized:
+* its content is undefined until it is written, and it goes back to the pool when the buffer is destroyed or grows.
+* The buffer can also wrap external memory without copy (borrowed memory released through a callback).
+* Such memory is copied into the buffer's own storage (copy-on-write) before any modification,
+* i.e. as soon as the non-const data() is called or the buffer is resized.
+* The copy is made once even if several threads call the non-const data() concurrently, and the external memory is
+* released with the buffer or by setData only, so that a pointer returned by the const data() before the copy stays valid.
 */
 class SOLARFRAMEWORK_API ImageInternal {
 public:
 	ImageInternal() = default;
 	explicit ImageInternal(uint32_t size);
 	explicit ImageInternal(void* data, uint32_t size);
+
+    ImageInternal(const ImageInternal &) = delete;
+    ImageInternal & operator=(const ImageInternal &) = delete;
+
+    /// @brief wrap an external memory block without copying it
+    /// @param[in] data the external memory
+    /// @param[in] size the size in bytes of the external memory
+    /// @param[in] release called with data when the buffer is destroyed or overwritten by setData.
+    /// If empty, the caller must keep the memory alive as long as the buffer uses it.
+    ImageInternal(void* data, uint32_t size, std::function<void(void*)> release);
+
+    /// @brief adopt a vector without copying it
+    /// @param[in] data the vector moved into the buffer
+    explicit ImageInternal(std::vector<uint8_t> && data);
+
     virtual ~ImageInternal();
 	void setBufferSize(uint32_t size);
 	inline uint32_t getBufferSize() { return m_bufferSize; }
 	void setData(void * data, uint32_t size);
-	inline void* data() { return m_storageData.data(); }
-	inline const void* data() const { return m_storageData.data(); }
+    inline void* data() { detach(); return m_storageData.get(); }
+    inline const void* data() const { return isExternal() ? m_externalData.get() : m_storageData.get(); }
+
+    /// @brief return true if the pixels are read from external memory, i.e. it was not copied yet
+    inline bool isExternal() const { return m_externalData && !m_detached.load(std::memory_order_acquire); }
+
+    /// @brief copy the external memory into the buffer's own storage before a modification, once
+    void detach();
 
 private:
 	friend class boost::serialization::access;
 	template<typename Archive>
 	void serialize(Archive &ar, const unsigned int version);
 
+    /// @brief replace the storage by an uninitialized one of at least size bytes, unless it is already large enough
+    void reserveStorage(uint32_t size);
+
 private:
-	std::vector<uint8_t> m_storageData;
+    // own storage, pooled or adopted, of m_storageCapacity bytes
+    std::shared_ptr<uint8_t> m_storageData;
+    uint32_t m_storageCapacity = 0;
 	uint32_t m_bufferSize = 0;
+    // external memory, kept until the buffer is destroyed or overwritten even once copied into the storage
+    std::shared_ptr<uint8_t> m_externalData;
+    // true once the external memory is copied into the storage, which then holds the pixels
+    std::atomic<bool> m_detached{false};
+    std::mutex m_mutexDetach;
 };
 DECLARESERIALIZE(ImageInternal);
 
@@ -63,6 +106,9 @@ DECLARESERIALIZE(ImageInternal);
  * @brief <B>A 2D image.</B>.
  *
  * This class provides an image abstraction for SolAR
+ *
+ * Rows are separated by getStep() bytes, which is larger than the row size for a region of another image:
+ * such a region shares the memory of its parent image (see extractRegion()), and is compacted only when it is copied or serialized.
  */
 class SOLARFRAMEWORK_API Image {
 public:
@@ -115,6 +161,12 @@ public:
         DEGREE_270
     };
 
+    // Flip directions
+    enum class FlipDirection {
+        HORIZONTAL, /**< mirror the columns: left becomes right */
+        VERTICAL    /**< mirror the rows: top becomes bottom */
+    };
+
     Image() = default;
 
     /** @brief Image
@@ -145,6 +197,31 @@ public:
     Image(void* imageData, uint32_t width, uint32_t height, enum ImageLayout pixLayout, enum PixelOrder pixOrder,
           DataType type, ImageEncoding encoding = ENCODING_NONE);
 
+    /** @brief  Image wrapping a raw data pointer without copy
+     *  @param imageData: pointer to the raw data
+     *  @param width: width of the image
+     *  @param height: height of the image
+     *  @param pixLayout: defined by ImageLayout
+     *  @param pixOrder: defined if the data are stored interleaved RGB,RGB or as a planar representation RRR,GGG,BBB
+     *  @param type: defined by DataType
+     *  @param release: called with imageData when the image no longer uses it.
+     *  If empty, the caller must keep imageData alive as long as the image uses it.
+     *  The pixels are not copied: the image borrows the memory until it is modified (copy-on-write).
+     */
+    Image(void* imageData, uint32_t width, uint32_t height, enum ImageLayout pixLayout, enum PixelOrder pixOrder,
+          DataType type, std::function<void(void*)> release);
+
+    /** @brief  Image adopting a pixel buffer without copy
+     *  @param imageData: the raw pixels, moved into the image
+     *  @param width: width of the image
+     *  @param height: height of the image
+     *  @param pixLayout: defined by ImageLayout
+     *  @param pixOrder: defined if the data are stored interleaved RGB,RGB or as a planar representation RRR,GGG,BBB
+     *  @param type: defined by DataType
+     */
+    Image(std::vector<uint8_t> && imageData, uint32_t width, uint32_t height, enum ImageLayout pixLayout, enum PixelOrder pixOrder,
+          DataType type);
+
      /**  @brief  ~Image
       */
     ~Image() = default;
@@ -165,7 +242,8 @@ public:
      */
     void setSize(Sizei size);
 
-    /** @brief  get bytes size of underlying storage
+    /** @brief  get bytes size of underlying storage.
+     *  For a region of another image, the size of the memory spanned by the rows of the region.
      */
     uint32_t getBufferSize();
 
@@ -173,6 +251,7 @@ public:
     // use to wrap internal buffer data in other framework image wrapper for instance cv::Mat
 
     /** @brief never use this accessor to delete the underlying data !
+     *  Borrowed pixels are copied into the image's own storage before being returned (copy-on-write).
      */
     void* data();
 
@@ -180,15 +259,18 @@ public:
      */
     const void* data() const;
 
-    /** @brief extracts a subregion for tiling for interleaved data representation only
+    /** @brief extracts a subregion for tiling for interleaved data representation only.
+     *  The region is not copied: it shares the memory of the image, with the same step.
      *  @param region: defines the region to extract as a rectangle
-     *  @param channel: assumes planar representation of the image
+     *  @retval the region, or nullptr if the region is not inside the image
      */
     SRef<Image> extractRegion(Rectanglei region); // to handle in a splitter/extractor component, must not be handled in the image itself
 
-    /** @brief extracts a subregion for tiling for a single plane inside a multiplanar image
+    /** @brief extracts a subregion for tiling for a single plane inside a multiplanar image.
+     *  The region is a grey image sharing the memory of the plane, with the same step.
      *  @param region: defines the regoion to extract as a rectangle
      *  @param channel: assumes planar representation of the image
+     *  @retval the region, or nullptr if the region is not inside the image or the image is interleaved
      */
     SRef<Image> extractRegion(Rectanglei region, uint32_t channel);
 
@@ -224,7 +306,17 @@ public:
      */
     inline uint32_t getHeight() const { return m_size.height; }
 
-    inline uint32_t getStep() const { return m_size.width * m_nbChannels * (m_nbBitsPerComponent/8); }
+    /** @brief  returns the number of bytes between the start of two consecutive rows
+     */
+    inline uint32_t getStep() const { return (m_rowStride > 0) ? m_rowStride : m_size.width * getPixelSize(); }
+
+    /** @brief  returns true if the rows are stored without padding between them
+     */
+    inline bool isContinuous() const { return getStep() == m_size.width * getPixelSize(); }
+
+    /** @brief  returns true if the image is a region sharing the memory of another image
+     */
+    inline bool isRegion() const { return (m_offset > 0) || (m_rowStride > 0); }
 
     /** @brief  set encoding for the image
      */
@@ -243,6 +335,10 @@ public:
      */
     inline uint8_t getImageEncodingQuality() const { return m_imageEncodingQuality; }
 
+    /** @brief  returns true if the pixels are stored in borrowed memory (no copy was made)
+     */
+    inline bool isBorrowed() const { return m_internalImpl && m_internalImpl->isExternal(); }
+
 	/// @brief Get pixel value.
 	/// @param[in] row row index.
 	/// @param[in] col column index.
@@ -277,6 +373,42 @@ public:
     /// @return _SUCCESS if the image is rotated, _ERROR_ otherwise.
     FrameworkReturnCode rotate270();
 
+    /// @brief Rotate image clockwise by a multiple of 90 degrees, without resampling
+    /// @return _SUCCESS if the image is rotated, _ERROR_ otherwise.
+    FrameworkReturnCode rotate(RotateQuantity degrees);
+
+    /// @brief Rotate image clockwise by a multiple of 90 degrees into another image, without resampling.
+    /// The destination takes the format of the image, and keeps its storage if it is large enough.
+    /// @param[in] degrees the rotation
+    /// @param[out] destination the rotated image
+    /// @return _SUCCESS if the image is rotated, _ERROR_ otherwise.
+    FrameworkReturnCode rotate(RotateQuantity degrees, Image & destination) const;
+
+    /// @brief Rotate image clockwise by any angle around its center, keeping its size.
+    /// Multiples of 90 degrees are rotated without resampling, other angles are resampled with OpenImageIO.
+    /// @param[in] angle the angle in degrees
+    /// @return _SUCCESS if the image is rotated, _ERROR_ otherwise.
+    FrameworkReturnCode rotate(float angle);
+
+    /// @brief Flip image
+    /// @return _SUCCESS if the image is flipped, _ERROR_ otherwise.
+    FrameworkReturnCode flip(FlipDirection direction);
+
+    /// @brief Flip image into another image.
+    /// The destination takes the format of the image, and keeps its storage if it is large enough.
+    /// @param[in] direction the flip direction
+    /// @param[out] destination the flipped image
+    /// @return _SUCCESS if the image is flipped, _ERROR_ otherwise.
+    FrameworkReturnCode flip(FlipDirection direction, Image & destination) const;
+
+    /// @brief Encode concurrently the JPEG or PNG images, so that their next serialization on the calling thread only writes the encoded bytes.
+    /// The images must not be modified until they are serialized or clearPreEncoded() is called.
+    /// @param[in] images the images, those without JPEG or PNG encoding are ignored
+    static void preEncode(const std::vector<SRef<Image>> & images);
+
+    /// @brief Discard the encodings made by preEncode() on the calling thread and not serialized yet
+    static void clearPreEncoded();
+
 private:
     friend class boost::serialization::access;
 protected:
@@ -296,9 +428,40 @@ protected:
 private:
     SRef<ImageInternal> m_internalImpl;
 
-    uint32_t computeImageBufferSize();
+    uint32_t computeImageBufferSize() const;
+
+    inline uint32_t getPixelSize() const { return m_nbChannels * (m_nbBitsPerComponent / 8); }
+
+    /// @brief copy the pixels to dst without padding between rows
+    void copyPixels(void* dst) const;
+
+    /// @brief return the pixels without padding between rows, compacted in storage if the rows are padded
+    const void* getContinuousData(std::vector<uint8_t>& storage) const;
+
+    /// @brief encode the pixels with the image encoding, using an encoder of the calling thread
+    /// @return _SUCCESS, _NOT_IMPLEMENTED if the encoder cannot write to memory, _ERROR_ otherwise
+    FrameworkReturnCode encode(std::vector<uint8_t>& encodedData) const;
+
+    /// @brief decode the pixels from encoded data, using a decoder of the calling thread
+    /// @return _SUCCESS, _ERROR_LOAD_IMAGE if the data cannot be decoded
+    FrameworkReturnCode decode(const void* encodedData, size_t size, enum ImageEncoding encoding);
+
+    // pixel transformations without resampling
+    enum class Transformation {
+        COPY,
+        ROTATE_90,
+        ROTATE_180,
+        ROTATE_270,
+        FLIP_HORIZONTAL,
+        FLIP_VERTICAL
+    };
+
+    /// @brief transform the pixels into destination, which takes the format of the image
+    FrameworkReturnCode transform(Transformation transformation, Image & destination) const;
+
+    /// @brief transform the pixels into a new storage of the image
+    FrameworkReturnCode transform(Transformation transformation);
 
-    FrameworkReturnCode rotate(RotateQuantity);
     Sizei m_size;
     enum ImageLayout m_layout;
     enum PixelOrder m_pixOrder;
@@ -309,6 +472,10 @@ private:
 
     enum ImageEncoding m_imageEncoding = ENCODING_NONE;
     uint8_t m_imageEncodingQuality = 70;
+
+    // row stride in bytes (0 for rows without padding) and offset in bytes of the first pixel in m_internalImpl
+    uint32_t m_rowStride = 0;
+    uint32_t m_offset = 0;
 };
 DECLARESERIALIZE(Image);
 
@@ -316,14 +483,14 @@ template<typename T>
 inline T & Image::getPixel(int row, int col)
 {
 	assert((sizeof(T) == m_nbChannels * (m_nbBitsPerComponent / 8)) && "type not allowed to get pixel value");
-	return ((T*)((uint8_t*)m_internalImpl->data() + (row * m_size.width + col) * m_nbChannels * (m_nbBitsPerComponent / 8)))[0];
+	return ((T*)((uint8_t*)m_internalImpl->data() + m_offset + row * getStep() + col * getPixelSize()))[0];
 }
 
 template<typename T>
 inline const T & Image::getPixel(int row, int col) const
 {
 	assert((sizeof(T) == m_nbChannels * (m_nbBitsPerComponent / 8)) && "type not allowed to get pixel value");
-	return ((const T*)((uint8_t*)m_internalImpl->data() + (row * m_size.width + col) * m_nbChannels * (m_nbBitsPerComponent / 8)))[0];
+	return ((const T*)((const uint8_t*)std::as_const(*m_internalImpl).data() + m_offset + row * getStep() + col * getPixelSize()))[0];
 }
 
 //image creation from opencv conversion ... : howto handle memory allocation locality : factory ?
@@ -340,5 +507,6 @@ boost::serialization::extended_type_info_typeid<SolAR::datastructure::Image>
 )
 BOOST_CLASS_EXPORT_KEY(SolAR::datastructure::Image);
 BOOST_CLASS_EXPORT_KEY(SolAR::datastructure::ImageInternal);
+BOOST_CLASS_VERSION(SolAR::datastructure::Image, 1);
 
 #endif
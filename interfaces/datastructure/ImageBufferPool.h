@@ -0,0 +1,83 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SOLAR_IMAGEBUFFERPOOL_H
+#define SOLAR_IMAGEBUFFERPOOL_H
+
+#include <cstdint>
+#include <memory>
+#include <xpcf/core/refs.h>
+#include <core/SolARFrameworkDefinitions.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class ImageBufferPool
+ * @brief <B>A pool of uninitialized pixel buffers recycled once released.</B>
+ *
+ * acquire returns a buffer whose content is not initialized, so that an image filled by a decoder or a convertor
+ * is not zero-filled first. Buffer sizes are rounded up to a size class (four classes per power of two),
+ * and a buffer goes back to the pool of its class when its last reference is dropped,
+ * unless the pool already keeps its maximum number of free buffers or bytes.
+ * The pool can be destroyed before the buffers it handed out: they are then deleted when released.
+ */
+class SOLARFRAMEWORK_API ImageBufferPool {
+public:
+    /// @brief ImageBufferPool constructor
+    /// @param[in] maxFreeBytes the maximum number of bytes of the released buffers kept for recycling
+    /// @param[in] maxFreeBuffersPerSizeClass the maximum number of released buffers of a size class kept for recycling
+    explicit ImageBufferPool(uint64_t maxFreeBytes = 256 * 1024 * 1024, uint32_t maxFreeBuffersPerSizeClass = 4);
+
+    ImageBufferPool(const ImageBufferPool &) = delete;
+    ImageBufferPool & operator=(const ImageBufferPool &) = delete;
+
+    ~ImageBufferPool() = default;
+
+    /// @brief return the pool used for the storage of the images
+    static ImageBufferPool & instance();
+
+    /// @brief return the capacity of the buffers returned for a size, i.e. the size rounded up to its size class
+    static uint32_t getCapacity(uint32_t size);
+
+    /// @brief return an uninitialized buffer of getCapacity(size) bytes, recycled if a released buffer of this size class is available
+    /// @return the buffer, nullptr if size is 0
+    std::shared_ptr<uint8_t> acquire(uint32_t size);
+
+    /// @brief set the limits of the released buffers kept for recycling, and delete the buffers exceeding them
+    /// @param[in] maxFreeBytes the maximum number of bytes of the released buffers kept for recycling, 0 to disable recycling
+    /// @param[in] maxFreeBuffersPerSizeClass the maximum number of released buffers of a size class kept for recycling
+    void setLimits(uint64_t maxFreeBytes, uint32_t maxFreeBuffersPerSizeClass);
+
+    /// @brief return the number of released buffers kept for recycling
+    uint32_t getNbFreeBuffers() const;
+
+    /// @brief return the number of bytes of the released buffers kept for recycling
+    uint64_t getNbFreeBytes() const;
+
+    /// @brief delete the released buffers kept for recycling
+    void clear();
+
+private:
+    struct FreeBuffers;
+    SRef<FreeBuffers> m_freeBuffers;
+};
+
+}
+}
+
+#endif // SOLAR_IMAGEBUFFERPOOL_H
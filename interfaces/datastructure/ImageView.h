@@ -0,0 +1,117 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SOLAR_IMAGEVIEW_H
+#define SOLAR_IMAGEVIEW_H
+
+#include <cassert>
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/Image.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class ImageView
+ * @brief <B>A non-owning view on the pixels of an interleaved image or of one of its regions.</B>
+ *
+ * A view references the memory of an image with an offset and a row step, so that tiles, crops or masks
+ * are processed without copy. It does not keep the image alive: the image must outlive its views,
+ * and must not be resized while they are used.
+ */
+class SOLARFRAMEWORK_API ImageView {
+public:
+    ImageView() = default;
+
+    /// @brief ImageView constructor on a whole interleaved image.
+    /// Borrowed pixels of the image are copied into its own storage first (see Image::data()).
+    /// @param[in] image the image, an empty view is built if its pixels are not interleaved
+    explicit ImageView(Image & image);
+
+    /// @brief return a view on a region of this view, without copy
+    /// @param[in] region the region, in the coordinates of this view
+    /// @return the view on the region, an empty view if the region is not inside this view
+    ImageView extractRegion(const Rectanglei & region) const;
+
+    /// @brief return a copy of the pixels of the view in a new image without padding between rows
+    SRef<Image> toImage() const;
+
+    /// @brief return true if the view does not reference any pixel
+    inline bool isEmpty() const { return (m_data == nullptr) || (m_size.width == 0) || (m_size.height == 0); }
+
+    inline void* data() { return m_data; }
+    inline const void* data() const { return m_data; }
+
+    /// @brief return the first pixel of a row
+    inline uint8_t* getRow(uint32_t row) { return m_data + static_cast<size_t>(row) * m_step; }
+    inline const uint8_t* getRow(uint32_t row) const { return m_data + static_cast<size_t>(row) * m_step; }
+
+    /// @brief Get pixel value.
+    /// @param[in] row row index.
+    /// @param[in] col column index.
+    /// @return the pixel value
+    template<typename T> T& getPixel(int row, int col);
+
+    /// @brief Get pixel value.
+    /// @param[in] row row index.
+    /// @param[in] col column index.
+    /// @return the pixel value
+    template<typename T> const T& getPixel(int row, int col) const;
+
+    inline Sizei getSize() const { return m_size; }
+    inline uint32_t getWidth() const { return m_size.width; }
+    inline uint32_t getHeight() const { return m_size.height; }
+
+    /// @brief return the number of bytes between the start of two consecutive rows
+    inline uint32_t getStep() const { return m_step; }
+
+    inline enum Image::ImageLayout getImageLayout() const { return m_layout; }
+    inline enum Image::DataType getDataType() const { return m_type; }
+    inline uint32_t getNbChannels() const { return m_nbChannels; }
+    inline uint32_t getNbBitsPerComponent() const { return m_nbBitsPerComponent; }
+
+private:
+    inline uint32_t getPixelSize() const { return m_nbChannels * (m_nbBitsPerComponent / 8); }
+
+private:
+    uint8_t* m_data = nullptr;
+    Sizei m_size = {0, 0};
+    uint32_t m_step = 0;
+    enum Image::ImageLayout m_layout = Image::ImageLayout::LAYOUT_UNDEFINED;
+    enum Image::DataType m_type = Image::DataType::TYPE_8U;
+    uint32_t m_nbChannels = 0;
+    uint32_t m_nbBitsPerComponent = 0;
+};
+
+template<typename T>
+inline T & ImageView::getPixel(int row, int col)
+{
+    assert((sizeof(T) == getPixelSize()) && "type not allowed to get pixel value");
+    return *reinterpret_cast<T*>(getRow(row) + col * getPixelSize());
+}
+
+template<typename T>
+inline const T & ImageView::getPixel(int row, int col) const
+{
+    assert((sizeof(T) == getPixelSize()) && "type not allowed to get pixel value");
+    return *reinterpret_cast<const T*>(getRow(row) + col * getPixelSize());
+}
+
+}
+}
+
+#endif // SOLAR_IMAGEVIEW_H
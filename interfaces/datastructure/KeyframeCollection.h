@@ -4,6 +4,7 @@
 #include <core/SolARFrameworkDefinitions.h>
 #include <datastructure/GeometryDefinitions.h>
 #include <datastructure/Keyframe.h>
+#include <datastructure/DescriptorIndex.h>
 #include <datastructure/Lockable.h>
 #include <core/Messages.h>
 #include <xpcf/core/refs.h>
@@ -23,7 +24,6 @@ namespace datastructure {
 */
 class  SOLARFRAMEWORK_API KeyframeCollection : public Lockable {
 public:
-
 	///
 	/// @brief KeyframeCollection constructor.
 	///
@@ -109,7 +109,39 @@ public:
     /// @return The number of keyframes having image data
     uint32_t getNbKeyframesHavingImage() const;
 
+    /// @brief This method allows to get the nearest neighbour index of the descriptors of the keyframes
+    /// @return the index, nullptr if the descriptors are not indexed
+    const SRef<SolAR::datastructure::DescriptorIndex> & getDescriptorIndex() const;
+
+    /// @brief This method allows to set the nearest neighbour index of the descriptors of the keyframes.
+    /// The descriptors of the keyframes already stored are added to the index, which is then kept up to date when keyframes are added or suppressed.
+    /// An index which needs training (e.g. IVFDescriptorIndex) is not trained implicitly: call getDescriptorIndex()->train() once enough keyframes are indexed.
+    /// The descriptors of a keyframe are identified in the index by a range of consecutive ids allocated to this keyframe (see getDescriptorIndexId).
+    /// @param[in] index the index, empty, nullptr to stop indexing the descriptors
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR.
+    FrameworkReturnCode setDescriptorIndex(const SRef<SolAR::datastructure::DescriptorIndex> index);
+
+    /// @brief This method returns the id of a keyframe descriptor in the descriptor index
+    /// @param[in] keyframeId the id of the keyframe
+    /// @param[in] keypointIndex the index of the descriptor in the keyframe
+    /// @param[out] descriptorIndexId the id of the descriptor in the index
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR if the descriptor is not indexed
+    FrameworkReturnCode getDescriptorIndexId(const uint32_t keyframeId, const uint32_t keypointIndex, uint32_t & descriptorIndexId) const;
+
+    /// @brief This method returns the keyframe and the index in this keyframe of a descriptor of the descriptor index
+    /// @param[in] descriptorIndexId the id of the descriptor in the index
+    /// @param[out] keyframeId the id of the keyframe
+    /// @param[out] keypointIndex the index of the descriptor in the keyframe
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR if the id is not allocated to a keyframe
+    FrameworkReturnCode getKeyframeDescriptor(const uint32_t descriptorIndexId, uint32_t & keyframeId, uint32_t & keypointIndex) const;
+
 private:
+    /// @brief add or remove the descriptors of a keyframe in the descriptor index if any
+    void indexKeyframe(const SRef<SolAR::datastructure::Keyframe> & keyframe, bool remove = false);
+
+    /// @brief remove the descriptors of a keyframe from the descriptor index and release its range of ids
+    void releaseDescriptorIndexRange(const uint32_t keyframeId);
+
     /// @brief This method allows to make reference keyframes consistent 
     /// (e.g. this method can be called after having loaded a keyframe collection which may contain inconsistent ref keyframes)
     void regularizeReferenceKeyframes();
@@ -133,6 +165,10 @@ private:
     SolAR::datastructure::DescriptorType                    m_descriptorType;
     uint32_t                                                m_id = 0;
     std::map<uint32_t, std::set<uint32_t>>                  m_refKeyframeToKeyframes; // map from ref keyframe id to IDs of keyframes inside which it is referenced
+    SRef<SolAR::datastructure::DescriptorIndex>             m_descriptorIndex;
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>>       m_descriptorIndexRanges; // map from keyframe id to the first id and the number of ids of its descriptors in the index
+    std::map<uint32_t, uint32_t>                            m_descriptorIndexRangeKeyframes; // map from the first id of a range to its keyframe id
+    uint32_t                                                m_nextDescriptorIndexId = 0;
 };
 
 DECLARESERIALIZE(KeyframeCollection);
@@ -140,6 +176,6 @@ DECLARESERIALIZE(KeyframeCollection);
 }
 }  // end of namespace SolAR
 
-BOOST_CLASS_VERSION(SolAR::datastructure::KeyframeCollection, 1);
+BOOST_CLASS_VERSION(SolAR::datastructure::KeyframeCollection, 2);
 
 #endif // KEYFRAMECOLLECTION_H
@@ -0,0 +1,95 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file */
+
+#ifndef SOLAR_KEYPOINTGRID_H
+#define SOLAR_KEYPOINTGRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/GeometryDefinitions.h>
+#include <datastructure/Keypoint.h>
+#include <datastructure/KeypointSet.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class KeypointGrid
+ * @brief <B>A uniform grid of 2D points for radius searches.</B>
+ *
+ * The points are bucketed into square cells, stored contiguously cell by cell. A radius search only visits the cells
+ * overlapping the bounding box of the search circle, instead of all the points.
+ * A grid is immutable: it is rebuilt when the points change.
+ */
+class SOLARFRAMEWORK_API KeypointGrid {
+public:
+    KeypointGrid() = default;
+
+    /// @brief KeypointGrid constructor
+    /// @param[in] points the points to index
+    /// @param[in] cellSize the side of the cells in pixels, 0 to choose it from the density of the points
+    explicit KeypointGrid(const std::vector<Point2Df> & points, float cellSize = 0.f);
+
+    /// @brief KeypointGrid constructor
+    /// @param[in] keypoints the keypoints to index
+    /// @param[in] cellSize the side of the cells in pixels, 0 to choose it from the density of the keypoints
+    explicit KeypointGrid(const std::vector<Keypoint> & keypoints, float cellSize = 0.f);
+
+    /// @brief KeypointGrid constructor
+    /// @param[in] keypoints the keypoints to index
+    /// @param[in] cellSize the side of the cells in pixels, 0 to choose it from the density of the keypoints
+    explicit KeypointGrid(const KeypointSet & keypoints, float cellSize = 0.f);
+
+    ~KeypointGrid() = default;
+
+    /// @brief return the number of indexed points
+    uint32_t getNbPoints() const { return static_cast<uint32_t>(m_indices.size()); }
+
+    /// @brief return the side of the cells in pixels
+    float getCellSize() const { return m_cellSize; }
+
+    /// @brief get the points at a distance less or equal than radius from a center
+    /// @param[in] center the center of the search region
+    /// @param[in] radius the radius of the search region, negative to get all the points
+    /// @param[out] indices the indices of the points in the indexed vector, in increasing order
+    void getPointsInRadius(const Point2Df & center, float radius, std::vector<uint32_t> & indices) const;
+
+private:
+    // x(i) and y(i) return the coordinates of the i-th point
+    template <typename X, typename Y>
+    void build(uint32_t nbPoints, const X & x, const Y & y, float cellSize);
+
+private:
+    float m_cellSize = 1.f;
+    float m_minX = 0.f;
+    float m_minY = 0.f;
+    uint32_t m_nbCols = 0;
+    uint32_t m_nbRows = 0;
+    // points of cell c: [m_cellStarts[c], m_cellStarts[c+1]) in m_indices and m_coordinates
+    std::vector<uint32_t> m_cellStarts;
+    std::vector<uint32_t> m_indices;
+    // x and y of the points, in cell order
+    std::vector<float> m_coordinates;
+};
+
+}
+}
+
+#endif // SOLAR_KEYPOINTGRID_H
@@ -0,0 +1,168 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file */
+
+#ifndef SOLAR_KEYPOINTSET_H
+#define SOLAR_KEYPOINTSET_H
+
+#include <cstdint>
+#include <vector>
+
+#include <core/SerializationDefinitions.h>
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/GeometryDefinitions.h>
+#include <datastructure/Keypoint.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class KeypointSet
+ * @brief <B>A set of keypoints stored as a structure of arrays.</B>
+ *
+ * The coordinates of the keypoints are stored in two contiguous arrays of floats, and each other attribute in its own
+ * optional column. Loops on the coordinates (projection, undistortion, spatial indexing) read 8 bytes per keypoint
+ * instead of a whole Keypoint, and can be vectorized.
+ * getKeypoint and toKeypoints give back Keypoint objects for the existing APIs; absent attributes take their default values.
+ */
+class SOLARFRAMEWORK_API KeypointSet {
+public:
+    /// @brief attribute columns stored besides the coordinates
+    enum Attributes : uint32_t {
+        NONE = 0,
+        ID = 1,
+        SIZE = 1 << 1,
+        ANGLE = 1 << 2,
+        RESPONSE = 1 << 3,
+        OCTAVE = 1 << 4,
+        CLASS_ID = 1 << 5,
+        RGB = 1 << 6,
+        DEPTH = 1 << 7,
+        ALL = (1 << 8) - 1
+    };
+
+    KeypointSet() = default;
+
+    /// @brief KeypointSet constructor
+    /// @param[in] attributes the attribute columns of the set, a combination of Attributes
+    explicit KeypointSet(uint32_t attributes);
+
+    /// @brief KeypointSet constructor
+    /// @param[in] keypoints the keypoints to copy
+    /// @param[in] attributes the attribute columns of the set, a combination of Attributes
+    explicit KeypointSet(const std::vector<Keypoint> & keypoints, uint32_t attributes = ALL);
+
+    ~KeypointSet() = default;
+
+    /// @brief return the number of keypoints
+    uint32_t size() const { return static_cast<uint32_t>(m_x.size()); }
+
+    /// @brief return true if the set has no keypoint
+    bool empty() const { return m_x.empty(); }
+
+    /// @brief return the attribute columns of the set, a combination of Attributes
+    uint32_t getAttributes() const { return m_attributes; }
+
+    /// @brief return true if the set stores all the given attribute columns
+    bool hasAttributes(uint32_t attributes) const { return (m_attributes & attributes) == attributes; }
+
+    /// @brief reserve memory for a number of keypoints
+    void reserve(uint32_t nbKeypoints);
+
+    /// @brief remove all the keypoints
+    void clear();
+
+    /// @brief append a keypoint, only its attributes stored by the set are kept
+    void append(const Keypoint & keypoint);
+
+    /// @brief append a point with the default values of the attributes
+    void append(float x, float y);
+
+    /// @brief return the x coordinates of the keypoints
+    const std::vector<float> & getX() const { return m_x; }
+
+    /// @brief return the y coordinates of the keypoints
+    const std::vector<float> & getY() const { return m_y; }
+
+    /// @brief return the x coordinates of the keypoints for modification, an array of size() floats
+    /// The keypoints are only added or removed through the set, so that all its columns keep the same size.
+    float * getXData() { return m_x.data(); }
+
+    /// @brief return the y coordinates of the keypoints for modification, an array of size() floats
+    float * getYData() { return m_y.data(); }
+
+    /// @brief return the ids of the keypoints, empty if the column is not stored
+    const std::vector<uint32_t> & getIds() const { return m_ids; }
+
+    /// @brief return the sizes of the keypoints, empty if the column is not stored
+    const std::vector<float> & getSizes() const { return m_sizes; }
+
+    /// @brief return the angles of the keypoints, empty if the column is not stored
+    const std::vector<float> & getAngles() const { return m_angles; }
+
+    /// @brief return the responses of the keypoints, empty if the column is not stored
+    const std::vector<float> & getResponses() const { return m_responses; }
+
+    /// @brief return the octaves of the keypoints, empty if the column is not stored
+    const std::vector<int> & getOctaves() const { return m_octaves; }
+
+    /// @brief return the class ids of the keypoints, empty if the column is not stored
+    const std::vector<int> & getClassIds() const { return m_classIds; }
+
+    /// @brief return the colors of the keypoints (r, g, b interleaved), empty if the column is not stored
+    const std::vector<float> & getColors() const { return m_colors; }
+
+    /// @brief return the depths of the keypoints, empty if the column is not stored
+    const std::vector<float> & getDepths() const { return m_depths; }
+
+    /// @brief return the coordinates of the i-th keypoint
+    Point2Df getPoint(uint32_t i) const { return Point2Df(m_x[i], m_y[i]); }
+
+    /// @brief return the i-th keypoint
+    Keypoint getKeypoint(uint32_t i) const;
+
+    /// @brief copy the keypoints into a vector of Keypoint
+    /// @param[out] keypoints the keypoints
+    void toKeypoints(std::vector<Keypoint> & keypoints) const;
+
+private:
+    friend class boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive &ar, const unsigned int version);
+
+private:
+    uint32_t m_attributes = ALL;
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<uint32_t> m_ids;
+    std::vector<float> m_sizes;
+    std::vector<float> m_angles;
+    std::vector<float> m_responses;
+    std::vector<int> m_octaves;
+    std::vector<int> m_classIds;
+    std::vector<float> m_colors;
+    std::vector<float> m_depths;
+};
+
+DECLARESERIALIZE(KeypointSet);
+
+}
+}
+
+BOOST_CLASS_EXPORT_KEY(SolAR::datastructure::KeypointSet);
+
+#endif // SOLAR_KEYPOINTSET_H
@@ -0,0 +1,114 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file */
+
+#ifndef SOLAR_LSHDESCRIPTORINDEX_H
+#define SOLAR_LSHDESCRIPTORINDEX_H
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <datastructure/DescriptorIndex.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class LSHDescriptorIndex
+ * @brief <B>A multi-probe locality sensitive hashing index of binary descriptors (ORB, AKAZE, SBPATTERN).</B>
+ *
+ * Each of the nbTables hash tables keys a descriptor by keySize of its bits, sampled at random positions.
+ * Close descriptors in Hamming distance share a key in at least one table with a high probability. A query
+ * scans the buckets of its keys, and with multi-probing the buckets of the keys differing from them by up to
+ * probeLevel bits, so that fewer tables are needed. The candidates are then verified with the Hamming distance.
+ *
+ * The index is filled incrementally, without training.
+ */
+class SOLARFRAMEWORK_API LSHDescriptorIndex : public DescriptorIndex {
+public:
+    LSHDescriptorIndex() = default;
+
+    /// @brief LSHDescriptorIndex constructor
+    /// @param[in] descriptorType the type of the indexed descriptors, compared with the Hamming distance
+    /// @param[in] nbTables the number of hash tables
+    /// @param[in] keySize the number of bits of a hash key, at most 32
+    /// @param[in] probeLevel the maximum number of bits flipped in the keys of a query to probe neighbour buckets, at most 2
+    LSHDescriptorIndex(DescriptorType descriptorType, uint32_t nbTables = 8, uint32_t keySize = 16, uint32_t probeLevel = 1);
+
+    ~LSHDescriptorIndex() override = default;
+
+    SRef<DescriptorIndex> clone() const override;
+
+    /// @brief return the number of hash tables
+    uint32_t getNbTables() const { return m_nbTables; }
+
+    /// @brief return the number of bits of a hash key
+    uint32_t getKeySize() const { return m_keySize; }
+
+    /// @brief return the maximum number of bits flipped in the keys of a query
+    uint32_t getProbeLevel() const { return m_probeLevel; }
+
+    /// @brief set the maximum number of bits flipped in the keys of a query
+    void setProbeLevel(uint32_t probeLevel) { m_probeLevel = std::min(probeLevel, 2u); }
+
+    FrameworkReturnCode search(const DescriptorView & query, uint32_t k,
+                               std::vector<std::pair<uint32_t, float>> & neighbours) const override;
+
+    void compact() override;
+
+protected:
+    void insert(uint32_t id, const DescriptorView & descriptor) override;
+
+    bool update(uint32_t id, const DescriptorView & descriptor) override;
+
+    bool isIndexed(uint32_t id) const override { return m_rows.find(id) != m_rows.end(); }
+
+    uint32_t getNbEntries() const override { return static_cast<uint32_t>(m_ids.size()); }
+
+private:
+    /// hash key of a descriptor in a table
+    uint32_t computeKey(const uint8_t * descriptor, uint32_t table) const;
+
+    /// draw the bit positions of the hash functions
+    void initHashFunctions();
+
+    /// fill the hash tables and the rows of the ids with the stored descriptors
+    void buildTables();
+
+    friend class boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive &ar, const unsigned int version);
+
+private:
+    uint32_t m_nbTables = 1;
+    uint32_t m_keySize = 16;
+    uint32_t m_probeLevel = 1;
+    std::vector<uint32_t> m_bitPositions;
+    DescriptorBuffer m_descriptors;
+    std::vector<uint32_t> m_ids;
+    std::vector<std::unordered_map<uint32_t, std::vector<uint32_t>>> m_tables;
+    std::unordered_map<uint32_t, uint32_t> m_rows;
+};
+
+DECLARESERIALIZE(LSHDescriptorIndex);
+
+}
+}
+
+BOOST_CLASS_EXPORT_KEY(SolAR::datastructure::LSHDescriptorIndex);
+
+#endif // SOLAR_LSHDESCRIPTORINDEX_H
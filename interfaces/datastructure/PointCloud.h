@@ -20,10 +20,13 @@
 #include <core/SerializationDefinitions.h>
 #include <datastructure/GeometryDefinitions.h>
 #include <datastructure/CloudPoint.h>
+#include <datastructure/ProductQuantizer.h>
+#include <datastructure/DescriptorIndex.h>
 #include <datastructure/Lockable.h>
 #include <core/Messages.h>
 #include <xpcf/core/refs.h>
 #include <map>
+#include <vector>
 
 // Definition of PointCloud Class //
 // part of SolAR namespace //
@@ -43,7 +46,7 @@ public:
 	/// @brief PointCloud constructor.
     ///
     PointCloud() = default;
-    PointCloud(const PointCloud& other): m_pointCloud(other.m_pointCloud), m_descriptorType(other.m_descriptorType), m_id(other.m_id) {};
+    PointCloud(const PointCloud& other): m_pointCloud(other.m_pointCloud), m_descriptorType(other.m_descriptorType), m_id(other.m_id), m_quantizer(other.m_quantizer), m_codes(other.m_codes), m_hasCode(other.m_hasCode), m_descriptorIndex(other.m_descriptorIndex ? other.m_descriptorIndex->clone() : nullptr) {};
     PointCloud& operator=(const PointCloud& /* other */) { return *this; };
 
 	///
@@ -117,7 +120,65 @@ public:
 	/// @return @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR.
     FrameworkReturnCode setDescriptorType(const SolAR::datastructure::DescriptorType & type);
 
+    /// @brief This method allows to get the product quantizer used to compress the descriptors of the cloud points
+    /// @return the quantizer, nullptr if the descriptors are not compressed
+    const SRef<SolAR::datastructure::ProductQuantizer> & getQuantizer() const;
+
+    /// @brief This method allows to set the product quantizer used to compress the descriptors of the cloud points (see ProductQuantizer::encode).
+    /// The codes stored with a previous quantizer are discarded.
+    /// @param[in] quantizer the quantizer, nullptr if the descriptors are not compressed
+    void setQuantizer(const SRef<SolAR::datastructure::ProductQuantizer> quantizer);
+
+    /// @brief This method allows to get the size in bytes of the product quantization code of a cloud point
+    /// @return the number of sub-quantizers of the quantizer, 0 if the descriptors are not compressed
+    uint32_t getCodeSize() const;
+
+    /// @brief This method allows to know if the compressed descriptor of a cloud point is stored in the point cloud
+    /// @param[in] id the id of the cloud point
+    /// @return true if the point cloud stores a code for this point, else false
+    bool hasCode(const uint32_t id) const;
+
+    /// @brief This method allows to get the product quantization code of a cloud point
+    /// @param[in] id the id of the cloud point
+    /// @return the getCodeSize() bytes of the code, nullptr if the point cloud does not store a code for this point
+    const uint8_t * getCode(const uint32_t id) const;
+
+    /// @brief This method allows to get the product quantization codes of a set of cloud points
+    /// @param[in] ids the ids of the cloud points
+    /// @param[out] codes the codes of the points in the order of ids, of type DescriptorType::PQ
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR if a point has no code
+    FrameworkReturnCode getCodes(const std::vector<uint32_t> & ids, SolAR::datastructure::DescriptorBuffer & codes) const;
+
+    /// @brief This method allows to get the product quantization codes of all the cloud points.
+    /// The codes are stored contiguously, the code of the point of id i starts at i * getCodeSize(). Use hasCode to know the valid codes.
+    /// @return the codes
+    const std::vector<uint8_t> & getCodes() const;
+
+    /// @brief This method allows to set the product quantization code of a cloud point
+    /// @param[in] id the id of the cloud point
+    /// @param[in] code the getCodeSize() bytes of the code
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR if the descriptors are not compressed
+    FrameworkReturnCode setCode(const uint32_t id, const uint8_t * code);
+
+    /// @brief This method allows to get the nearest neighbour index of the descriptors of the cloud points
+    /// @return the index, nullptr if the descriptors are not indexed
+    const SRef<SolAR::datastructure::DescriptorIndex> & getDescriptorIndex() const;
+
+    /// @brief This method allows to set the nearest neighbour index of the descriptors of the cloud points.
+    /// The descriptors of the points already stored are added to the index, which is then kept up to date when points are added or suppressed.
+    /// An index which needs training (e.g. IVFDescriptorIndex) is not trained implicitly: call getDescriptorIndex()->train() once enough points are indexed.
+    /// @param[in] index the index, empty, nullptr to stop indexing the descriptors
+    /// @return FrameworkReturnCode::_SUCCESS_ if succeed, else FrameworkReturnCode::_ERROR.
+    FrameworkReturnCode setDescriptorIndex(const SRef<SolAR::datastructure::DescriptorIndex> index);
+
 private:
+    /// add the descriptor of a point to the descriptor index if any
+    void indexPoint(const SRef<SolAR::datastructure::CloudPoint> & point);
+
+    /// discard the code of a suppressed or replaced point
+    void removeCode(const uint32_t id);
+
+
 	friend class boost::serialization::access;
 	template <typename Archive>
 	void serialize(Archive &ar, const unsigned int version);
@@ -125,6 +186,10 @@ private:
     std::map<uint32_t, SRef<SolAR::datastructure::CloudPoint>>	m_pointCloud;
     SolAR::datastructure::DescriptorType                        m_descriptorType{DescriptorType::AKAZE};
     uint32_t                                                    m_id{0};
+    SRef<SolAR::datastructure::ProductQuantizer>                m_quantizer;
+    std::vector<uint8_t>                                        m_codes;
+    std::vector<bool>                                           m_hasCode;
+    SRef<SolAR::datastructure::DescriptorIndex>                 m_descriptorIndex;
 };
 
 DECLARESERIALIZE(PointCloud);
@@ -132,4 +197,6 @@ DECLARESERIALIZE(PointCloud);
 }
 }  // end of namespace SolAR
 
+BOOST_CLASS_VERSION(SolAR::datastructure::PointCloud, 1);
+
 #endif // POINTCLOUD_H
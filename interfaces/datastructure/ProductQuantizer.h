@@ -0,0 +1,158 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file */
+
+#ifndef SOLAR_PRODUCTQUANTIZER_H
+#define SOLAR_PRODUCTQUANTIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <core/Messages.h>
+#include <core/SerializationDefinitions.h>
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/DescriptorBuffer.h>
+
+namespace SolAR {
+namespace datastructure {
+
+class PointCloud;
+
+/**
+ * @class ProductQuantizer
+ * @brief <B>Compress real valued descriptors into product quantization codes.</B>
+ *
+ * A descriptor of D elements is split into M sub-vectors of D/M elements, and each sub-vector is replaced by the
+ * index of its nearest centroid among K <= 256 centroids learnt for this sub-space. A descriptor is thus stored in
+ * M bytes, in a DescriptorBuffer of type DescriptorType::PQ: a 128 float SIFT (512 bytes) is stored in 32 bytes with M = 32
+ * and in 64 bytes with M = 64.
+ *
+ * Uncompressed query descriptors are compared to codes with the asymmetric distance (ADC): the query is not quantized,
+ * the squared distances between its sub-vectors and all the centroids are computed once in a lookup table, then the
+ * distance to a code is the sum of M table entries.
+ */
+class SOLARFRAMEWORK_API ProductQuantizer {
+public:
+    ProductQuantizer() = default;
+
+    /// @brief ProductQuantizer constructor
+    /// @param[in] descriptorType the type of the compressed descriptors (real valued: SIFT, SIFT_UINT8, SURF_64, SURF_128, DISK)
+    /// @param[in] nbSubQuantizers the number of sub-quantizers M, i.e. the number of bytes of a code. It must divide the number of elements of the descriptors.
+    /// @param[in] nbCentroids the number of centroids K of each sub-quantizer, at most 256
+    ProductQuantizer(DescriptorType descriptorType, uint32_t nbSubQuantizers, uint32_t nbCentroids = 256);
+
+    ~ProductQuantizer() = default;
+
+    /// @brief learn the centroids with k-means on each sub-space
+    /// @param[in] descriptors the training descriptors, of the quantizer descriptor type. At least nbCentroids descriptors are required.
+    /// @param[in] nbIterations the number of k-means iterations
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode train(const DescriptorBuffer & descriptors, uint32_t nbIterations = 20);
+
+    /// @brief learn the centroids from the descriptors of the points of a point cloud
+    /// @param[in] pointCloud the point cloud
+    /// @param[in] maxTrainingDescriptors the maximum number of descriptors used for training, regularly sampled in the point cloud
+    /// @param[in] nbIterations the number of k-means iterations
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode train(const SRef<PointCloud> pointCloud, uint32_t maxTrainingDescriptors = 65536, uint32_t nbIterations = 20);
+
+    /// @brief return true if the centroids have been learnt
+    bool isTrained() const;
+
+    /// @brief compress descriptors
+    /// @param[in] descriptors the descriptors to compress, of the quantizer descriptor type
+    /// @param[out] codes the codes, a DescriptorBuffer of type DescriptorType::PQ with one element per sub-quantizer
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode encode(const DescriptorBuffer & descriptors, DescriptorBuffer & codes) const;
+
+    /// @brief compress the descriptors of all the points of a point cloud.
+    /// The codes are stored in one contiguous buffer of the point cloud indexed by point id (see PointCloud::getCode),
+    /// and the points release their uncompressed descriptor.
+    /// The point cloud keeps a reference on this quantizer to compare query descriptors with its compressed descriptors.
+    /// @param[in,out] pointCloud the point cloud
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode encode(const SRef<PointCloud> pointCloud) const;
+
+    /// @brief reconstruct approximate descriptors from their codes
+    /// @param[in] codes the codes, of type DescriptorType::PQ
+    /// @param[out] descriptors the reconstructed descriptors, of the quantizer descriptor type
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode decode(const DescriptorBuffer & codes, DescriptorBuffer & descriptors) const;
+
+    /// @brief compute the asymmetric distance lookup table of a query descriptor
+    /// @param[in] query an uncompressed descriptor of the quantizer descriptor type
+    /// @param[out] table the nbSubQuantizers x nbCentroids squared distances between the query sub-vectors and the centroids
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode computeDistanceTable(const DescriptorView & query, std::vector<float> & table) const;
+
+    /// @brief compute the asymmetric distance between a query and a code from the query lookup table
+    /// @param[in] table the lookup table computed by computeDistanceTable
+    /// @param[in] code the nbSubQuantizers bytes of a code
+    /// @return the approximate euclidean distance
+    float asymmetricDistance(const std::vector<float> & table, const uint8_t * code) const;
+
+    /// @brief compute the asymmetric distances between a query and all the codes of a buffer
+    /// @param[in] query an uncompressed descriptor of the quantizer descriptor type
+    /// @param[in] codes the codes, of type DescriptorType::PQ
+    /// @param[out] distances the approximate euclidean distance between the query and each code
+    /// @return FrameworkReturnCode::_SUCCESS if succeed, else FrameworkReturnCode::_ERROR_
+    FrameworkReturnCode computeDistances(const DescriptorView & query, const DescriptorBuffer & codes, std::vector<float> & distances) const;
+
+    /// @brief return the type of the compressed descriptors
+    DescriptorType getDescriptorType() const { return m_descriptorType; }
+
+    /// @brief return the number of elements of the compressed descriptors
+    uint32_t getNbElements() const { return m_nbElements; }
+
+    /// @brief return the number of sub-quantizers, i.e. the size in bytes of a code
+    uint32_t getNbSubQuantizers() const { return m_nbSubQuantizers; }
+
+    /// @brief return the number of centroids of each sub-quantizer
+    uint32_t getNbCentroids() const { return m_nbCentroids; }
+
+    /// @brief return the centroids, stored as nbSubQuantizers x nbCentroids sub-vectors of nbElements / nbSubQuantizers floats
+    const std::vector<float> & getCentroids() const { return m_centroids; }
+
+private:
+    /// return true if the descriptor view can be quantized
+    bool isCompatible(const DescriptorView & descriptor) const;
+
+    /// quantize one float descriptor
+    void encode(const float * descriptor, uint8_t * code) const;
+
+    friend class boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive &ar, const unsigned int version);
+
+private:
+    DescriptorType m_descriptorType = DescriptorType::UNDEFINED;
+    DescriptorDataType m_dataType = DescriptorDataType::TYPE_32F;
+    uint32_t m_nbElements = 0;
+    uint32_t m_nbSubQuantizers = 0;
+    uint32_t m_nbCentroids = 0;
+    uint32_t m_subDimension = 0;
+    std::vector<float> m_centroids;
+};
+
+DECLARESERIALIZE(ProductQuantizer);
+
+}
+}
+
+BOOST_CLASS_EXPORT_KEY(SolAR::datastructure::ProductQuantizer);
+
+#endif // SOLAR_PRODUCTQUANTIZER_H
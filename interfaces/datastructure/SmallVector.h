@@ -0,0 +1,159 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/** @file */
+
+#ifndef SOLAR_SMALLVECTOR_H
+#define SOLAR_SMALLVECTOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class SmallVector
+ * @brief <B>A vector storing its first N elements inline.</B>
+ *
+ * A SmallVector holding at most N elements makes no allocation: containers of a few elements per object (e.g. the
+ * visibility of a cloud point) cost one contiguous block instead of one heap node per element.
+ * Beyond N elements, the elements move to a heap array growing geometrically.
+ * The elements must be default constructible and copyable; they are meant to be small values.
+ */
+template <typename T, uint32_t N>
+class SmallVector {
+    static_assert(N > 0, "SmallVector needs an inline capacity");
+
+public:
+    typedef T value_type;
+    typedef T * iterator;
+    typedef const T * const_iterator;
+
+    SmallVector() = default;
+
+    SmallVector(const SmallVector & other) { assign(other.begin(), other.end()); }
+
+    SmallVector(SmallVector && other) noexcept { take(other); }
+
+    ~SmallVector() = default;
+
+    SmallVector & operator=(const SmallVector & other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    SmallVector & operator=(SmallVector && other) noexcept
+    {
+        if (this != &other)
+            take(other);
+        return *this;
+    }
+
+    /// @brief replace the elements by the ones of [first, last)
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        reserve(static_cast<uint32_t>(std::distance(first, last)));
+        for (; first != last; ++first)
+            data()[m_size++] = *first;
+    }
+
+    T * data() { return m_heap ? m_heap.get() : m_inline; }
+    const T * data() const { return m_heap ? m_heap.get() : m_inline; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + m_size; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + m_size; }
+
+    T & operator[](uint32_t i) { return data()[i]; }
+    const T & operator[](uint32_t i) const { return data()[i]; }
+
+    uint32_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    uint32_t capacity() const { return m_capacity; }
+
+    /// @brief remove the elements, keeping the storage
+    void clear() { m_size = 0; }
+
+    /// @brief make room for capacity elements without further allocation
+    void reserve(uint32_t capacity)
+    {
+        if (capacity <= m_capacity)
+            return;
+        std::unique_ptr<T[]> heap(new T[capacity]);
+        std::copy(begin(), end(), heap.get());
+        m_heap = std::move(heap);
+        m_capacity = capacity;
+    }
+
+    void push_back(const T & value) { insert(end(), value); }
+
+    /// @brief insert value before pos
+    /// @return an iterator to the inserted element
+    iterator insert(const_iterator pos, const T & value)
+    {
+        uint32_t index = static_cast<uint32_t>(pos - begin());
+        T copy = value; // value may be an element of this vector
+        if (m_size == m_capacity)
+            reserve(2 * m_capacity);
+        std::copy_backward(begin() + index, end(), end() + 1);
+        data()[index] = copy;
+        m_size++;
+        return begin() + index;
+    }
+
+    /// @brief remove the element at pos
+    /// @return an iterator to the element following the removed one
+    iterator erase(const_iterator pos)
+    {
+        uint32_t index = static_cast<uint32_t>(pos - begin());
+        std::copy(begin() + index + 1, end(), begin() + index);
+        m_size--;
+        return begin() + index;
+    }
+
+private:
+    void take(SmallVector & other)
+    {
+        if (other.m_heap) {
+            m_heap = std::move(other.m_heap);
+            m_capacity = other.m_capacity;
+            m_size = other.m_size;
+        }
+        else
+            assign(other.begin(), other.end());
+        other.m_capacity = N;
+        other.m_size = 0;
+    }
+
+private:
+    T m_inline[N] = {};
+    std::unique_ptr<T[]> m_heap;
+    uint32_t m_size = 0;
+    uint32_t m_capacity = N;
+};
+
+}  // end of namespace datastructure
+}  // end of namespace SolAR
+
+#endif // SOLAR_SMALLVECTOR_H
@@ -0,0 +1,110 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/** @file */
+
+#ifndef SOLAR_UNDISTORTIONMAP_H
+#define SOLAR_UNDISTORTIONMAP_H
+
+#include <cstdint>
+#include <vector>
+
+#include <core/SolARFrameworkDefinitions.h>
+#include <datastructure/CameraDefinitions.h>
+#include <datastructure/GeometryDefinitions.h>
+#include <datastructure/Keypoint.h>
+#include <datastructure/KeypointSet.h>
+
+namespace SolAR {
+namespace datastructure {
+
+/**
+ * @class UndistortionMap
+ * @brief <B>A lookup grid undistorting the pixels of a camera.</B>
+ *
+ * The undistorted position of the nodes of a regular grid covering the image is solved once, with the iterative
+ * inversion of the distortion model of CameraDefinitions (K1, K2, P1, P2, K3). A point is then undistorted by a bilinear
+ * interpolation of the four nodes around it, instead of a solve per point.
+ * Points outside the grid are solved exactly. A map is immutable: it is rebuilt when the camera parameters change.
+ */
+class SOLARFRAMEWORK_API UndistortionMap {
+public:
+    /// @brief UndistortionMap constructor
+    /// @param[in] camParams the camera parameters: resolution, intrinsics and distortion
+    /// @param[in] step the distance between two nodes of the grid in pixels
+    explicit UndistortionMap(const CameraParameters & camParams, float step = 8.f);
+
+    ~UndistortionMap() = default;
+
+    /// @brief return true if the map was built for the resolution, intrinsics and distortion of camParams
+    bool isBuiltFor(const CameraParameters & camParams) const;
+
+    /// @brief return the largest interpolation error measured at the center of the cells of the grid, in pixels
+    float getMaxError() const { return m_maxError; }
+
+    /// @brief undistort a point
+    Point2Df undistort(const Point2Df & point) const;
+
+    /// @brief undistort points given as arrays of coordinates. Output arrays can be the input ones.
+    /// @param[in] x the x coordinates of the points
+    /// @param[in] y the y coordinates of the points
+    /// @param[in] nbPoints the number of points
+    /// @param[out] undistortedX the undistorted x coordinates
+    /// @param[out] undistortedY the undistorted y coordinates
+    void undistort(const float * x, const float * y, uint32_t nbPoints, float * undistortedX, float * undistortedY) const;
+
+    /// @brief undistort points
+    /// @param[in] points the points to undistort
+    /// @param[out] undistortedPoints the undistorted points
+    void undistort(const std::vector<Point2Df> & points, std::vector<Point2Df> & undistortedPoints) const;
+
+    /// @brief undistort keypoints, their other attributes are copied
+    /// @param[in] keypoints the keypoints to undistort
+    /// @param[out] undistortedKeypoints the undistorted keypoints
+    void undistort(const std::vector<Keypoint> & keypoints, std::vector<Keypoint> & undistortedKeypoints) const;
+
+    /// @brief undistort keypoints, their other attributes are copied
+    /// @param[in] keypoints the keypoints to undistort
+    /// @param[out] undistortedKeypoints the undistorted keypoints. It can be keypoints.
+    void undistort(const KeypointSet & keypoints, KeypointSet & undistortedKeypoints) const;
+
+private:
+    /// undistort a point with the iterative inversion of the distortion model
+    void solve(double x, double y, double & undistortedX, double & undistortedY) const;
+
+    void interpolate(float x, float y, float & undistortedX, float & undistortedY) const;
+
+private:
+    CamCalibration m_intrinsic;
+    CamDistortion m_distortion;
+    Sizei m_resolution;
+    bool m_isIdentity = false;
+    float m_step;
+    float m_minX;
+    float m_minY;
+    uint32_t m_nbCols = 0;
+    uint32_t m_nbRows = 0;
+    // undistorted coordinates of the nodes, row by row
+    std::vector<float> m_nodesX;
+    std::vector<float> m_nodesY;
+    float m_maxError = 0.f;
+};
+
+}
+}
+
+#endif // SOLAR_UNDISTORTIONMAP_H
@@ -15,6 +15,7 @@
  */
 
 #include "base/features/ADescriptorMatcher.h"
+#include "datastructure/DescriptorDistance.h"
 
 namespace xpcf = org::bcom::xpcf;
 
@@ -25,23 +26,65 @@ namespace features {
 ADescriptorMatcher::ADescriptorMatcher(std::map<std::string,std::string> componentInfosMap):xpcf::ConfigurableBase(componentInfosMap)
 {
     declareInterface<IDescriptorMatcher>(this);
+    declareProperty("defaultDistanceRatio", m_defaultDistanceRatio);
+    declareProperty("defaultCrossCheck", m_defaultCrossCheck);
+    declareProperty("defaultNbThreads", m_defaultNbThreads);
+}
+
+FrameworkReturnCode ADescriptorMatcher::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                              const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
+                                              std::vector<SolAR::datastructure::DescriptorMatch> & matches)
+{
+    matches.clear();
+    if (!descriptors1 || !descriptors2)
+        return FrameworkReturnCode::_ERROR_;
+    return datastructure::matchDescriptors(*descriptors1, *descriptors2, m_defaultDistanceRatio, m_defaultCrossCheck != 0, matches, m_defaultNbThreads);
 }
 
 FrameworkReturnCode ADescriptorMatcher::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1, const std::vector<SRef<SolAR::datastructure::DescriptorBuffer>>& descriptors2, std::vector<SolAR::datastructure::DescriptorMatch>& matches)
 {
 	SRef<datastructure::DescriptorBuffer> buff2 = xpcf::utils::make_shared<datastructure::DescriptorBuffer>(descriptors1->getDescriptorType(), 0);
+	buff2->reserve(static_cast<uint32_t>(descriptors2.size()));
 	for (const auto& it : descriptors2)
 		buff2->append(it->getDescriptor(0));
     return match(descriptors1, buff2, matches);
 }
 
-FrameworkReturnCode  ADescriptorMatcher::match(const std::vector<SolAR::datastructure::Keypoint>& keypoints1,
-                                  const std::vector<SolAR::datastructure::Keypoint>& keypoints2,
+FrameworkReturnCode  ADescriptorMatcher::match(const std::vector<SolAR::datastructure::Keypoint>& /* keypoints1 */,
+                                  const std::vector<SolAR::datastructure::Keypoint>& /* keypoints2 */,
                                   const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
                                   const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
                                                                   std::vector<SolAR::datastructure::DescriptorMatch> & matches){
 
-    return match(keypoints1, keypoints2, descriptors1, descriptors2, matches);
+    return match(descriptors1, descriptors2, matches);
+}
+
+FrameworkReturnCode ADescriptorMatcher::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                              const std::vector<SRef<SolAR::datastructure::DescriptorBuffer>> & descriptors2,
+                                              std::vector<std::vector<SolAR::datastructure::DescriptorMatch>> & matches)
+{
+    matches.clear();
+    if (!descriptors1)
+        return FrameworkReturnCode::_ERROR_;
+    // the sets are matched by the matching of two sets of the component, which is multithreaded by default
+    matches.resize(descriptors2.size());
+    for (size_t i = 0; i < descriptors2.size(); i++) {
+        if (match(descriptors1, descriptors2[i], matches[i]) != FrameworkReturnCode::_SUCCESS) {
+            matches.clear();
+            return FrameworkReturnCode::_ERROR_;
+        }
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode ADescriptorMatcher::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                              const SRef<SolAR::datastructure::DescriptorIndex> index2,
+                                              std::vector<SolAR::datastructure::DescriptorMatch> & matches)
+{
+    matches.clear();
+    if (!descriptors1 || !index2)
+        return FrameworkReturnCode::_ERROR_;
+    return index2->match(*descriptors1, m_defaultDistanceRatio, matches);
 }
 
 
@@ -15,6 +15,13 @@
  */
 
 #include "base/features/ADescriptorMatcherGeometric.h"
+#include "datastructure/DescriptorDistance.h"
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
 
 namespace xpcf = org::bcom::xpcf;
 
@@ -22,9 +29,186 @@ namespace SolAR {
 namespace base {
 namespace features {
 
+namespace {
+const double PI = std::acos(-1.);
+
+// keypoints closer to the epipole than this number of bands are candidates of all the epipolar lines
+constexpr double NEAR_EPIPOLE_BANDS = 20.;
+
+// Keypoints of the second image sorted by the parameter of their epipolar line: the angle in [0, pi) of the line around
+// the epipole, or the offset of the line along their common normal when the epipole is at infinity.
+class EpipolarLines {
+public:
+    EpipolarLines(const Eigen::Vector3d & epipole, const std::vector<datastructure::Keypoint> & keypoints,
+                  const std::vector<uint32_t> & indices, double band)
+    {
+        double norm = epipole.head<2>().norm();
+        m_parallel = std::abs(epipole(2)) <= 1e-9 * norm;
+        if (m_parallel)
+            m_point = Eigen::Vector2d(-epipole(1), epipole(0)) / norm;
+        else
+            m_point = epipole.head<2>() / epipole(2);
+        std::vector<std::pair<double, uint32_t>> sorted;
+        sorted.reserve(indices.size());
+        double minRadius = std::numeric_limits<double>::max();
+        for (const auto & index : indices) {
+            Eigen::Vector2d point(keypoints[index].getX(), keypoints[index].getY());
+            if (m_parallel) {
+                sorted.emplace_back(m_point.dot(point), index);
+                continue;
+            }
+            Eigen::Vector2d direction = point - m_point;
+            double radius = direction.norm();
+            if (radius < NEAR_EPIPOLE_BANDS * band) {
+                m_near.push_back(index);
+                continue;
+            }
+            minRadius = std::min(minRadius, radius);
+            sorted.emplace_back(normalizeAngle(std::atan2(direction(1), direction(0))), index);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        m_parameters.reserve(sorted.size());
+        m_indices.reserve(sorted.size());
+        for (const auto & [parameter, index] : sorted) {
+            m_parameters.push_back(parameter);
+            m_indices.push_back(index);
+        }
+        // a keypoint at a distance r from the epipole and less than band from a line makes an angle less than asin(band / r) with it
+        m_halfWidth = m_parallel ? band : std::asin(std::min(band / minRadius, 1.));
+    }
+
+    // keypoints possibly in the band of a line, in increasing order
+    void getCandidates(const Eigen::Vector3d & line, std::vector<uint32_t> & candidates) const
+    {
+        candidates = m_near;
+        if (m_parallel) {
+            Eigen::Vector2d normal = line.head<2>().normalized();
+            double offset = -line(2) / line.head<2>().norm();
+            if (normal.dot(m_point) < 0.)
+                offset = -offset;
+            appendRange(offset - m_halfWidth, offset + m_halfWidth, candidates);
+        }
+        else if (m_halfWidth >= PI / 2.)
+            candidates.insert(candidates.end(), m_indices.begin(), m_indices.end());
+        else {
+            double angle = normalizeAngle(std::atan2(line(0), -line(1)));
+            double begin = angle - m_halfWidth;
+            double end = angle + m_halfWidth;
+            appendRange(std::max(begin, 0.), std::min(end, PI), candidates);
+            if (begin < 0.)
+                appendRange(begin + PI, PI, candidates);
+            if (end > PI)
+                appendRange(0., end - PI, candidates);
+        }
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+private:
+    static double normalizeAngle(double angle)
+    {
+        if (angle < 0.)
+            angle += PI;
+        return angle >= PI ? angle - PI : angle;
+    }
+
+    void appendRange(double begin, double end, std::vector<uint32_t> & candidates) const
+    {
+        auto first = std::lower_bound(m_parameters.begin(), m_parameters.end(), begin);
+        auto last = std::upper_bound(first, m_parameters.end(), end);
+        candidates.insert(candidates.end(), m_indices.begin() + (first - m_parameters.begin()), m_indices.begin() + (last - m_parameters.begin()));
+    }
+
+private:
+    bool m_parallel;
+    // epipole, or normal of the lines if they are parallel
+    Eigen::Vector2d m_point;
+    double m_halfWidth;
+    std::vector<double> m_parameters;
+    std::vector<uint32_t> m_indices;
+    std::vector<uint32_t> m_near;
+};
+}
+
 ADescriptorMatcherGeometric::ADescriptorMatcherGeometric(std::map<std::string,std::string> componentInfosMap):xpcf::ConfigurableBase(componentInfosMap)
 {
     declareInterface<SolAR::api::features::IDescriptorMatcherGeometric>(this);
+    declareProperty("defaultEpipolarBand", m_defaultEpipolarBand);
+    declareProperty("defaultDistanceRatio", m_defaultDistanceRatio);
+    declareProperty("defaultCrossCheck", m_defaultCrossCheck);
+}
+
+FrameworkReturnCode ADescriptorMatcherGeometric::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1,
+                                                       const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2,
+                                                       const std::vector<SolAR::datastructure::Keypoint> & undistortedKeypoints1,
+                                                       const std::vector<SolAR::datastructure::Keypoint> & undistortedKeypoints2,
+                                                       const SolAR::datastructure::Transform3Df& pose1,
+                                                       const SolAR::datastructure::Transform3Df& pose2,
+                                                       const SolAR::datastructure::CameraParameters & camParams1,
+                                                       const SolAR::datastructure::CameraParameters & camParams2,
+                                                       std::vector<SolAR::datastructure::DescriptorMatch> & matches,
+                                                       const std::vector<uint32_t>& mask1, const std::vector<uint32_t>& mask2)
+{
+    matches.clear();
+    if (!descriptors1 || !descriptors2) {
+        LOG_ERROR("ADescriptorMatcherGeometric::match - null descriptor buffer");
+        return FrameworkReturnCode::_ERROR_;
+    }
+    if ((undistortedKeypoints1.size() != descriptors1->getNbDescriptors()) || (undistortedKeypoints2.size() != descriptors2->getNbDescriptors())) {
+        LOG_ERROR("ADescriptorMatcherGeometric::match - the numbers of keypoints and descriptors differ");
+        return FrameworkReturnCode::_ERROR_;
+    }
+    if ((descriptors1->getDescriptorType() != descriptors2->getDescriptorType()) || (descriptors1->getDescriptorDataType() != descriptors2->getDescriptorDataType())
+        || (descriptors1->getNbElements() != descriptors2->getNbElements())) {
+        LOG_ERROR("ADescriptorMatcherGeometric::match - the descriptors are not comparable");
+        return FrameworkReturnCode::_ERROR_;
+    }
+    // relative pose from the camera 1 to the camera 2, the poses being transforms from the cameras to the world
+    datastructure::Transform3Df pose12 = pose2.inverse() * pose1;
+    Eigen::Matrix3d rotation = pose12.linear().cast<double>();
+    Eigen::Vector3d translation = pose12.translation().cast<double>();
+    if (translation.norm() < 1e-9) {
+        LOG_ERROR("ADescriptorMatcherGeometric::match - no baseline between the frames, the epipolar geometry is undefined");
+        return FrameworkReturnCode::_ERROR_;
+    }
+    Eigen::Matrix3d calibration1 = camParams1.intrinsic.cast<double>();
+    Eigen::Matrix3d calibration2 = camParams2.intrinsic.cast<double>();
+    Eigen::Matrix3d crossTranslation;
+    crossTranslation << 0., -translation(2), translation(1),
+                        translation(2), 0., -translation(0),
+                        -translation(1), translation(0), 0.;
+    Eigen::Matrix3d fundamental = calibration2.inverse().transpose() * crossTranslation * rotation * calibration1.inverse();
+    // the epipole of the second image is the projection of the center of the camera 1
+    Eigen::Vector3d epipole = calibration2 * translation;
+
+    // mask indices come from the callers, out of range ones are ignored
+    std::vector<bool> matchable1(undistortedKeypoints1.size(), mask1.empty());
+    for (const auto & i : mask1)
+        if (i < undistortedKeypoints1.size())
+            matchable1[i] = true;
+    std::vector<uint32_t> indices2 = mask2;
+    if (mask2.empty()) {
+        indices2.resize(undistortedKeypoints2.size());
+        std::iota(indices2.begin(), indices2.end(), 0);
+    }
+    indices2.erase(std::remove_if(indices2.begin(), indices2.end(), [&](uint32_t i) { return i >= undistortedKeypoints2.size(); }), indices2.end());
+    // the candidates of a descriptor are distinct
+    std::sort(indices2.begin(), indices2.end());
+    indices2.erase(std::unique(indices2.begin(), indices2.end()), indices2.end());
+    EpipolarLines lines(epipole, undistortedKeypoints2, indices2, m_defaultEpipolarBand);
+
+    return datastructure::matchCandidateDescriptors(*descriptors1, *descriptors2, [&](uint32_t i, std::vector<uint32_t> & candidates) {
+        if (!matchable1[i])
+            return;
+        Eigen::Vector3d line = fundamental * Eigen::Vector3d(undistortedKeypoints1[i].getX(), undistortedKeypoints1[i].getY(), 1.);
+        double lineNorm = line.head<2>().norm();
+        // a keypoint at the epipole of the first image has no epipolar line
+        if (lineNorm < std::numeric_limits<double>::epsilon() * line.norm())
+            return;
+        lines.getCandidates(line, candidates);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t j) {
+            const datastructure::Keypoint & keypoint2 = undistortedKeypoints2[j];
+            return std::abs(line(0) * keypoint2.getX() + line(1) * keypoint2.getY() + line(2)) > m_defaultEpipolarBand * lineNorm; }), candidates.end());
+    }, m_defaultDistanceRatio, m_defaultCrossCheck != 0, -1.f, matches);
 }
 
 FrameworkReturnCode ADescriptorMatcherGeometric::match(const SRef<SolAR::datastructure::Frame> frame1,
@@ -34,8 +218,10 @@ FrameworkReturnCode ADescriptorMatcherGeometric::match(const SRef<SolAR::datastr
                                                        std::vector<SolAR::datastructure::DescriptorMatch> & matches,
                                                        const std::vector<uint32_t>& mask1, const std::vector<uint32_t>& mask2)
 {
+    SRef<const std::vector<SolAR::datastructure::Keypoint>> undistortedKeypoints1 = frame1->getUndistortedKeypointsSnapshot();
+    SRef<const std::vector<SolAR::datastructure::Keypoint>> undistortedKeypoints2 = frame2->getUndistortedKeypointsSnapshot();
     return match(frame1->getDescriptors(), frame2->getDescriptors(),
-        frame1->getUndistortedKeypoints(), frame2->getUndistortedKeypoints(), frame1->getPose(),
+        *undistortedKeypoints1, *undistortedKeypoints2, frame1->getPose(),
                  frame2->getPose(), camParams1, camParams2, matches, mask1, mask2);
 }
 
@@ -15,6 +15,8 @@
  */
 
 #include "base/features/ADescriptorMatcherRegion.h"
+#include "datastructure/DescriptorDistance.h"
+#include "core/Log.h"
 
 namespace xpcf = org::bcom::xpcf;
 
@@ -25,34 +27,80 @@ namespace features {
 ADescriptorMatcherRegion::ADescriptorMatcherRegion(std::map<std::string,std::string> componentInfosMap):xpcf::ConfigurableBase(componentInfosMap)
 {
     declareInterface<SolAR::api::features::IDescriptorMatcherRegion>(this);
+    declareProperty("defaultDistanceRatio", m_defaultDistanceRatio);
+    declareProperty("defaultCrossCheck", m_defaultCrossCheck);
+}
+
+FrameworkReturnCode ADescriptorMatcherRegion::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1, const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2, const std::vector<SolAR::datastructure::Point2Df>& points2D1, const std::vector<SolAR::datastructure::Point2Df>& points2D2, std::vector<SolAR::datastructure::DescriptorMatch>& matches, const float radius, const float matchingDistanceMax)
+{
+	matches.clear();
+	if (!descriptors1 || !descriptors2) {
+		LOG_ERROR("ADescriptorMatcherRegion::match - null descriptor buffer");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	// cells of the size of the searching regions: a region overlaps at most 3x3 cells
+	datastructure::KeypointGrid grid2(points2D2, radius > 0.f ? radius : 0.f);
+	return match(descriptors1, descriptors2, points2D1, points2D2, grid2, matches, radius, matchingDistanceMax);
 }
 
 FrameworkReturnCode ADescriptorMatcherRegion::match(const std::vector<SolAR::datastructure::Point2Df>& points2D, const std::vector<SRef<SolAR::datastructure::DescriptorBuffer>>& descriptors, const SRef<SolAR::datastructure::Frame> frame, std::vector<SolAR::datastructure::DescriptorMatch>& matches, const float radius, const float matchingDistanceMax)
 {
-	SRef<datastructure::DescriptorBuffer> descBuff = xpcf::utils::make_shared<datastructure::DescriptorBuffer>(frame->getDescriptors()->getDescriptorType(), 0);
+	matches.clear();
+	const SRef<datastructure::DescriptorBuffer>& descriptors2 = frame->getDescriptors();
+	if (!descriptors2) {
+		LOG_ERROR("ADescriptorMatcherRegion::match - the frame has no descriptors");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	SRef<datastructure::DescriptorBuffer> descriptors1 = xpcf::utils::make_shared<datastructure::DescriptorBuffer>(descriptors2->getDescriptorType(),
+		descriptors2->getDescriptorDataType(), descriptors2->getNbElements(), 0);
+	descriptors1->reserve(static_cast<uint32_t>(descriptors.size()));
 	for (const auto& it : descriptors)
-		descBuff->append(it->getDescriptor(0));
-	std::vector<datastructure::Point2Df> points2D2;
-	const std::vector<datastructure::Keypoint>& keypoints = frame->getKeypoints();
-	for (const auto& kp : keypoints)
-		points2D2.push_back(kp);
-	return match(descBuff, frame->getDescriptors(), points2D, points2D2, matches, radius, 
-		matchingDistanceMax);
+		descriptors1->append(it->getDescriptor(0));
+	// the keypoints of the frame are already indexed in its keypoint grid
+	SRef<const std::vector<datastructure::Keypoint>> keypoints2;
+	SRef<datastructure::KeypointGrid> grid2 = frame->getKeypointGrid(keypoints2);
+	std::vector<datastructure::Point2Df> points2D2(keypoints2->begin(), keypoints2->end());
+	return match(descriptors1, descriptors2, points2D, points2D2, *grid2, matches, radius, matchingDistanceMax);
 }
 
 FrameworkReturnCode ADescriptorMatcherRegion::match(const SRef<SolAR::datastructure::Frame> currentFrame, const SRef<SolAR::datastructure::Frame> lastFrame, std::vector<SolAR::datastructure::DescriptorMatch>& matches, const float radius, const float matchingDistanceMax)
 {
-	std::vector<datastructure::Point2Df> points2D1, points2D2;
-	const std::vector<datastructure::Keypoint>& keypoints1 = currentFrame->getKeypoints();
-	const std::vector<datastructure::Keypoint>& keypoints2 = lastFrame->getKeypoints();
-	for (const auto& kp : keypoints1)
-		points2D1.push_back(kp);
-	for (const auto& kp : keypoints2)
-		points2D2.push_back(kp);
-	return match(currentFrame->getDescriptors(), lastFrame->getDescriptors(), points2D1, points2D2, 
+	matches.clear();
+	if (!currentFrame->getDescriptors() || !lastFrame->getDescriptors()) {
+		LOG_ERROR("ADescriptorMatcherRegion::match - the frames have no descriptors");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	SRef<const std::vector<datastructure::Keypoint>> keypoints1 = currentFrame->getKeypointsSnapshot();
+	std::vector<datastructure::Point2Df> points2D1(keypoints1->begin(), keypoints1->end());
+	// the keypoints of the last frame are already indexed in its keypoint grid
+	SRef<const std::vector<datastructure::Keypoint>> keypoints2;
+	SRef<datastructure::KeypointGrid> grid2 = lastFrame->getKeypointGrid(keypoints2);
+	std::vector<datastructure::Point2Df> points2D2(keypoints2->begin(), keypoints2->end());
+	return match(currentFrame->getDescriptors(), lastFrame->getDescriptors(), points2D1, points2D2, *grid2,
 		matches, radius, matchingDistanceMax);
 }
 
+FrameworkReturnCode ADescriptorMatcherRegion::match(const SRef<SolAR::datastructure::DescriptorBuffer> descriptors1, const SRef<SolAR::datastructure::DescriptorBuffer> descriptors2, const std::vector<SolAR::datastructure::Point2Df>& points2D1, const std::vector<SolAR::datastructure::Point2Df>& points2D2, const SolAR::datastructure::KeypointGrid& grid2, std::vector<SolAR::datastructure::DescriptorMatch>& matches, const float radius, const float matchingDistanceMax)
+{
+	matches.clear();
+	if (!descriptors1 || !descriptors2) {
+		LOG_ERROR("ADescriptorMatcherRegion::match - null descriptor buffer");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	if ((points2D1.size() != descriptors1->getNbDescriptors()) || (points2D2.size() != descriptors2->getNbDescriptors())
+		|| (grid2.getNbPoints() != points2D2.size())) {
+		LOG_ERROR("ADescriptorMatcherRegion::match - the numbers of points and descriptors differ");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	if (datastructure::matchCandidateDescriptors(*descriptors1, *descriptors2, [&](uint32_t i, std::vector<uint32_t>& candidates) {
+		grid2.getPointsInRadius(points2D1[i], radius, candidates); },
+		m_defaultDistanceRatio, m_defaultCrossCheck != 0, matchingDistanceMax, matches) != FrameworkReturnCode::_SUCCESS) {
+		LOG_ERROR("ADescriptorMatcherRegion::match - the descriptors are not comparable");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	return FrameworkReturnCode::_SUCCESS;
+}
+
 
 
 }
@@ -15,6 +15,13 @@
  */
 
 #include "base/features/ADescriptorMatcherStereo.h"
+#include "datastructure/DescriptorDistance.h"
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
 
 namespace xpcf = org::bcom::xpcf;
 
@@ -22,15 +29,133 @@ namespace SolAR {
 namespace base {
 namespace features {
 
+namespace {
+// Keypoints of the second image bucketed by integer row: a keypoint is in all the rows at most band pixels away from it,
+// and the keypoints of a row are sorted by column.
+class RowBandIndex {
+public:
+    RowBandIndex(const std::vector<datastructure::Keypoint> & keypoints, datastructure::StereoType type, float band) : m_type(type)
+    {
+        if (keypoints.empty())
+            return;
+        float minRow = std::numeric_limits<float>::max();
+        float maxRow = std::numeric_limits<float>::lowest();
+        for (const auto & keypoint : keypoints) {
+            minRow = std::min(minRow, getRow(keypoint));
+            maxRow = std::max(maxRow, getRow(keypoint));
+        }
+        m_firstRow = static_cast<int>(std::floor(minRow - band));
+        m_nbRows = static_cast<int>(std::floor(maxRow + band)) - m_firstRow + 1;
+        // counting sort of the (row, keypoint) pairs by row
+        m_rowStarts.assign(m_nbRows + 1, 0);
+        for (const auto & keypoint : keypoints)
+            for (int row = getFirstRow(keypoint, band); row <= getLastRow(keypoint, band); row++)
+                m_rowStarts[row + 1]++;
+        std::partial_sum(m_rowStarts.begin(), m_rowStarts.end(), m_rowStarts.begin());
+        std::vector<uint32_t> next(m_rowStarts.begin(), m_rowStarts.end() - 1);
+        m_indices.resize(m_rowStarts.back());
+        m_columns.resize(m_rowStarts.back());
+        for (uint32_t i = 0; i < keypoints.size(); i++)
+            for (int row = getFirstRow(keypoints[i], band); row <= getLastRow(keypoints[i], band); row++)
+                m_indices[next[row]++] = i;
+        for (int row = 0; row < m_nbRows; row++) {
+            auto begin = m_indices.begin() + m_rowStarts[row];
+            auto end = m_indices.begin() + m_rowStarts[row + 1];
+            std::sort(begin, end, [&](uint32_t i, uint32_t j) { return getColumn(keypoints[i]) < getColumn(keypoints[j]); });
+            for (uint32_t slot = m_rowStarts[row]; slot < m_rowStarts[row + 1]; slot++)
+                m_columns[slot] = getColumn(keypoints[m_indices[slot]]);
+        }
+    }
+
+    float getRow(const datastructure::Keypoint & keypoint) const
+    {
+        return m_type == datastructure::StereoType::Horizontal ? keypoint.getY() : keypoint.getX();
+    }
+
+    float getColumn(const datastructure::Keypoint & keypoint) const
+    {
+        return m_type == datastructure::StereoType::Horizontal ? keypoint.getX() : keypoint.getY();
+    }
+
+    // keypoints on the row of a keypoint of the first image with a column in [minColumn, maxColumn], a superset of the ones in the band
+    void getCandidates(const datastructure::Keypoint & keypoint, float minColumn, float maxColumn, std::vector<uint32_t> & candidates) const
+    {
+        candidates.clear();
+        float row = std::floor(getRow(keypoint)) - m_firstRow;
+        if (!(row >= 0.f) || !(row < m_nbRows))
+            return;
+        auto begin = m_columns.begin() + m_rowStarts[static_cast<int>(row)];
+        auto end = m_columns.begin() + m_rowStarts[static_cast<int>(row) + 1];
+        auto first = std::lower_bound(begin, end, minColumn);
+        auto last = std::upper_bound(first, end, maxColumn);
+        candidates.assign(m_indices.begin() + (first - m_columns.begin()), m_indices.begin() + (last - m_columns.begin()));
+    }
+
+private:
+    int getFirstRow(const datastructure::Keypoint & keypoint, float band) const
+    {
+        return static_cast<int>(std::floor(getRow(keypoint) - band)) - m_firstRow;
+    }
+
+    int getLastRow(const datastructure::Keypoint & keypoint, float band) const
+    {
+        return static_cast<int>(std::floor(getRow(keypoint) + band)) - m_firstRow;
+    }
+
+private:
+    datastructure::StereoType m_type;
+    int m_firstRow = 0;
+    int m_nbRows = 0;
+    // keypoints of row r: [m_rowStarts[r], m_rowStarts[r+1]) in m_indices and m_columns
+    std::vector<uint32_t> m_rowStarts;
+    std::vector<uint32_t> m_indices;
+    std::vector<float> m_columns;
+};
+}
+
 ADescriptorMatcherStereo::ADescriptorMatcherStereo(std::map<std::string,std::string> componentInfosMap):xpcf::ConfigurableBase(componentInfosMap)
 {
     declareInterface<SolAR::api::features::IDescriptorMatcherStereo>(this);
+    declareProperty("defaultRowBand", m_defaultRowBand);
+    declareProperty("defaultMinDisparity", m_defaultMinDisparity);
+    declareProperty("defaultMaxDisparity", m_defaultMaxDisparity);
+    declareProperty("defaultDistanceRatio", m_defaultDistanceRatio);
+    declareProperty("defaultCrossCheck", m_defaultCrossCheck);
+}
+
+FrameworkReturnCode ADescriptorMatcherStereo::match(const SRef<SolAR::datastructure::DescriptorBuffer>& descriptors1, const SRef<SolAR::datastructure::DescriptorBuffer>& descriptors2, const std::vector<SolAR::datastructure::Keypoint>& undistortedKeypoints1, const std::vector<SolAR::datastructure::Keypoint>& undistortedKeypoints2, SolAR::datastructure::StereoType type, std::vector<SolAR::datastructure::DescriptorMatch>& matches)
+{
+	matches.clear();
+	if (!descriptors1 || !descriptors2) {
+		LOG_ERROR("ADescriptorMatcherStereo::match - null descriptor buffer");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	if ((undistortedKeypoints1.size() != descriptors1->getNbDescriptors()) || (undistortedKeypoints2.size() != descriptors2->getNbDescriptors())) {
+		LOG_ERROR("ADescriptorMatcherStereo::match - the numbers of keypoints and descriptors differ");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	if ((descriptors1->getDescriptorType() != descriptors2->getDescriptorType()) || (descriptors1->getDescriptorDataType() != descriptors2->getDescriptorDataType())
+		|| (descriptors1->getNbElements() != descriptors2->getNbElements())) {
+		LOG_ERROR("ADescriptorMatcherStereo::match - the descriptors are not comparable");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	RowBandIndex index(undistortedKeypoints2, type, m_defaultRowBand);
+	float maxDisparity = m_defaultMaxDisparity < 0.f ? std::numeric_limits<float>::max() : m_defaultMaxDisparity;
+	return datastructure::matchCandidateDescriptors(*descriptors1, *descriptors2, [&](uint32_t i, std::vector<uint32_t>& candidates) {
+		const datastructure::Keypoint& keypoint1 = undistortedKeypoints1[i];
+		float column = index.getColumn(keypoint1);
+		index.getCandidates(keypoint1, column - maxDisparity, column - m_defaultMinDisparity, candidates);
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t j) {
+			return std::abs(index.getRow(undistortedKeypoints2[j]) - index.getRow(keypoint1)) > m_defaultRowBand; }), candidates.end());
+	}, m_defaultDistanceRatio, m_defaultCrossCheck != 0, -1.f, matches);
 }
 
 FrameworkReturnCode ADescriptorMatcherStereo::match(const SRef<SolAR::datastructure::Frame> frame1, const SRef<SolAR::datastructure::Frame> frame2, SolAR::datastructure::StereoType type, std::vector<SolAR::datastructure::DescriptorMatch>& matches)
 {
-	return match(frame1->getDescriptors(), frame2->getDescriptors(), frame1->getUndistortedKeypoints(),
-		frame2->getUndistortedKeypoints(), type, matches);
+	SRef<const std::vector<SolAR::datastructure::Keypoint>> undistortedKeypoints1 = frame1->getUndistortedKeypointsSnapshot();
+	SRef<const std::vector<SolAR::datastructure::Keypoint>> undistortedKeypoints2 = frame2->getUndistortedKeypointsSnapshot();
+	return match(frame1->getDescriptors(), frame2->getDescriptors(), *undistortedKeypoints1,
+		*undistortedKeypoints2, type, matches);
 }
 
 }
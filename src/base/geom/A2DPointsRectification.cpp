@@ -27,6 +27,29 @@ A2DPointsRectification::A2DPointsRectification(std::map<std::string,std::string>
     declareInterface<I2DPointsRectification>(this);
 }
 
+FrameworkReturnCode A2DPointsRectification::rectify(const std::vector<SolAR::datastructure::Point2Df>& points2D,
+													const SolAR::datastructure::CameraParameters& camParams,
+													const SolAR::datastructure::RectificationParameters& rectParams,
+													std::vector<SolAR::datastructure::Point2Df>& rectifiedPoints2D)
+{
+	SRef<datastructure::UndistortionMap> undistortionMap;
+	{
+		std::unique_lock lock(m_mutexUndistortionMap);
+		if (!m_undistortionMap || !m_undistortionMap->isBuiltFor(camParams))
+			m_undistortionMap = xpcf::utils::make_shared<datastructure::UndistortionMap>(camParams);
+		undistortionMap = m_undistortionMap;
+	}
+	undistortionMap->undistort(points2D, rectifiedPoints2D);
+	// undistorted pixels back to the camera coordinate system, rotated to the rectified camera and projected in its image
+	Eigen::Matrix3f transform = rectParams.projection.leftCols<3>() * rectParams.rotation * camParams.intrinsic.inverse();
+	for (auto& point : rectifiedPoints2D) {
+		Eigen::Vector3f rectified = transform * Eigen::Vector3f(point.getX(), point.getY(), 1.f);
+		point.setX(rectified(0) / rectified(2));
+		point.setY(rectified(1) / rectified(2));
+	}
+	return FrameworkReturnCode::_SUCCESS;
+}
+
 FrameworkReturnCode A2DPointsRectification::rectify(const std::vector<SolAR::datastructure::Keypoint>& keypoints,
 													const SolAR::datastructure::CameraParameters& camParams,
 													const SolAR::datastructure::RectificationParameters& rectParams,
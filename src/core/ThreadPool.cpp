@@ -0,0 +1,113 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core/ThreadPool.h"
+
+#include <algorithm>
+
+namespace SolAR {
+
+namespace {
+// true while the thread runs tasks: nested loops run on the calling thread
+thread_local bool t_inParallelFor = false;
+}
+
+ThreadPool::ThreadPool(uint32_t nbThreads)
+{
+    for (uint32_t i = 1; i < nbThreads; i++)
+        m_workers.emplace_back(&ThreadPool::work, this, i - 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto & worker : m_workers)
+        worker.join();
+}
+
+ThreadPool & ThreadPool::instance()
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
+void ThreadPool::runTasks()
+{
+    for (uint32_t i = m_nextTask++; i < m_nbTasks; i = m_nextTask++)
+        (*m_task)(i);
+}
+
+void ThreadPool::work(uint32_t workerIndex)
+{
+    t_inParallelFor = true;
+    uint64_t loop = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_start.wait(lock, [&] { return m_stop || (m_loop != loop); });
+        if (m_stop)
+            return;
+        loop = m_loop;
+        if (workerIndex >= m_nbActiveWorkers)
+            continue;
+        lock.unlock();
+        runTasks();
+        lock.lock();
+        if (--m_nbRunningWorkers == 0)
+            m_done.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t nbTasks, const std::function<void(uint32_t)> & task, uint32_t maxThreads)
+{
+    if (nbTasks == 0)
+        return;
+    uint32_t nbWorkers = std::min(static_cast<uint32_t>(m_workers.size()), nbTasks - 1);
+    if (maxThreads > 0)
+        nbWorkers = std::min(nbWorkers, maxThreads - 1);
+    std::unique_lock<std::mutex> loopLock;
+    if ((nbWorkers > 0) && !t_inParallelFor)
+        loopLock = std::unique_lock<std::mutex>(m_loopMutex, std::try_to_lock);
+    if (!loopLock.owns_lock()) {
+        bool inParallelFor = t_inParallelFor;
+        t_inParallelFor = true;
+        for (uint32_t i = 0; i < nbTasks; i++)
+            task(i);
+        t_inParallelFor = inParallelFor;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_nbTasks = nbTasks;
+        m_nextTask = 0;
+        m_nbActiveWorkers = nbWorkers;
+        m_nbRunningWorkers = nbWorkers;
+        m_loop++;
+    }
+    m_start.notify_all();
+    t_inParallelFor = true;
+    runTasks();
+    t_inParallelFor = false;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_nbRunningWorkers == 0; });
+    m_task = nullptr;
+}
+
+}  // end of namespace SolAR
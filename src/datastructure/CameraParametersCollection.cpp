@@ -25,6 +25,15 @@ namespace xpcf = org::bcom::xpcf;
 namespace SolAR {
 namespace datastructure {
 
+CameraParametersCollection& CameraParametersCollection::operator=(const CameraParametersCollection& other)
+{
+    // the lock of the collection is not copied
+    m_cameraParameters = other.m_cameraParameters;
+    m_id = other.m_id;
+    m_undistortionMaps = other.m_undistortionMaps;
+    return *this;
+}
+
 FrameworkReturnCode CameraParametersCollection::addCameraParameters(const SRef<CameraParameters> cameraParameters, bool defineCameraParametersId)
 {
     uint32_t id;
@@ -119,6 +128,8 @@ FrameworkReturnCode CameraParametersCollection::suppressCameraParameters(const u
     std::map< uint32_t, SRef<CameraParameters>>::iterator cameraParametersIt = m_cameraParameters.find(id);
     if (cameraParametersIt != m_cameraParameters.end()) {
         m_cameraParameters.erase(cameraParametersIt);
+        std::unique_lock lock(m_undistortionMaps.mutex);
+        m_undistortionMaps.maps.erase(id);
 		return FrameworkReturnCode::_SUCCESS;
 	}
 	else {
@@ -131,6 +142,8 @@ void CameraParametersCollection::suppressAllCameraParameters()
 {
     m_cameraParameters.clear();
     m_id = 0;
+    std::unique_lock lock(m_undistortionMaps.mutex);
+    m_undistortionMaps.maps.clear();
 }
 
 bool CameraParametersCollection::isExistCameraParameters(const uint32_t id) const
@@ -143,6 +156,23 @@ int CameraParametersCollection::getNbCameraParameters() const
     return static_cast<int>(m_cameraParameters.size());
 }
 
+FrameworkReturnCode CameraParametersCollection::getUndistortionMap(const uint32_t id, SRef<const UndistortionMap> & undistortionMap) const
+{
+    std::map< uint32_t, SRef<CameraParameters>>::const_iterator cameraParametersIt = m_cameraParameters.find(id);
+    if (cameraParametersIt == m_cameraParameters.end()) {
+        LOG_DEBUG("Cannot find cameraParameters with id {} to get its undistortion map", id);
+        return FrameworkReturnCode::_ERROR_;
+    }
+    const CameraParameters & cameraParameters = *cameraParametersIt->second;
+    std::unique_lock lock(m_undistortionMaps.mutex);
+    SRef<const UndistortionMap> & map = m_undistortionMaps.maps[id];
+    // the camera parameters are shared with the caller, who may have changed them since the map was built
+    if (!map || !map->isBuiltFor(cameraParameters))
+        map = xpcf::utils::make_shared<UndistortionMap>(cameraParameters);
+    undistortionMap = map;
+    return FrameworkReturnCode::_SUCCESS;
+}
+
 template <typename Archive>
 void CameraParametersCollection::serialize(Archive &ar, const unsigned int /* version */)
 {
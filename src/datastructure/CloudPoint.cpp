@@ -14,11 +14,17 @@
  * limitations under the License.
  */
 
+#include "core/Log.h"
 #include "datastructure/CloudPoint.h"
+#include "datastructure/DescriptorDistance.h"
 #include "xpcf/core/helpers.h"
 
+#include <algorithm>
+
 BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::CloudPoint);
 
+namespace xpcf = org::bcom::xpcf;
+
 namespace SolAR {
 namespace datastructure {
 
@@ -39,28 +45,32 @@ CloudPoint::CloudPoint(float x, float y, float z, float r, float g, float b, flo
 }
 
 CloudPoint::CloudPoint(float x, float y, float z, float r, float g, float b, double reproj_error, const std::map<unsigned int, unsigned int>& visibility) :
-    Point3Df(x, y, z), m_visibility(visibility), m_rgb(r, g, b), m_reproj_error(reproj_error)
+    Point3Df(x, y, z), m_rgb(r, g, b), m_reproj_error(reproj_error)
 {
+    setVisibility(visibility);
     m_cloudPointSupportedTypes = CloudPointType::Color | CloudPointType::ViewDirection | CloudPointType::Visibility;
 }
 
 CloudPoint::CloudPoint(float x, float y, float z, float r, float g, float b, float nx, float ny, float nz, double reproj_error, const std::map<unsigned int, unsigned int>& visibility) :
-    Point3Df(x, y, z), m_visibility(visibility), m_rgb(r, g, b), m_viewDirection(nx, ny, nz), m_reproj_error(reproj_error)
+    Point3Df(x, y, z), m_rgb(r, g, b), m_viewDirection(nx, ny, nz), m_reproj_error(reproj_error)
 {
+    setVisibility(visibility);
     m_cloudPointSupportedTypes = CloudPointType::Color | CloudPointType::ViewDirection | CloudPointType::ReprojectionError | CloudPointType::Visibility ;
 }
 
 CloudPoint::CloudPoint(float x, float y, float z, float r, float g, float b, double reproj_error, const std::map<unsigned int, unsigned int>& visibility, SRef<DescriptorBuffer> descriptor) :
-    Point3Df(x, y, z), m_descriptor(descriptor), m_visibility(visibility), m_rgb(r, g, b), m_reproj_error(reproj_error)
+    Point3Df(x, y, z), m_descriptor(descriptor), m_rgb(r, g, b), m_reproj_error(reproj_error)
 {
+    setVisibility(visibility);
     m_cloudPointSupportedTypes = CloudPointType::Color | CloudPointType::ReprojectionError | CloudPointType::Visibility;
     if (descriptor != nullptr)
         m_cloudPointSupportedTypes = m_cloudPointSupportedTypes | CloudPointType::Descriptor;
 }
 
 CloudPoint::CloudPoint(float x, float y, float z, float r, float g, float b, float nx, float ny, float nz, double reproj_error, const std::map<unsigned int, unsigned int>& visibility, SRef<DescriptorBuffer> descriptor) :
-    Point3Df(x, y, z), m_descriptor(descriptor), m_visibility(visibility), m_rgb(r, g, b), m_viewDirection(nx, ny, nz), m_reproj_error(reproj_error)
+    Point3Df(x, y, z), m_descriptor(descriptor), m_rgb(r, g, b), m_viewDirection(nx, ny, nz), m_reproj_error(reproj_error)
 {
+    setVisibility(visibility);
     m_cloudPointSupportedTypes = CloudPointType::Color | CloudPointType::ViewDirection | CloudPointType::ReprojectionError | CloudPointType::Visibility;
     if (descriptor != nullptr)
         m_cloudPointSupportedTypes = m_cloudPointSupportedTypes | CloudPointType::Descriptor;
@@ -82,17 +92,38 @@ void CloudPoint::setDescriptor(const SRef<DescriptorBuffer> &descriptor) {
     if (descriptor != nullptr)
     {
         m_descriptor = descriptor;
-        m_cloudPointSupportedTypes = m_cloudPointSupportedTypes | CloudPointType::Descriptor;
+        m_cloudPointSupportedTypes = (m_cloudPointSupportedTypes | CloudPointType::Descriptor) & ~static_cast<uint32_t>(CloudPointType::CompressedDescriptor);
     }
 }
 
-void CloudPoint::addNewDescriptor(const DescriptorView & descriptor)
+void CloudPoint::releaseDescriptor() {
+    m_descriptor.reset();
+    m_cloudPointSupportedTypes = (m_cloudPointSupportedTypes & ~static_cast<uint32_t>(CloudPointType::Descriptor)) | CloudPointType::CompressedDescriptor;
+}
+
+bool CloudPoint::isDescriptorCompressed() const {
+    return (m_cloudPointSupportedTypes & CloudPointType::CompressedDescriptor) != 0;
+}
+
+FrameworkReturnCode CloudPoint::addNewDescriptor(const DescriptorView & descriptor)
 {
-	DescriptorBuffer newDescriptor(descriptor);
-	DescriptorBuffer newDescriptorCP = ((*m_descriptor * m_visibility.size()) + newDescriptor) / (m_visibility.size() + 1);
-	DescriptorBuffer newDescriptorCPConvertedType = newDescriptorCP.convertTo(m_descriptor->getDescriptorDataType());
-	*m_descriptor = newDescriptorCPConvertedType;
+	// a single observation must not replace the mean of all the observations kept by the code
+	if (isDescriptorCompressed()) {
+		LOG_ERROR("CloudPoint {}: the descriptor is compressed, the new descriptor is not taken into account", m_id);
+		return FrameworkReturnCode::_ERROR_;
+	}
+	if (m_descriptor == nullptr) {
+		m_descriptor = xpcf::utils::make_shared<DescriptorBuffer>(descriptor);
+		m_cloudPointSupportedTypes = m_cloudPointSupportedTypes | CloudPointType::Descriptor;
+		return FrameworkReturnCode::_SUCCESS;
+	}
+	// mean of the observations, updated in place without temporary buffers
+	if (updateRunningMeanDescriptor(*m_descriptor, static_cast<uint32_t>(m_visibility.size()), descriptor) != FrameworkReturnCode::_SUCCESS) {
+		LOG_ERROR("CloudPoint {}: the new descriptor does not match the descriptor of the cloud point, it is not taken into account", m_id);
+		return FrameworkReturnCode::_ERROR_;
+	}
     m_cloudPointSupportedTypes = m_cloudPointSupportedTypes | CloudPointType::Descriptor;
+	return FrameworkReturnCode::_SUCCESS;
 }
 
 const Vector3f& CloudPoint::getRGB() const{
@@ -144,25 +175,73 @@ const double& CloudPoint::getReprojError() const
 	return m_reproj_error;
 }
 
+namespace {
+bool lessKeyframeId(const std::pair<uint32_t, uint32_t>& visibility, uint32_t keyframe_id)
+{
+    return visibility.first < keyframe_id;
+}
+}
+
 const std::map<uint32_t, uint32_t>& CloudPoint::getVisibility() const {
-	return m_visibility;
+    // concurrent readers may build the map together: the first one stored is kept
+    SRef<std::map<uint32_t, uint32_t>> map = std::atomic_load(&m_visibilityMap.map);
+    if (!map) {
+        auto builtMap = xpcf::utils::make_shared<std::map<uint32_t, uint32_t>>(m_visibility.begin(), m_visibility.end());
+        if (std::atomic_compare_exchange_strong(&m_visibilityMap.map, &map, builtMap))
+            map = builtMap;
+    }
+	return *map;
+}
+
+const CloudPoint::SortedVisibility& CloudPoint::getSortedVisibility() const
+{
+    return m_visibility;
+}
+
+bool CloudPoint::getVisibility(const uint32_t& keyframe_id, uint32_t& keypoint_id) const
+{
+    auto it = std::lower_bound(m_visibility.begin(), m_visibility.end(), keyframe_id, lessKeyframeId);
+    if (it == m_visibility.end() || it->first != keyframe_id)
+        return false;
+    keypoint_id = it->second;
+    return true;
+}
+
+uint32_t CloudPoint::getNbVisibilities() const
+{
+    return m_visibility.size();
 }
 
 void CloudPoint::addVisibility(const uint32_t& keyframe_id, const uint32_t& keypoint_id) {
-    m_visibility[keyframe_id] = keypoint_id;
+    auto it = std::lower_bound(m_visibility.begin(), m_visibility.end(), keyframe_id, lessKeyframeId);
+    if (it != m_visibility.end() && it->first == keyframe_id)
+        it->second = keypoint_id;
+    else
+        m_visibility.insert(it, {keyframe_id, keypoint_id});
+    if (m_visibilityMap.map)
+        (*m_visibilityMap.map)[keyframe_id] = keypoint_id;
     m_cloudPointSupportedTypes = m_cloudPointSupportedTypes | CloudPointType::Visibility;
 }
 
 bool CloudPoint::removeVisibility(const uint32_t& keyframe_id)
 {
-	if (m_visibility.find(keyframe_id) == m_visibility.end())
+    auto it = std::lower_bound(m_visibility.begin(), m_visibility.end(), keyframe_id, lessKeyframeId);
+	if (it == m_visibility.end() || it->first != keyframe_id)
 		return false;
 	else {
-		m_visibility.erase(keyframe_id);
+		m_visibility.erase(it);
+		if (m_visibilityMap.map)
+			m_visibilityMap.map->erase(keyframe_id);
 		return true;
 	}
 }
 
+void CloudPoint::setVisibility(const std::map<uint32_t, uint32_t>& visibility)
+{
+    m_visibility.assign(visibility.begin(), visibility.end());
+    m_visibilityMap.map.reset();
+}
+
 void CloudPoint::setPositionFixed(bool isPositionFixed)
 {
     m_isPositionFixed = isPositionFixed;
@@ -185,8 +264,15 @@ void CloudPoint::serialize(Archive &ar, const unsigned int /* version */)
     ar & m_id;
     if (m_cloudPointSupportedTypes & CloudPointType::Descriptor)
         ar & m_descriptor;
-    if (m_cloudPointSupportedTypes & CloudPointType::Visibility)
-        ar & m_visibility;
+    if (m_cloudPointSupportedTypes & CloudPointType::Visibility) {
+        // archived as a map, as before the sorted visibility
+        std::map<uint32_t, uint32_t> visibility;
+        if (Archive::is_saving::value)
+            visibility.insert(m_visibility.begin(), m_visibility.end());
+        ar & visibility;
+        if (Archive::is_loading::value)
+            setVisibility(visibility);
+    }
     if (m_cloudPointSupportedTypes & CloudPointType::Color)
         ar & boost::serialization::make_array(m_rgb.data(), 3);
     if (m_cloudPointSupportedTypes & CloudPointType::ViewDirection)
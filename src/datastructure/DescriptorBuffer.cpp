@@ -16,8 +16,13 @@
 
 #include <vector>
 #include <map>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
 
 #include "datastructure/DescriptorBuffer.h"
+#include "datastructure/DescriptorDistance.h"
 
 #include <xpcf/core/helpers.h>
 
@@ -25,20 +30,18 @@ BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::DescriptorBuffer);
 
 namespace  SolAR {
 namespace datastructure {
-const static std::map<DescriptorType, std::pair<uint32_t, DescriptorDataType>> descriptorType2elementsAndDataType =
-{{DescriptorType::AKAZE, {61,DescriptorDataType::TYPE_8U}},
- {DescriptorType::SIFT, {128,DescriptorDataType::TYPE_32F}},
- {DescriptorType::SIFT_UINT8, {128,DescriptorDataType::TYPE_8U}},
- {DescriptorType::SURF_64, {64,DescriptorDataType::TYPE_32F}},
- {DescriptorType::SURF_128, {128,DescriptorDataType::TYPE_32F}},
- {DescriptorType::ORB, {32,DescriptorDataType::TYPE_8U}},
- {DescriptorType::DISK, {128,DescriptorDataType::TYPE_8U}}
-};
 
-DescriptorView::DescriptorView(void * startAddress, uint32_t length, DescriptorType type):
-    m_baseAddress(startAddress), m_length(length), m_type(type)
+namespace {
+// check the size of the packed descriptors wrapped without copy, before the buffer takes the memory
+void checkWrappedSize(uint64_t size, uint32_t nbDescriptors, uint32_t nbElements, DescriptorDataType dataType)
 {
-    m_dataType = descriptorType2elementsAndDataType.at(type).second;
+    uint64_t expectedSize = static_cast<uint64_t>(nbDescriptors) * nbElements * static_cast<uint32_t>(dataType);
+    if (expectedSize > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("DescriptorBuffer - " + std::to_string(nbDescriptors) + " descriptors exceed the maximum size of a buffer");
+    if (size != expectedSize)
+        throw std::invalid_argument("DescriptorBuffer - " + std::to_string(size) + " bytes given for " + std::to_string(nbDescriptors)
+                                    + " descriptors of " + std::to_string(expectedSize / std::max<uint32_t>(nbDescriptors, 1)) + " bytes");
+}
 }
 
 DescriptorBuffer::DescriptorBuffer( const DescriptorView8U & desc):DescriptorBuffer(desc.type(), 1)
@@ -58,12 +61,13 @@ DescriptorBuffer::DescriptorBuffer( const DescriptorView & desc):DescriptorBuffe
 
 bool DescriptorBuffer::deduceProperties(const DescriptorType & type)
 {
-    if (descriptorType2elementsAndDataType.find(type) == descriptorType2elementsAndDataType.end()) {
+    DescriptorProperties properties = getDescriptorProperties(type);
+    if (properties.nbElements == 0) {
         // ERROR no automatic translation : should throw an exception
         return false;
     }
-    m_nb_elements = descriptorType2elementsAndDataType.at(type).first;
-    m_data_type = descriptorType2elementsAndDataType.at(type).second;
+    m_nb_elements = properties.nbElements;
+    m_data_type = properties.dataType;
     return true;
 }
 
@@ -89,6 +93,67 @@ DescriptorBuffer::DescriptorBuffer( unsigned char* descriptorData, DescriptorTyp
     m_buffer->setData(descriptorData, m_nb_descriptors * m_nb_elements * m_data_type);
 }
 
+DescriptorBuffer::DescriptorBuffer( unsigned char* descriptorData, DescriptorType descriptor_type, uint32_t nb_descriptors,
+                                    std::function<void(void*)> release):
+    m_buffer(new BufferInternal()), m_nb_descriptors(nb_descriptors), m_descriptor_type(descriptor_type)
+{
+    // the memory is released on every failure, as it would be by the buffer
+    if (!deduceProperties(descriptor_type)) {
+        if (release)
+            release(descriptorData);
+        throw std::invalid_argument("DescriptorBuffer - the properties of descriptor type " + toString(descriptor_type) + " are unknown");
+    }
+    uint64_t size = static_cast<uint64_t>(m_nb_descriptors) * m_nb_elements * m_data_type;
+    try {
+        checkWrappedSize(size, m_nb_descriptors, m_nb_elements, m_data_type);
+    }
+    catch (...) {
+        if (release)
+            release(descriptorData);
+        throw;
+    }
+    //wrap buffer without copy
+    m_buffer.reset(new BufferInternal(descriptorData, static_cast<uint32_t>(size), release));
+}
+
+DescriptorBuffer::DescriptorBuffer( unsigned char* descriptorData, DescriptorType descriptor_type, DescriptorDataType data_type,
+                                    uint32_t nb_elements, uint32_t nb_descriptors, std::function<void(void*)> release):
+    m_buffer(new BufferInternal()),
+    m_nb_descriptors(nb_descriptors), m_data_type(data_type), m_nb_elements(nb_elements), m_descriptor_type(descriptor_type)
+{
+    uint64_t size = static_cast<uint64_t>(m_nb_descriptors) * m_nb_elements * m_data_type;
+    try {
+        checkWrappedSize(size, m_nb_descriptors, m_nb_elements, m_data_type);
+    }
+    catch (...) {
+        if (release)
+            release(descriptorData);
+        throw;
+    }
+    //wrap buffer without copy
+    m_buffer.reset(new BufferInternal(descriptorData, static_cast<uint32_t>(size), release));
+}
+
+DescriptorBuffer::DescriptorBuffer( std::vector<uint8_t> && descriptorData, DescriptorType descriptor_type, uint32_t nb_descriptors):
+    m_buffer(new BufferInternal()), m_nb_descriptors(nb_descriptors), m_descriptor_type(descriptor_type)
+{
+    if (!deduceProperties(descriptor_type))
+        throw std::invalid_argument("DescriptorBuffer - the properties of descriptor type " + toString(descriptor_type) + " are unknown");
+    // the vector is left to the caller on failure
+    checkWrappedSize(descriptorData.size(), m_nb_descriptors, m_nb_elements, m_data_type);
+    //adopt buffer without copy
+    m_buffer.reset(new BufferInternal(std::move(descriptorData)));
+}
+
+DescriptorBuffer::DescriptorBuffer( std::vector<uint8_t> && descriptorData, DescriptorType descriptor_type, DescriptorDataType data_type,
+                                    uint32_t nb_elements, uint32_t nb_descriptors):
+    m_buffer(new BufferInternal()),
+    m_nb_descriptors(nb_descriptors), m_data_type(data_type), m_nb_elements(nb_elements), m_descriptor_type(descriptor_type)
+{
+    checkWrappedSize(descriptorData.size(), m_nb_descriptors, m_nb_elements, m_data_type);
+    //adopt buffer without copy
+    m_buffer.reset(new BufferInternal(std::move(descriptorData)));
+}
 
 DescriptorBuffer::DescriptorBuffer():m_buffer(new BufferInternal()){
     m_descriptor_type = DescriptorType::SIFT;
@@ -123,13 +188,24 @@ void* DescriptorBuffer::data()
 
 const void* DescriptorBuffer::data() const
 {
-    return m_buffer->data();
+    return std::as_const(*m_buffer).data();
+}
+
+void DescriptorBuffer::setRowAlignment(DescriptorRowAlignment alignment)
+{
+    if (alignment == m_row_alignment)
+        return;
+    // the copies sharing the buffer keep reading their own row layout
+    makeWritable();
+    m_row_alignment = alignment;
+    m_buffer->setRowLayout(m_nb_descriptors, getDescriptorByteSize(), getDescriptorStride());
 }
 
 DescriptorView DescriptorBuffer::getDescriptor(uint32_t index) const
 {
-    void* pDescriptor = m_buffer->data();
-    uint32_t offset = m_data_type * m_nb_elements * index;
+    // reading a descriptor does not copy borrowed memory
+    void* pDescriptor = const_cast<void*>(std::as_const(*m_buffer).data());
+    uint32_t offset = getDescriptorStride() * index;
     pDescriptor = (uint8_t *)pDescriptor + offset;
     return DescriptorView(pDescriptor, m_nb_elements, m_descriptor_type);
 }
@@ -140,7 +216,7 @@ void DescriptorBuffer::append(const DescriptorView8U & descriptor)
         //throw
         return;
     }
-    m_buffer->appendData(static_cast<const void*>(descriptor.data()),descriptor.length());
+    m_buffer->appendData(static_cast<const void*>(descriptor.data()), descriptor.length(), getDescriptorStride());
 	m_nb_descriptors++;
 }
 
@@ -150,65 +226,160 @@ void DescriptorBuffer::append(const DescriptorView32F & descriptor)
         //throw
         return;
     }
-    m_buffer->appendData(static_cast<const void*>(descriptor.data()), descriptor.length() * DescriptorView32F::sDataType);
+    m_buffer->appendData(static_cast<const void*>(descriptor.data()), descriptor.length() * DescriptorView32F::sDataType, getDescriptorStride());
 	m_nb_descriptors++;
 }
 
 DescriptorBuffer DescriptorBuffer::convertTo(DescriptorDataType type) const
 {
-	if (m_data_type == type)
+	if ((m_data_type == type) && (m_row_alignment == DescriptorRowAlignment::ROW_PACKED))
 		return DescriptorBuffer(*this);
-	std::vector<uint8_t> output;
-	if (type == DescriptorDataType::TYPE_8U) {
-		float *tmp_data = reinterpret_cast<float*>(m_buffer->data());
-		std::vector<uint8_t> tmp_output(m_nb_descriptors * m_nb_elements);
-        for (uint32_t i = 0; i < m_nb_descriptors * m_nb_elements; i++) {
-            tmp_output[i] = static_cast<uint8_t>(tmp_data[i] + 0.5);
-		}
-		output.swap(tmp_output);
+	DescriptorBuffer output;
+	convertTo(type, output);
+	return output;
+}
+
+void DescriptorBuffer::convertTo(DescriptorDataType type, DescriptorBuffer & output) const
+{
+	if (&output == this) {
+		if ((m_data_type == type) && (m_row_alignment == DescriptorRowAlignment::ROW_PACKED))
+			return;
+		DescriptorBuffer converted;
+		convertTo(type, converted);
+		output = converted;
+		return;
+	}
+	output.reshape(m_descriptor_type, type, m_nb_elements, m_nb_descriptors);
+	uint32_t stride = getDescriptorStride();
+	const uint8_t *src_data = reinterpret_cast<const uint8_t*>(std::as_const(*m_buffer).data());
+	uint8_t *dst_data = reinterpret_cast<uint8_t*>(output.data());
+	if ((m_data_type == type) && (stride == getDescriptorByteSize())) {
+		std::memcpy(dst_data, src_data, m_nb_descriptors * stride);
+		return;
 	}
-	else {
-		uint8_t *tmp_data = reinterpret_cast<uint8_t*>(m_buffer->data());
-		std::vector<float> tmp_output(m_nb_descriptors * m_nb_elements);
-        for (uint32_t i = 0; i < m_nb_descriptors * m_nb_elements; i++) {
-			tmp_output[i] = static_cast<float>(tmp_data[i]);
-		}
-		output.insert(output.begin(), reinterpret_cast<uint8_t*>(tmp_output.data()), reinterpret_cast<uint8_t*>(tmp_output.data()) + m_nb_descriptors * m_nb_elements * 4);
+	for (uint32_t d = 0; d < m_nb_descriptors; d++) {
+		const uint8_t *src_row = src_data + d * stride;
+		uint8_t *dst_row = dst_data + d * m_nb_elements * type;
+		if (m_data_type == type)
+			std::memcpy(dst_row, src_row, m_nb_elements * type);
+		else if (type == DescriptorDataType::TYPE_8U)
+			convertDescriptorData(reinterpret_cast<const float*>(src_row), dst_row, m_nb_elements);
+		else
+			convertDescriptorData(src_row, reinterpret_cast<float*>(dst_row), m_nb_elements);
 	}
-	return DescriptorBuffer(output.data(), m_descriptor_type, type, m_nb_elements, m_nb_descriptors);
 }
 
-DescriptorBuffer DescriptorBuffer::operator+(const DescriptorBuffer & desc) const
+void DescriptorBuffer::reshape(DescriptorType descriptor_type, DescriptorDataType data_type, uint32_t nb_elements, uint32_t nb_descriptors)
+{
+    // the content is not preserved: a shared or borrowed storage is simply replaced
+    if ((m_buffer.use_count() > 1) || m_buffer->isExternal())
+        m_buffer.reset(new BufferInternal());
+    m_descriptor_type = descriptor_type;
+    m_data_type = data_type;
+    m_nb_elements = nb_elements;
+    m_nb_descriptors = nb_descriptors;
+    m_row_alignment = DescriptorRowAlignment::ROW_PACKED;
+    m_buffer->reset(m_nb_descriptors * m_nb_elements * m_data_type);
+}
+
+void DescriptorBuffer::makeWritable()
+{
+    if (m_buffer.use_count() > 1)
+        m_buffer.reset(new BufferInternal(*m_buffer));
+    m_buffer->detach();
+}
+
+void DescriptorBuffer::accumulate(uint32_t index, const DescriptorView & descriptor, float weight, float scale)
+{
+    if ((index >= m_nb_descriptors) || (descriptor.length() != m_nb_elements)) {
+        //throw
+        return;
+    }
+    makeWritable();
+    uint8_t * row = static_cast<uint8_t *>(m_buffer->data()) + index * getDescriptorStride();
+    float * accumulator = reinterpret_cast<float *>(row);
+    // TYPE_8U descriptors are updated through a float row, allocated once per thread
+    thread_local std::vector<float> rowBuffer;
+    if (m_data_type == DescriptorDataType::TYPE_8U) {
+        rowBuffer.resize(m_nb_elements);
+        accumulator = rowBuffer.data();
+        if (scale != 0.f)
+            convertDescriptorData(row, accumulator, m_nb_elements);
+    }
+    if (scale == 0.f) {
+        if (descriptor.dataType() == DescriptorDataType::TYPE_8U)
+            convertDescriptorData(static_cast<const uint8_t *>(descriptor.data()), accumulator, m_nb_elements);
+        else
+            std::memcpy(accumulator, descriptor.data(), m_nb_elements * sizeof(float));
+        scale = 1.f;
+        weight -= 1.f;
+    }
+    if (descriptor.dataType() == DescriptorDataType::TYPE_8U)
+        scaleAdd(static_cast<const uint8_t *>(descriptor.data()), weight, accumulator, scale, m_nb_elements);
+    else
+        scaleAdd(static_cast<const float *>(descriptor.data()), weight, accumulator, scale, m_nb_elements);
+    if (m_data_type == DescriptorDataType::TYPE_8U)
+        convertDescriptorData(accumulator, row, m_nb_elements);
+}
+
+DescriptorBuffer& DescriptorBuffer::operator+=(const DescriptorBuffer & desc)
 {
 	assert((m_descriptor_type == desc.getDescriptorType()) && (m_nb_descriptors == desc.getNbDescriptors()) && (m_nb_elements == desc.getNbElements()));
-	DescriptorBuffer desc1 = this->convertTo(TYPE_32F);
-	DescriptorBuffer desc2 = desc.convertTo(TYPE_32F);
-	float *desc1_data = reinterpret_cast<float*>(desc1.data());
-	float *desc2_data = reinterpret_cast<float*>(desc2.data());
-	std::vector<float> output(m_nb_descriptors * m_nb_elements);
-    for (size_t i = 0; i < output.size(); i++)
-		output[i] = desc1_data[i] + desc2_data[i];
-	return DescriptorBuffer(reinterpret_cast<uint8_t*>(output.data()), m_descriptor_type, TYPE_32F, m_nb_elements, m_nb_descriptors);
+	if (m_data_type != TYPE_32F)
+		convertTo(TYPE_32F, *this);
+	makeWritable();
+	uint8_t *dst_data = static_cast<uint8_t*>(m_buffer->data());
+	const uint8_t *src_data = static_cast<const uint8_t*>(desc.data());
+	uint32_t dst_stride = getDescriptorStride();
+	uint32_t src_stride = desc.getDescriptorStride();
+	for (uint32_t d = 0; d < m_nb_descriptors; d++) {
+		float *dst_row = reinterpret_cast<float*>(dst_data + d * dst_stride);
+		if (desc.getDescriptorDataType() == TYPE_8U)
+			scaleAdd(src_data + d * src_stride, 1.f, dst_row, 1.f, m_nb_elements);
+		else
+			scaleAdd(reinterpret_cast<const float*>(src_data + d * src_stride), 1.f, dst_row, 1.f, m_nb_elements);
+	}
+	return *this;
+}
+
+DescriptorBuffer& DescriptorBuffer::operator*=(float fac)
+{
+	if (m_data_type != TYPE_32F)
+		convertTo(TYPE_32F, *this);
+	makeWritable();
+	uint8_t *data = static_cast<uint8_t*>(m_buffer->data());
+	uint32_t stride = getDescriptorStride();
+	for (uint32_t d = 0; d < m_nb_descriptors; d++) {
+		float *row = reinterpret_cast<float*>(data + d * stride);
+		scaleAdd(row, 0.f, row, fac, m_nb_elements);
+	}
+	return *this;
+}
+
+DescriptorBuffer& DescriptorBuffer::operator/=(float div)
+{
+	return *this *= 1.f / div;
+}
+
+DescriptorBuffer DescriptorBuffer::operator+(const DescriptorBuffer & desc) const
+{
+	DescriptorBuffer output = convertTo(TYPE_32F);
+	output += desc;
+	return output;
 }
 
 DescriptorBuffer DescriptorBuffer::operator*(float fac) const
 {
-	DescriptorBuffer desc = this->convertTo(TYPE_32F);
-	float *desc_data = reinterpret_cast<float*>(desc.data());
-	std::vector<float> output(m_nb_descriptors * m_nb_elements);
-    for (size_t i = 0; i < output.size(); i++)
-		output[i] = desc_data[i] * fac;
-	return DescriptorBuffer(reinterpret_cast<uint8_t*>(output.data()), m_descriptor_type, TYPE_32F, m_nb_elements, m_nb_descriptors);
+	DescriptorBuffer output = convertTo(TYPE_32F);
+	output *= fac;
+	return output;
 }
 
 DescriptorBuffer DescriptorBuffer::operator/(float div) const
 {
-	DescriptorBuffer desc = this->convertTo(TYPE_32F);
-	float *desc_data = reinterpret_cast<float*>(desc.data());
-	std::vector<float> output(m_nb_descriptors * m_nb_elements);
-    for (size_t i = 0; i < output.size(); i++)
-		output[i] = desc_data[i] / div;
-	return DescriptorBuffer(reinterpret_cast<uint8_t*>(output.data()), m_descriptor_type, TYPE_32F, m_nb_elements, m_nb_descriptors);
+	DescriptorBuffer output = convertTo(TYPE_32F);
+	output /= div;
+	return output;
 }
 
 void DescriptorBuffer::append(const DescriptorView & descriptor)
@@ -217,12 +388,63 @@ void DescriptorBuffer::append(const DescriptorView & descriptor)
         //throw
         return;
     }
-    m_buffer->appendData(static_cast<const void*>(descriptor.data()), descriptor.length() * descriptor.dataType());
+    m_buffer->appendData(static_cast<const void*>(descriptor.data()), descriptor.length() * descriptor.dataType(), getDescriptorStride());
 	m_nb_descriptors++;
 }
 
+void DescriptorBuffer::append(const DescriptorBuffer & descriptors)
+{
+    if ((m_descriptor_type != descriptors.getDescriptorType()) || (m_data_type != descriptors.getDescriptorDataType())
+            || (m_nb_elements != descriptors.getNbElements())) {
+        //throw
+        return;
+    }
+    uint32_t nbDescriptors = descriptors.getNbDescriptors();
+    uint32_t srcStride = descriptors.getDescriptorStride();
+    uint32_t byteSize = getDescriptorByteSize();
+    reserve(m_nb_descriptors + nbDescriptors);
+    const uint8_t * src = static_cast<const uint8_t *>(descriptors.data());
+    if ((srcStride == byteSize) && (getDescriptorStride() == byteSize))
+        m_buffer->appendData(src, nbDescriptors * byteSize);
+    else {
+        for (uint32_t i = 0; i < nbDescriptors; i++)
+            m_buffer->appendData(src + i * srcStride, byteSize, getDescriptorStride());
+    }
+    m_nb_descriptors += nbDescriptors;
+}
+
+void DescriptorBuffer::append(const DescriptorBuffer & descriptors, const std::vector<uint32_t> & indices)
+{
+    if ((m_descriptor_type != descriptors.getDescriptorType()) || (m_data_type != descriptors.getDescriptorDataType())
+            || (m_nb_elements != descriptors.getNbElements())) {
+        //throw
+        return;
+    }
+    uint32_t nbDescriptors = descriptors.getNbDescriptors();
+    for (const auto & index : indices) {
+        if (index >= nbDescriptors) {
+            //throw
+            return;
+        }
+    }
+    uint32_t srcStride = descriptors.getDescriptorStride();
+    reserve(m_nb_descriptors + static_cast<uint32_t>(indices.size()));
+    const uint8_t * src = static_cast<const uint8_t *>(descriptors.data());
+    for (const auto & index : indices)
+        m_buffer->appendData(src + index * srcStride, getDescriptorByteSize(), getDescriptorStride());
+    m_nb_descriptors += static_cast<uint32_t>(indices.size());
+}
+
+void DescriptorBuffer::reserve(uint32_t nb_descriptors)
+{
+    m_buffer->reserve(nb_descriptors * getDescriptorStride());
+}
+
 template<typename Archive>
 void DescriptorBuffer::serialize(Archive &ar, const unsigned int /* version */) {
+	// descriptors are always archived packed
+	if (Archive::is_loading::value)
+		m_row_alignment = DescriptorRowAlignment::ROW_PACKED;
 	ar & m_buffer;
 	ar & m_nb_descriptors;
 	ar & m_data_type;
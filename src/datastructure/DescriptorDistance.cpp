@@ -0,0 +1,1323 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "datastructure/DescriptorDistance.h"
+#include "core/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SOLAR_DISTANCE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SOLAR_DISTANCE_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and clang require the instruction set to be enabled per function to use its intrinsics
+// without compiling the whole library for this instruction set. MSVC always allows intrinsics.
+#if defined(SOLAR_DISTANCE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SOLAR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SOLAR_TARGET(isa)
+#endif
+
+namespace SolAR {
+namespace datastructure {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Scalar kernels
+// ---------------------------------------------------------------------------
+
+inline uint32_t popcount64(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<uint32_t>((x * 0x0101010101010101ULL) >> 56);
+}
+
+uint32_t hammingScalar(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    uint32_t dist = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        dist += popcount64(va ^ vb);
+    }
+    for (; i < n; i++)
+        dist += popcount64(static_cast<uint64_t>(a[i] ^ b[i]));
+    return dist;
+}
+
+float l2SquaredScalar(const float * a, const float * b, uint32_t n)
+{
+    float acc[4] = {0.f, 0.f, 0.f, 0.f};
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (uint32_t k = 0; k < 4; k++) {
+            float d = a[i + k] - b[i + k];
+            acc[k] += d * d;
+        }
+    }
+    for (; i < n; i++) {
+        float d = a[i] - b[i];
+        acc[0] += d * d;
+    }
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+uint32_t l2SquaredU8Scalar(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    uint32_t dist = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t d = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+        dist += static_cast<uint32_t>(d * d);
+    }
+    return dist;
+}
+
+float dotScalar(const float * a, const float * b, uint32_t n)
+{
+    float acc[4] = {0.f, 0.f, 0.f, 0.f};
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (uint32_t k = 0; k < 4; k++)
+            acc[k] += a[i + k] * b[i + k];
+    }
+    for (; i < n; i++)
+        acc[0] += a[i] * b[i];
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+void convertU8ToF32Scalar(const uint8_t * src, float * dst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = static_cast<float>(src[i]);
+}
+
+// round to nearest, saturated to [0, 255]
+void convertF32ToU8Scalar(const float * src, uint8_t * dst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = static_cast<uint8_t>(std::min(std::max(src[i], 0.f), 255.f) + 0.5f);
+}
+
+// y = alpha * y + beta * x
+void scaleAddScalar(const float * x, float beta, float * y, float alpha, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        y[i] = alpha * y[i] + beta * x[i];
+}
+
+void scaleAddU8Scalar(const uint8_t * x, float beta, float * y, float alpha, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        y[i] = alpha * y[i] + beta * static_cast<float>(x[i]);
+}
+
+#ifdef SOLAR_DISTANCE_X86
+// ---------------------------------------------------------------------------
+// SSE4.2 kernels
+// ---------------------------------------------------------------------------
+
+SOLAR_TARGET("sse4.2,popcnt")
+uint32_t hammingSSE42(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    uint64_t dist = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        dist += static_cast<uint64_t>(_mm_popcnt_u64(va ^ vb));
+    }
+    for (; i < n; i++)
+        dist += static_cast<uint64_t>(_mm_popcnt_u32(static_cast<uint32_t>(a[i] ^ b[i])));
+    return static_cast<uint32_t>(dist);
+}
+
+SOLAR_TARGET("sse4.2")
+inline float hsumSSE(__m128 v)
+{
+    __m128 shuf = _mm_movehdup_ps(v);
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+SOLAR_TARGET("sse4.2")
+float l2SquaredSSE42(const float * a, const float * b, uint32_t n)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d, d));
+    }
+    float dist = hsumSSE(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        float d = a[i] - b[i];
+        dist += d * d;
+    }
+    return dist;
+}
+
+SOLAR_TARGET("sse4.2")
+uint32_t l2SquaredU8SSE42(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    __m128i acc = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i va = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(a + i)));
+        __m128i vb = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(b + i)));
+        __m128i d = _mm_sub_epi16(va, vb);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(d, d));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t dist = static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+    return dist + l2SquaredU8Scalar(a + i, b + i, n - i);
+}
+
+SOLAR_TARGET("sse4.2")
+float dotSSE42(const float * a, const float * b, uint32_t n)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float dot = hsumSSE(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++)
+        dot += a[i] * b[i];
+    return dot;
+}
+
+SOLAR_TARGET("sse4.2")
+void convertU8ToF32SSE42(const uint8_t * src, float * dst, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4))));
+        _mm_storeu_ps(dst + i + 8, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+        _mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12))));
+    }
+    convertU8ToF32Scalar(src + i, dst + i, n - i);
+}
+
+SOLAR_TARGET("sse4.2")
+void convertF32ToU8SSE42(const float * src, uint8_t * dst, uint32_t n)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + i), half));
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + i + 4), half));
+        __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + i + 8), half));
+        __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(src + i + 12), half));
+        __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    }
+    convertF32ToU8Scalar(src + i, dst + i, n - i);
+}
+
+SOLAR_TARGET("sse4.2")
+void scaleAddSSE42(const float * x, float beta, float * y, float alpha, uint32_t n)
+{
+    const __m128 va = _mm_set1_ps(alpha);
+    const __m128 vb = _mm_set1_ps(beta);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(y + i)), _mm_mul_ps(vb, _mm_loadu_ps(x + i))));
+    scaleAddScalar(x + i, beta, y + i, alpha, n - i);
+}
+
+SOLAR_TARGET("sse4.2")
+void scaleAddU8SSE42(const uint8_t * x, float beta, float * y, float alpha, uint32_t n)
+{
+    const __m128 va = _mm_set1_ps(alpha);
+    const __m128 vb = _mm_set1_ps(beta);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t bytes;
+        std::memcpy(&bytes, x + i, sizeof(bytes));
+        __m128 vx = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(y + i)), _mm_mul_ps(vb, vx)));
+    }
+    scaleAddU8Scalar(x + i, beta, y + i, alpha, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels
+// ---------------------------------------------------------------------------
+
+SOLAR_TARGET("avx2,popcnt")
+uint32_t hammingAVX2(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    // nibble lookup popcount (W. Mula), accumulated with sad_epu8
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+        __m256i lo = _mm256_and_si256(v, lowMask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+    }
+    uint64_t dist = static_cast<uint64_t>(_mm256_extract_epi64(acc, 0)) + static_cast<uint64_t>(_mm256_extract_epi64(acc, 1))
+                  + static_cast<uint64_t>(_mm256_extract_epi64(acc, 2)) + static_cast<uint64_t>(_mm256_extract_epi64(acc, 3));
+    for (; i + 8 <= n; i += 8) {
+        uint64_t va, vb;
+        std::memcpy(&va, a + i, 8);
+        std::memcpy(&vb, b + i, 8);
+        dist += static_cast<uint64_t>(_mm_popcnt_u64(va ^ vb));
+    }
+    for (; i < n; i++)
+        dist += static_cast<uint64_t>(_mm_popcnt_u32(static_cast<uint32_t>(a[i] ^ b[i])));
+    return static_cast<uint32_t>(dist);
+}
+
+SOLAR_TARGET("avx2,fma")
+inline float hsumAVX(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuf = _mm_movehdup_ps(sum);
+    sum = _mm_add_ps(sum, shuf);
+    shuf = _mm_movehl_ps(shuf, sum);
+    sum = _mm_add_ss(sum, shuf);
+    return _mm_cvtss_f32(sum);
+}
+
+SOLAR_TARGET("avx2,fma")
+float l2SquaredAVX2(const float * a, const float * b, uint32_t n)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+    float dist = hsumAVX(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        float d = a[i] - b[i];
+        dist += d * d;
+    }
+    return dist;
+}
+
+SOLAR_TARGET("avx2")
+uint32_t l2SquaredU8AVX2(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+        __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+        __m256i d = _mm256_sub_epi16(va, vb);
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t dist = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+    return dist + l2SquaredU8Scalar(a + i, b + i, n - i);
+}
+
+SOLAR_TARGET("avx2,fma")
+float dotAVX2(const float * a, const float * b, uint32_t n)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8)
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    float dot = hsumAVX(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++)
+        dot += a[i] * b[i];
+    return dot;
+}
+
+SOLAR_TARGET("avx2")
+void convertU8ToF32AVX2(const uint8_t * src, float * dst, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)));
+        _mm256_storeu_ps(dst + i + 8, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+    }
+    convertU8ToF32Scalar(src + i, dst + i, n - i);
+}
+
+SOLAR_TARGET("avx2")
+void convertF32ToU8AVX2(const float * src, uint8_t * dst, uint32_t n)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    // the packs work per 128 bits lane, this permutation restores the order of the 32 bits groups
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(src + i), half));
+        __m256i b = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(src + i + 8), half));
+        __m256i c = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(src + i + 16), half));
+        __m256i d = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_loadu_ps(src + i + 24), half));
+        __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permutevar8x32_epi32(v, order));
+    }
+    convertF32ToU8SSE42(src + i, dst + i, n - i);
+}
+
+SOLAR_TARGET("avx2,fma")
+void scaleAddAVX2(const float * x, float beta, float * y, float alpha, uint32_t n)
+{
+    const __m256 va = _mm256_set1_ps(alpha);
+    const __m256 vb = _mm256_set1_ps(beta);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(vb, _mm256_loadu_ps(x + i), _mm256_mul_ps(va, _mm256_loadu_ps(y + i))));
+    scaleAddScalar(x + i, beta, y + i, alpha, n - i);
+}
+
+SOLAR_TARGET("avx2,fma")
+void scaleAddU8AVX2(const uint8_t * x, float beta, float * y, float alpha, uint32_t n)
+{
+    const __m256 va = _mm256_set1_ps(alpha);
+    const __m256 vb = _mm256_set1_ps(beta);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(x + i))));
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(vb, vx, _mm256_mul_ps(va, _mm256_loadu_ps(y + i))));
+    }
+    scaleAddU8Scalar(x + i, beta, y + i, alpha, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512 kernels
+// ---------------------------------------------------------------------------
+
+// the horizontal sums add the 256-bit halves extracted with an explicit source: _mm512_reduce_add_* and the 512 to 256-bit casts
+// extract into an undefined vector, which GCC 12 reports as uninitialized
+SOLAR_TARGET("avx512f")
+inline float hsumAVX512(__m512 v)
+{
+    __m256 low = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xff, _mm512_castps_pd(v), 0));
+    __m256 high = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xff, _mm512_castps_pd(v), 1));
+    return hsumAVX(_mm256_add_ps(low, high));
+}
+
+SOLAR_TARGET("avx512f")
+inline uint64_t hsumEpi64AVX512(__m512i v)
+{
+    __m256i low = _mm512_mask_extracti64x4_epi64(_mm256_setzero_si256(), 0xff, v, 0);
+    __m256i high = _mm512_mask_extracti64x4_epi64(_mm256_setzero_si256(), 0xff, v, 1);
+    __m256i sum256 = _mm256_add_epi64(low, high);
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sum256), _mm256_extracti128_si256(sum256, 1));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(sum)) + static_cast<uint64_t>(_mm_extract_epi64(sum, 1));
+}
+
+SOLAR_TARGET("avx512f")
+inline uint32_t hsumEpi32AVX512(__m512i v)
+{
+    __m256i low = _mm512_mask_extracti64x4_epi64(_mm256_setzero_si256(), 0xff, v, 0);
+    __m256i high = _mm512_mask_extracti64x4_epi64(_mm256_setzero_si256(), 0xff, v, 1);
+    __m256i sum256 = _mm256_add_epi32(low, high);
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sum256), _mm256_extracti128_si256(sum256, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+}
+
+SOLAR_TARGET("avx512f,avx512bw,avx512vpopcntdq")
+uint32_t hammingAVX512(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    __m512i acc = _mm512_setzero_si512();
+    uint32_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    if (i < n) {
+        __mmask64 mask = (~0ULL) >> (64 - (n - i));
+        __m512i v = _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, a + i), _mm512_maskz_loadu_epi8(mask, b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    return static_cast<uint32_t>(hsumEpi64AVX512(acc));
+}
+
+SOLAR_TARGET("avx512f")
+float l2SquaredAVX512(const float * a, const float * b, uint32_t n)
+{
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc0 = _mm512_fmadd_ps(d, d, acc0);
+    }
+    if (i < n) {
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        acc1 = _mm512_fmadd_ps(d, d, acc1);
+    }
+    return hsumAVX512(_mm512_add_ps(acc0, acc1));
+}
+
+SOLAR_TARGET("avx512f,avx512bw,avx512vl")
+uint32_t l2SquaredU8AVX512(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    __m512i acc = _mm512_setzero_si512();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i va = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)));
+        __m512i vb = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+        __m512i d = _mm512_sub_epi16(va, vb);
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+    }
+    if (i < n) {
+        __mmask32 mask = static_cast<__mmask32>((~0u) >> (32 - (n - i)));
+        __m512i va = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(mask, a + i));
+        __m512i vb = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(mask, b + i));
+        __m512i d = _mm512_sub_epi16(va, vb);
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+    }
+    return hsumEpi32AVX512(acc);
+}
+
+SOLAR_TARGET("avx512f")
+float dotAVX512(const float * a, const float * b, uint32_t n)
+{
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16)
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    if (i < n) {
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return hsumAVX512(_mm512_add_ps(acc0, acc1));
+}
+#endif // SOLAR_DISTANCE_X86
+
+#ifdef SOLAR_DISTANCE_NEON
+// ---------------------------------------------------------------------------
+// NEON kernels
+// ---------------------------------------------------------------------------
+
+uint32_t hammingNEON(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t cnt = vcntq_u8(veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        acc = vpadalq_u16(acc, vpaddlq_u8(cnt));
+    }
+    return vaddvq_u32(acc) + hammingScalar(a + i, b + i, n - i);
+}
+
+float l2SquaredNEON(const float * a, const float * b, uint32_t n)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.f);
+    float32x4_t acc1 = vdupq_n_f32(0.f);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc0 = vfmaq_f32(acc0, d0, d0);
+        acc1 = vfmaq_f32(acc1, d1, d1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t d = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        acc0 = vfmaq_f32(acc0, d, d);
+    }
+    float dist = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < n; i++) {
+        float d = a[i] - b[i];
+        dist += d * d;
+    }
+    return dist;
+}
+
+uint32_t l2SquaredU8NEON(const uint8_t * a, const uint8_t * b, uint32_t n)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+        acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(d), vget_high_u8(d)));
+    }
+    return vaddvq_u32(acc) + l2SquaredU8Scalar(a + i, b + i, n - i);
+}
+
+float dotNEON(const float * a, const float * b, uint32_t n)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.f);
+    float32x4_t acc1 = vdupq_n_f32(0.f);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    float dot = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < n; i++)
+        dot += a[i] * b[i];
+    return dot;
+}
+
+void convertU8ToF32NEON(const uint8_t * src, float * dst, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        vst1q_f32(dst + i, vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))));
+        vst1q_f32(dst + i + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))));
+        vst1q_f32(dst + i + 8, vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))));
+        vst1q_f32(dst + i + 12, vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))));
+    }
+    convertU8ToF32Scalar(src + i, dst + i, n - i);
+}
+
+void convertF32ToU8NEON(const float * src, uint8_t * dst, uint32_t n)
+{
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // vcvtq_u32_f32 truncates and saturates negative values to 0
+        uint32x4_t a = vcvtq_u32_f32(vaddq_f32(vld1q_f32(src + i), half));
+        uint32x4_t b = vcvtq_u32_f32(vaddq_f32(vld1q_f32(src + i + 4), half));
+        vst1_u8(dst + i, vqmovn_u16(vcombine_u16(vqmovn_u32(a), vqmovn_u32(b))));
+    }
+    convertF32ToU8Scalar(src + i, dst + i, n - i);
+}
+
+void scaleAddNEON(const float * x, float beta, float * y, float alpha, uint32_t n)
+{
+    const float32x4_t va = vdupq_n_f32(alpha);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(y + i, vfmaq_n_f32(vmulq_f32(va, vld1q_f32(y + i)), vld1q_f32(x + i), beta));
+    scaleAddScalar(x + i, beta, y + i, alpha, n - i);
+}
+
+void scaleAddU8NEON(const uint8_t * x, float beta, float * y, float alpha, uint32_t n)
+{
+    const float32x4_t va = vdupq_n_f32(alpha);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t v = vmovl_u8(vld1_u8(x + i));
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+        vst1q_f32(y + i, vfmaq_n_f32(vmulq_f32(va, vld1q_f32(y + i)), lo, beta));
+        vst1q_f32(y + i + 4, vfmaq_n_f32(vmulq_f32(va, vld1q_f32(y + i + 4)), hi, beta));
+    }
+    scaleAddU8Scalar(x + i, beta, y + i, alpha, n - i);
+}
+#endif // SOLAR_DISTANCE_NEON
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+// ---------------------------------------------------------------------------
+
+struct DistanceKernels {
+    DistanceKernelISA isa;
+    uint32_t (*hamming)(const uint8_t *, const uint8_t *, uint32_t);
+    float (*l2Squared)(const float *, const float *, uint32_t);
+    uint32_t (*l2SquaredU8)(const uint8_t *, const uint8_t *, uint32_t);
+    float (*dot)(const float *, const float *, uint32_t);
+    void (*u8ToF32)(const uint8_t *, float *, uint32_t);
+    void (*f32ToU8)(const float *, uint8_t *, uint32_t);
+    void (*scaleAdd)(const float *, float, float *, float, uint32_t);
+    void (*scaleAddU8)(const uint8_t *, float, float *, float, uint32_t);
+};
+
+const DistanceKernels scalarKernels = {DistanceKernelISA::SCALAR, hammingScalar, l2SquaredScalar, l2SquaredU8Scalar, dotScalar,
+                                       convertU8ToF32Scalar, convertF32ToU8Scalar, scaleAddScalar, scaleAddU8Scalar};
+#ifdef SOLAR_DISTANCE_X86
+const DistanceKernels sse42Kernels = {DistanceKernelISA::SSE42, hammingSSE42, l2SquaredSSE42, l2SquaredU8SSE42, dotSSE42,
+                                      convertU8ToF32SSE42, convertF32ToU8SSE42, scaleAddSSE42, scaleAddU8SSE42};
+const DistanceKernels avx2Kernels = {DistanceKernelISA::AVX2, hammingAVX2, l2SquaredAVX2, l2SquaredU8AVX2, dotAVX2,
+                                     convertU8ToF32AVX2, convertF32ToU8AVX2, scaleAddAVX2, scaleAddU8AVX2};
+// element-wise operations are memory bound: the AVX2 versions are used on AVX-512 CPUs
+const DistanceKernels avx512Kernels = {DistanceKernelISA::AVX512, hammingAVX512, l2SquaredAVX512, l2SquaredU8AVX512, dotAVX512,
+                                       convertU8ToF32AVX2, convertF32ToU8AVX2, scaleAddAVX2, scaleAddU8AVX2};
+// AVX-512 without VPOPCNTDQ (Skylake-X, Cascade Lake): the AVX2 nibble lookup is the fastest popcount
+const DistanceKernels avx512NoPopcntKernels = {DistanceKernelISA::AVX512, hammingAVX2, l2SquaredAVX512, l2SquaredU8AVX512, dotAVX512,
+                                               convertU8ToF32AVX2, convertF32ToU8AVX2, scaleAddAVX2, scaleAddU8AVX2};
+#endif
+#ifdef SOLAR_DISTANCE_NEON
+const DistanceKernels neonKernels = {DistanceKernelISA::NEON, hammingNEON, l2SquaredNEON, l2SquaredU8NEON, dotNEON,
+                                     convertU8ToF32NEON, convertF32ToU8NEON, scaleAddNEON, scaleAddU8NEON};
+#endif
+
+#ifdef SOLAR_DISTANCE_X86
+struct CpuFeatures {
+    bool sse42 = false;
+    bool popcnt = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool avx512vl = false;
+    bool avx512vpopcntdq = false;
+};
+
+CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures features;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.sse42 = (info[2] & (1 << 20)) != 0;
+    features.popcnt = (info[2] & (1 << 23)) != 0;
+    features.fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool osAvx = (xcr0 & 0x6) == 0x6;
+    bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = osAvx && (info[1] & (1 << 5)) != 0;
+        features.avx512f = osAvx512 && (info[1] & (1 << 16)) != 0;
+        features.avx512bw = osAvx512 && (info[1] & (1 << 30)) != 0;
+        features.avx512vl = osAvx512 && (info[1] & (1u << 31)) != 0;
+        features.avx512vpopcntdq = osAvx512 && (info[2] & (1 << 14)) != 0;
+    }
+    features.fma = features.fma && osAvx;
+#else
+    __builtin_cpu_init();
+    features.sse42 = __builtin_cpu_supports("sse4.2");
+    features.popcnt = __builtin_cpu_supports("popcnt");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.fma = __builtin_cpu_supports("fma");
+    features.avx512f = __builtin_cpu_supports("avx512f");
+    features.avx512bw = __builtin_cpu_supports("avx512bw");
+    features.avx512vl = __builtin_cpu_supports("avx512vl");
+    features.avx512vpopcntdq = __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+    return features;
+}
+#endif
+
+const DistanceKernels * selectKernels(DistanceKernelISA requested)
+{
+#ifdef SOLAR_DISTANCE_X86
+    static const CpuFeatures features = detectCpuFeatures();
+    if (requested >= DistanceKernelISA::AVX512 && features.avx512f && features.avx512bw && features.avx512vl)
+        return features.avx512vpopcntdq ? &avx512Kernels : &avx512NoPopcntKernels;
+    if (requested >= DistanceKernelISA::AVX2 && features.avx2 && features.fma && features.popcnt)
+        return &avx2Kernels;
+    if (requested >= DistanceKernelISA::SSE42 && features.sse42 && features.popcnt)
+        return &sse42Kernels;
+#elif defined(SOLAR_DISTANCE_NEON)
+    if (requested != DistanceKernelISA::SCALAR)
+        return &neonKernels;
+#endif
+    (void)requested;
+    return &scalarKernels;
+}
+
+const DistanceKernels * bestKernels()
+{
+#ifdef SOLAR_DISTANCE_X86
+    return selectKernels(DistanceKernelISA::AVX512);
+#elif defined(SOLAR_DISTANCE_NEON)
+    return selectKernels(DistanceKernelISA::NEON);
+#else
+    return selectKernels(DistanceKernelISA::SCALAR);
+#endif
+}
+
+std::atomic<const DistanceKernels *> & currentKernels()
+{
+    static std::atomic<const DistanceKernels *> kernels(bestKernels());
+    return kernels;
+}
+
+inline const DistanceKernels & kernels()
+{
+    return *currentKernels().load(std::memory_order_relaxed);
+}
+
+// Number of bytes of train descriptors kept hot in L1 cache while computing a distance matrix
+constexpr uint32_t DISTANCE_TILE_BYTES = 16 * 1024;
+
+// Compute the distances between one query and a range of train descriptors, stored trainStride bytes apart
+void distancesToRange(const DistanceKernels & k, DescriptorDistanceType distanceType, DescriptorDataType dataType,
+                      const void * query, const uint8_t * train, uint32_t trainStride, uint32_t nbTrain,
+                      uint32_t nbElements, float * distances)
+{
+    if (distanceType == DescriptorDistanceType::HAMMING) {
+        const uint8_t * q = static_cast<const uint8_t *>(query);
+        for (uint32_t j = 0; j < nbTrain; j++)
+            distances[j] = static_cast<float>(k.hamming(q, train + j * trainStride, nbElements));
+    }
+    else if (dataType == DescriptorDataType::TYPE_8U) {
+        const uint8_t * q = static_cast<const uint8_t *>(query);
+        for (uint32_t j = 0; j < nbTrain; j++)
+            distances[j] = std::sqrt(static_cast<float>(k.l2SquaredU8(q, train + j * trainStride, nbElements)));
+    }
+    else {
+        const float * q = static_cast<const float *>(query);
+        for (uint32_t j = 0; j < nbTrain; j++)
+            distances[j] = std::sqrt(k.l2Squared(q, reinterpret_cast<const float *>(train + j * trainStride), nbElements));
+    }
+}
+
+// Hamming distance is only meaningful on bytes, and product quantization codes are compared by a ProductQuantizer
+inline bool isValidDistance(DescriptorDistanceType distanceType, DescriptorDataType dataType)
+{
+    if (distanceType == DescriptorDistanceType::ADC)
+        return false;
+    return distanceType != DescriptorDistanceType::HAMMING || dataType == DescriptorDataType::TYPE_8U;
+}
+
+// Match the query descriptors against several sets of train descriptors.
+// The work is split in tasks of one block of queries against one train set: a thread keeps its queries hot in cache
+// while it walks the train set by tiles. The train sets are matched in parallel, and the queries are split in blocks
+// when there are fewer train sets than threads.
+FrameworkReturnCode matchDescriptorSets(const DescriptorBuffer & query, const std::vector<const DescriptorBuffer *> & trainSets,
+                                        float distanceRatio, bool crossCheck, std::vector<std::vector<DescriptorMatch>> & matches,
+                                        uint32_t maxThreads)
+{
+    matches.clear();
+    matches.resize(trainSets.size());
+    DescriptorDistanceType distanceType = getDescriptorDistanceType(query.getDescriptorType());
+    DescriptorDataType dataType = query.getDescriptorDataType();
+    uint32_t nbElements = query.getNbElements();
+    if (!isValidDistance(distanceType, dataType))
+        return FrameworkReturnCode::_ERROR_;
+    for (const auto & train : trainSets) {
+        if ((train->getDescriptorType() != query.getDescriptorType()) || (train->getDescriptorDataType() != dataType)
+                || (train->getNbElements() != nbElements))
+            return FrameworkReturnCode::_ERROR_;
+    }
+    uint32_t nbQuery = query.getNbDescriptors();
+    uint32_t nbSets = static_cast<uint32_t>(trainSets.size());
+    if (nbQuery == 0 || nbSets == 0)
+        return FrameworkReturnCode::_SUCCESS;
+    const DistanceKernels & k = kernels();
+    uint32_t queryStride = query.getDescriptorStride();
+    const uint8_t * queryData = static_cast<const uint8_t *>(query.data());
+    ThreadPool & pool = ThreadPool::instance();
+    uint32_t nbThreads = maxThreads > 0 ? std::min(maxThreads, pool.getNbThreads()) : pool.getNbThreads();
+    uint32_t nbBlocks = std::min((nbThreads + nbSets - 1) / nbSets, nbQuery);
+    uint32_t blockSize = (nbQuery + nbBlocks - 1) / nbBlocks;
+    nbBlocks = (nbQuery + blockSize - 1) / blockSize;
+    // offsets of the train sets in the arrays of the nearest queries of the train descriptors, one array per block
+    std::vector<size_t> trainOffsets(nbSets + 1, 0);
+    uint32_t maxTileSize = 1;
+    for (uint32_t s = 0; s < nbSets; s++) {
+        trainOffsets[s + 1] = trainOffsets[s] + trainSets[s]->getNbDescriptors();
+        maxTileSize = std::max(maxTileSize, DISTANCE_TILE_BYTES / trainSets[s]->getDescriptorStride());
+    }
+    size_t nbTrain = trainOffsets[nbSets];
+    constexpr float maxDistance = std::numeric_limits<float>::max();
+    // two nearest neighbours of each query in each train set
+    std::vector<float> best1(static_cast<size_t>(nbSets) * nbQuery, maxDistance), best2(best1.size(), maxDistance);
+    std::vector<uint32_t> bestIndex(best1.size(), 0);
+    // nearest query of each train descriptor, per block
+    std::vector<float> trainBest(crossCheck ? nbBlocks * nbTrain : 0, maxDistance);
+    std::vector<uint32_t> trainBestIndex(trainBest.size(), 0);
+    std::vector<float> tiles(static_cast<size_t>(nbSets) * nbBlocks * maxTileSize);
+    pool.parallelFor(nbSets * nbBlocks, [&](uint32_t task) {
+        uint32_t set = task / nbBlocks;
+        uint32_t block = task % nbBlocks;
+        const DescriptorBuffer & train = *trainSets[set];
+        uint32_t nbSetTrain = train.getNbDescriptors();
+        uint32_t trainStride = train.getDescriptorStride();
+        const uint8_t * trainData = static_cast<const uint8_t *>(train.data());
+        uint32_t tileSize = std::max<uint32_t>(1, DISTANCE_TILE_BYTES / trainStride);
+        uint32_t queryStart = block * blockSize;
+        uint32_t queryEnd = std::min(queryStart + blockSize, nbQuery);
+        float * distances = &tiles[static_cast<size_t>(task) * maxTileSize];
+        float * setBest1 = &best1[static_cast<size_t>(set) * nbQuery];
+        float * setBest2 = &best2[static_cast<size_t>(set) * nbQuery];
+        uint32_t * setBestIndex = &bestIndex[static_cast<size_t>(set) * nbQuery];
+        float * columnBest = crossCheck ? &trainBest[block * nbTrain + trainOffsets[set]] : nullptr;
+        uint32_t * columnBestIndex = crossCheck ? &trainBestIndex[block * nbTrain + trainOffsets[set]] : nullptr;
+        // the train tile stays in cache while all the queries of the block are compared to it
+        for (uint32_t tileStart = 0; tileStart < nbSetTrain; tileStart += tileSize) {
+            uint32_t tileEnd = std::min(tileStart + tileSize, nbSetTrain);
+            for (uint32_t i = queryStart; i < queryEnd; i++) {
+                distancesToRange(k, distanceType, dataType, queryData + static_cast<size_t>(i) * queryStride,
+                                 trainData + static_cast<size_t>(tileStart) * trainStride, trainStride, tileEnd - tileStart,
+                                 nbElements, distances);
+                float d1 = setBest1[i], d2 = setBest2[i];
+                uint32_t index1 = setBestIndex[i];
+                for (uint32_t j = tileStart; j < tileEnd; j++) {
+                    float d = distances[j - tileStart];
+                    if (d < d2) {
+                        if (d < d1) {
+                            d2 = d1;
+                            d1 = d;
+                            index1 = j;
+                        }
+                        else
+                            d2 = d;
+                    }
+                    if (crossCheck && (d < columnBest[j])) {
+                        columnBest[j] = d;
+                        columnBestIndex[j] = i;
+                    }
+                }
+                setBest1[i] = d1;
+                setBest2[i] = d2;
+                setBestIndex[i] = index1;
+            }
+        }
+    }, maxThreads);
+    // merge the nearest queries of the train descriptors found by the blocks, the lower query index wins ties
+    for (uint32_t block = 1; crossCheck && (block < nbBlocks); block++) {
+        for (size_t j = 0; j < nbTrain; j++) {
+            if (trainBest[block * nbTrain + j] < trainBest[j]) {
+                trainBest[j] = trainBest[block * nbTrain + j];
+                trainBestIndex[j] = trainBestIndex[block * nbTrain + j];
+            }
+        }
+    }
+    for (uint32_t set = 0; set < nbSets; set++) {
+        const float * setBest1 = &best1[static_cast<size_t>(set) * nbQuery];
+        const float * setBest2 = &best2[static_cast<size_t>(set) * nbQuery];
+        const uint32_t * setBestIndex = &bestIndex[static_cast<size_t>(set) * nbQuery];
+        bool ratioTest = (distanceRatio < 1.f) && (trainSets[set]->getNbDescriptors() > 1);
+        for (uint32_t i = 0; i < nbQuery; i++) {
+            if (setBest1[i] == maxDistance)
+                continue;
+            if (ratioTest && !(setBest1[i] < distanceRatio * setBest2[i]))
+                continue;
+            if (crossCheck && (trainBestIndex[trainOffsets[set] + setBestIndex[i]] != i))
+                continue;
+            matches[set].emplace_back(i, setBestIndex[i], setBest1[i]);
+        }
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+}
+
+std::string toString(const DistanceKernelISA isa)
+{
+    switch (isa) {
+        case DistanceKernelISA::SCALAR:
+            return "SCALAR";
+        case DistanceKernelISA::SSE42:
+            return "SSE42";
+        case DistanceKernelISA::AVX2:
+            return "AVX2";
+        case DistanceKernelISA::AVX512:
+            return "AVX512";
+        case DistanceKernelISA::NEON:
+            return "NEON";
+        default:
+            return "Unknown value";
+    }
+}
+
+DistanceKernelISA getDistanceKernelISA()
+{
+    return kernels().isa;
+}
+
+DistanceKernelISA setDistanceKernelISA(const DistanceKernelISA isa)
+{
+    const DistanceKernels * selected = selectKernels(isa);
+    currentKernels().store(selected, std::memory_order_relaxed);
+    return selected->isa;
+}
+
+uint32_t hammingDistance(const uint8_t * desc1, const uint8_t * desc2, uint32_t nbBytes)
+{
+    return kernels().hamming(desc1, desc2, nbBytes);
+}
+
+float l2SquaredDistance(const float * desc1, const float * desc2, uint32_t nbElements)
+{
+    return kernels().l2Squared(desc1, desc2, nbElements);
+}
+
+uint32_t l2SquaredDistance(const uint8_t * desc1, const uint8_t * desc2, uint32_t nbElements)
+{
+    return kernels().l2SquaredU8(desc1, desc2, nbElements);
+}
+
+float dotProduct(const float * desc1, const float * desc2, uint32_t nbElements)
+{
+    return kernels().dot(desc1, desc2, nbElements);
+}
+
+void convertDescriptorData(const uint8_t * src, float * dst, uint32_t nbElements)
+{
+    kernels().u8ToF32(src, dst, nbElements);
+}
+
+void convertDescriptorData(const float * src, uint8_t * dst, uint32_t nbElements)
+{
+    kernels().f32ToU8(src, dst, nbElements);
+}
+
+void scaleAdd(const float * x, float beta, float * y, float alpha, uint32_t nbElements)
+{
+    kernels().scaleAdd(x, beta, y, alpha, nbElements);
+}
+
+void scaleAdd(const uint8_t * x, float beta, float * y, float alpha, uint32_t nbElements)
+{
+    kernels().scaleAddU8(x, beta, y, alpha, nbElements);
+}
+
+float descriptorDistance(const DescriptorView & desc1, const DescriptorView & desc2)
+{
+    DescriptorDistanceType distanceType = getDescriptorDistanceType(desc1.type());
+    if ((desc1.type() != desc2.type()) || (desc1.dataType() != desc2.dataType()) || (desc1.length() != desc2.length())
+            || !isValidDistance(distanceType, desc1.dataType()))
+        return -1.f;
+    float distance;
+    distancesToRange(kernels(), distanceType, desc1.dataType(), desc1.data(), static_cast<const uint8_t *>(desc2.data()),
+                     0, 1, desc1.length(), &distance);
+    return distance;
+}
+
+FrameworkReturnCode computeDistances(const DescriptorView & query, const DescriptorBuffer & train, std::vector<float> & distances)
+{
+    DescriptorDistanceType distanceType = getDescriptorDistanceType(query.type());
+    if ((query.type() != train.getDescriptorType()) || (query.dataType() != train.getDescriptorDataType())
+            || (query.length() != train.getNbElements()) || !isValidDistance(distanceType, query.dataType()))
+        return FrameworkReturnCode::_ERROR_;
+    distances.resize(train.getNbDescriptors());
+    if (train.getNbDescriptors() == 0)
+        return FrameworkReturnCode::_SUCCESS;
+    distancesToRange(kernels(), distanceType, query.dataType(), query.data(), static_cast<const uint8_t *>(train.data()),
+                     train.getDescriptorStride(), train.getNbDescriptors(), train.getNbElements(), distances.data());
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode computeDistanceMatrix(const DescriptorBuffer & query, const DescriptorBuffer & train, std::vector<float> & distances)
+{
+    DescriptorDistanceType distanceType = getDescriptorDistanceType(query.getDescriptorType());
+    if ((query.getDescriptorType() != train.getDescriptorType()) || (query.getDescriptorDataType() != train.getDescriptorDataType())
+            || (query.getNbElements() != train.getNbElements()) || !isValidDistance(distanceType, query.getDescriptorDataType()))
+        return FrameworkReturnCode::_ERROR_;
+    uint32_t nbQuery = query.getNbDescriptors();
+    uint32_t nbTrain = train.getNbDescriptors();
+    distances.resize(static_cast<size_t>(nbQuery) * nbTrain);
+    if (nbQuery == 0 || nbTrain == 0)
+        return FrameworkReturnCode::_SUCCESS;
+    const DistanceKernels & k = kernels();
+    uint32_t queryStride = query.getDescriptorStride();
+    uint32_t trainStride = train.getDescriptorStride();
+    const uint8_t * queryData = static_cast<const uint8_t *>(query.data());
+    const uint8_t * trainData = static_cast<const uint8_t *>(train.data());
+    // block the train descriptors so that each tile stays in cache while all queries are compared to it
+    uint32_t tileSize = std::max<uint32_t>(1, DISTANCE_TILE_BYTES / trainStride);
+    for (uint32_t tileStart = 0; tileStart < nbTrain; tileStart += tileSize) {
+        uint32_t tileEnd = std::min(tileStart + tileSize, nbTrain);
+        for (uint32_t i = 0; i < nbQuery; i++)
+            distancesToRange(k, distanceType, query.getDescriptorDataType(), queryData + static_cast<size_t>(i) * queryStride,
+                             trainData + static_cast<size_t>(tileStart) * trainStride, trainStride, tileEnd - tileStart,
+                             query.getNbElements(), &distances[static_cast<size_t>(i) * nbTrain + tileStart]);
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode matchDescriptors(const DescriptorBuffer & descriptors1, const DescriptorBuffer & descriptors2,
+                                     float distanceRatio, bool crossCheck, std::vector<DescriptorMatch> & matches, uint32_t maxThreads)
+{
+    matches.clear();
+    std::vector<std::vector<DescriptorMatch>> setMatches;
+    if (matchDescriptorSets(descriptors1, {&descriptors2}, distanceRatio, crossCheck, setMatches, maxThreads) != FrameworkReturnCode::_SUCCESS)
+        return FrameworkReturnCode::_ERROR_;
+    matches.swap(setMatches[0]);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode matchDescriptors(const DescriptorBuffer & descriptors1, const std::vector<SRef<DescriptorBuffer>> & descriptors2,
+                                     float distanceRatio, bool crossCheck, std::vector<std::vector<DescriptorMatch>> & matches, uint32_t maxThreads)
+{
+    std::vector<const DescriptorBuffer *> trainSets;
+    trainSets.reserve(descriptors2.size());
+    for (const auto & descriptors : descriptors2) {
+        if (!descriptors) {
+            matches.clear();
+            return FrameworkReturnCode::_ERROR_;
+        }
+        trainSets.push_back(descriptors.get());
+    }
+    return matchDescriptorSets(descriptors1, trainSets, distanceRatio, crossCheck, matches, maxThreads);
+}
+
+FrameworkReturnCode matchCandidateDescriptors(const DescriptorBuffer & descriptors1, const DescriptorBuffer & descriptors2,
+                                              const std::function<void(uint32_t, std::vector<uint32_t> &)> & getCandidates,
+                                              float distanceRatio, bool crossCheck, float maxDistance, std::vector<DescriptorMatch> & matches)
+{
+    matches.clear();
+    DescriptorDistanceType distanceType = getDescriptorDistanceType(descriptors1.getDescriptorType());
+    DescriptorDataType dataType = descriptors1.getDescriptorDataType();
+    uint32_t nbElements = descriptors1.getNbElements();
+    if ((descriptors2.getDescriptorType() != descriptors1.getDescriptorType()) || (descriptors2.getDescriptorDataType() != dataType)
+            || (descriptors2.getNbElements() != nbElements) || !isValidDistance(distanceType, dataType))
+        return FrameworkReturnCode::_ERROR_;
+    const DistanceKernels & k = kernels();
+    uint32_t nbQuery = descriptors1.getNbDescriptors();
+    uint32_t nbTrain = descriptors2.getNbDescriptors();
+    uint32_t queryStride = descriptors1.getDescriptorStride();
+    uint32_t trainStride = descriptors2.getDescriptorStride();
+    const uint8_t * queryData = static_cast<const uint8_t *>(descriptors1.data());
+    const uint8_t * trainData = static_cast<const uint8_t *>(descriptors2.data());
+    constexpr float noDistance = std::numeric_limits<float>::max();
+    // nearest query of each train descriptor among the queries matched to it
+    std::vector<float> trainBest(crossCheck ? nbTrain : 0, noDistance);
+    std::vector<uint32_t> trainBestIndex(trainBest.size(), 0);
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < nbQuery; i++) {
+        candidates.clear();
+        getCandidates(i, candidates);
+        const uint8_t * query = queryData + static_cast<size_t>(i) * queryStride;
+        float best1 = noDistance, best2 = noDistance;
+        uint32_t bestIndex = nbTrain;
+        for (const auto & j : candidates) {
+            if (j >= nbTrain)
+                continue;
+            float d;
+            distancesToRange(k, distanceType, dataType, query, trainData + static_cast<size_t>(j) * trainStride, 0, 1, nbElements, &d);
+            if ((d < best1) || ((d == best1) && (j < bestIndex))) {
+                best2 = best1;
+                best1 = d;
+                bestIndex = j;
+            }
+            else if (d < best2)
+                best2 = d;
+        }
+        if (bestIndex == nbTrain)
+            continue;
+        if ((maxDistance >= 0.f) && (best1 > maxDistance))
+            continue;
+        if ((distanceRatio < 1.f) && !(best1 < distanceRatio * best2))
+            continue;
+        if (crossCheck) {
+            if (!(best1 < trainBest[bestIndex]))
+                continue;
+            trainBest[bestIndex] = best1;
+            trainBestIndex[bestIndex] = i;
+        }
+        matches.emplace_back(i, bestIndex, best1);
+    }
+    if (crossCheck)
+        matches.erase(std::remove_if(matches.begin(), matches.end(), [&](const DescriptorMatch & match) {
+            return trainBestIndex[match.getIndexInDescriptorB()] != match.getIndexInDescriptorA(); }), matches.end());
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+uint32_t findNearestCentroid(const float * vector, const float * centroids, uint32_t nbCentroids, uint32_t dimension, float & distance)
+{
+    uint32_t best = 0;
+    distance = std::numeric_limits<float>::max();
+    const DistanceKernels & k = kernels();
+    for (uint32_t c = 0; c < nbCentroids; c++) {
+        const float * centroid = centroids + static_cast<size_t>(c) * dimension;
+        float d;
+        // short vectors (product quantization sub-vectors) are faster without the kernel call
+        if (dimension < 16) {
+            d = 0.f;
+            for (uint32_t j = 0; j < dimension; j++) {
+                float diff = vector[j] - centroid[j];
+                d += diff * diff;
+            }
+        }
+        else
+            d = k.l2Squared(vector, centroid, dimension);
+        if (d < distance) {
+            distance = d;
+            best = c;
+        }
+    }
+    return best;
+}
+
+FrameworkReturnCode computeKMeans(const float * vectors, uint32_t nbVectors, uint32_t dimension,
+                                  uint32_t nbClusters, uint32_t nbIterations, std::vector<float> & centroids)
+{
+    if ((nbClusters == 0) || (nbVectors < nbClusters) || (dimension == 0))
+        return FrameworkReturnCode::_ERROR_;
+    const DistanceKernels & k = kernels();
+    std::mt19937 rng(0);
+    centroids.resize(static_cast<size_t>(nbClusters) * dimension);
+    // initialization with distinct random vectors
+    std::vector<uint32_t> indices(nbVectors);
+    std::iota(indices.begin(), indices.end(), 0);
+    for (uint32_t c = 0; c < nbClusters; c++) {
+        std::swap(indices[c], indices[c + rng() % (nbVectors - c)]);
+        std::memcpy(&centroids[static_cast<size_t>(c) * dimension], vectors + static_cast<size_t>(indices[c]) * dimension, dimension * sizeof(float));
+    }
+    std::vector<uint32_t> assignment(nbVectors, nbClusters);
+    std::vector<uint32_t> counts(nbClusters);
+    for (uint32_t iter = 0; iter < nbIterations; iter++) {
+        uint32_t nbChanges = 0;
+        for (uint32_t i = 0; i < nbVectors; i++) {
+            float distance;
+            uint32_t c = findNearestCentroid(vectors + static_cast<size_t>(i) * dimension, centroids.data(), nbClusters, dimension, distance);
+            if (c != assignment[i]) {
+                assignment[i] = c;
+                nbChanges++;
+            }
+        }
+        if (nbChanges == 0)
+            break;
+        std::fill(centroids.begin(), centroids.end(), 0.f);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (uint32_t i = 0; i < nbVectors; i++) {
+            k.scaleAdd(vectors + static_cast<size_t>(i) * dimension, 1.f, &centroids[static_cast<size_t>(assignment[i]) * dimension], 1.f, dimension);
+            counts[assignment[i]]++;
+        }
+        for (uint32_t c = 0; c < nbClusters; c++) {
+            float * centroid = &centroids[static_cast<size_t>(c) * dimension];
+            if (counts[c] > 0)
+                k.scaleAdd(centroid, 0.f, centroid, 1.f / counts[c], dimension);
+            else {
+                // empty cluster: restart it on a random vector
+                uint32_t i = rng() % nbVectors;
+                std::memcpy(centroid, vectors + static_cast<size_t>(i) * dimension, dimension * sizeof(float));
+            }
+        }
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode computeMeanDescriptor(const DescriptorBuffer & descriptors, DescriptorBuffer & mean)
+{
+    uint32_t nbDescriptors = descriptors.getNbDescriptors();
+    uint32_t nbElements = descriptors.getNbElements();
+    if (nbDescriptors == 0)
+        return FrameworkReturnCode::_ERROR_;
+    // the sum is accumulated in float, in a row allocated once per thread
+    thread_local std::vector<float> sum;
+    sum.assign(nbElements, 0.f);
+    const DistanceKernels & k = kernels();
+    const uint8_t * rows = static_cast<const uint8_t *>(descriptors.data());
+    uint32_t stride = descriptors.getDescriptorStride();
+    for (uint32_t i = 0; i < nbDescriptors; i++) {
+        if (descriptors.getDescriptorDataType() == DescriptorDataType::TYPE_8U)
+            k.scaleAddU8(rows + i * stride, 1.f, sum.data(), 1.f, nbElements);
+        else
+            k.scaleAdd(reinterpret_cast<const float *>(rows + i * stride), 1.f, sum.data(), 1.f, nbElements);
+    }
+    k.scaleAdd(sum.data(), 0.f, sum.data(), 1.f / nbDescriptors, nbElements);
+    mean.reshape(descriptors.getDescriptorType(), descriptors.getDescriptorDataType(), nbElements, 1);
+    if (mean.getDescriptorDataType() == DescriptorDataType::TYPE_8U)
+        k.f32ToU8(sum.data(), static_cast<uint8_t *>(mean.data()), nbElements);
+    else
+        std::memcpy(mean.data(), sum.data(), nbElements * sizeof(float));
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode computeMedoidDescriptor(const DescriptorBuffer & descriptors, uint32_t & medoidIndex)
+{
+    uint32_t nbDescriptors = descriptors.getNbDescriptors();
+    if (nbDescriptors == 0)
+        return FrameworkReturnCode::_ERROR_;
+    DescriptorDistanceType distanceType = getDescriptorDistanceType(descriptors.getDescriptorType());
+    if (!isValidDistance(distanceType, descriptors.getDescriptorDataType()))
+        return FrameworkReturnCode::_ERROR_;
+    // the distances are symmetric: each pair is computed once and added to both descriptors
+    std::vector<float> sums(nbDescriptors, 0.f);
+    std::vector<float> distances(nbDescriptors);
+    const uint8_t * rows = static_cast<const uint8_t *>(descriptors.data());
+    uint32_t stride = descriptors.getDescriptorStride();
+    const DistanceKernels & k = kernels();
+    for (uint32_t i = 0; i + 1 < nbDescriptors; i++) {
+        uint32_t nbNext = nbDescriptors - i - 1;
+        distancesToRange(k, distanceType, descriptors.getDescriptorDataType(), rows + i * stride, rows + (i + 1) * stride,
+                         stride, nbNext, descriptors.getNbElements(), distances.data());
+        for (uint32_t j = 0; j < nbNext; j++) {
+            sums[i] += distances[j];
+            sums[i + 1 + j] += distances[j];
+        }
+    }
+    medoidIndex = static_cast<uint32_t>(std::min_element(sums.begin(), sums.end()) - sums.begin());
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode updateRunningMeanDescriptor(DescriptorBuffer & mean, uint32_t nbObservations, const DescriptorView & descriptor)
+{
+    if ((mean.getNbDescriptors() != 1) || (mean.getDescriptorType() != descriptor.type())
+            || (mean.getNbElements() != descriptor.length()))
+        return FrameworkReturnCode::_ERROR_;
+    float weight = 1.f / (nbObservations + 1);
+    mean.accumulate(0, descriptor, weight, nbObservations * weight);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+}
+}
@@ -0,0 +1,130 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "datastructure/DescriptorIndex.h"
+#include "core/Log.h"
+
+namespace SolAR {
+namespace datastructure {
+
+DescriptorIndex::DescriptorIndex(DescriptorType descriptorType) : m_descriptorType(descriptorType)
+{
+    DescriptorProperties properties = getDescriptorProperties(descriptorType);
+    m_dataType = properties.dataType;
+    // 0 for descriptors of runtime length: defined by the first added descriptor
+    m_nbElements = properties.nbElements;
+}
+
+bool DescriptorIndex::isCompatible(const DescriptorView & descriptor) const
+{
+    return (descriptor.type() == m_descriptorType) && (descriptor.dataType() == m_dataType)
+            && ((m_nbElements == 0) || (descriptor.length() == m_nbElements));
+}
+
+FrameworkReturnCode DescriptorIndex::add(uint32_t id, const DescriptorView & descriptor)
+{
+    if (!isCompatible(descriptor)) {
+        LOG_DEBUG("Cannot add a {} descriptor to an index of {} descriptors", toString(descriptor.type()), toString(m_descriptorType));
+        return FrameworkReturnCode::_ERROR_;
+    }
+    if (m_nbElements == 0)
+        m_nbElements = descriptor.length();
+    // an indexed id, removed or not, keeps its slot: re-adding a descriptor does not purge the index
+    m_removed.erase(id);
+    if (!update(id, descriptor))
+        insert(id, descriptor);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode DescriptorIndex::add(const std::vector<uint32_t> & ids, const DescriptorBuffer & descriptors)
+{
+    if (ids.size() != descriptors.getNbDescriptors())
+        return FrameworkReturnCode::_ERROR_;
+    for (uint32_t i = 0; i < descriptors.getNbDescriptors(); i++) {
+        if (add(ids[i], descriptors.getDescriptor(i)) != FrameworkReturnCode::_SUCCESS)
+            return FrameworkReturnCode::_ERROR_;
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+void DescriptorIndex::remove(uint32_t id)
+{
+    // the tombstones only count indexed descriptors
+    if (!isIndexed(id) || !m_removed.insert(id).second)
+        return;
+    if (m_removed.size() * 4 > getNbEntries())
+        compact();
+}
+
+bool DescriptorIndex::isRemoved(uint32_t id) const
+{
+    return m_removed.find(id) != m_removed.end();
+}
+
+uint32_t DescriptorIndex::getNbDescriptors() const
+{
+    uint32_t nbEntries = getNbEntries();
+    uint32_t nbRemoved = static_cast<uint32_t>(m_removed.size());
+    return nbEntries > nbRemoved ? nbEntries - nbRemoved : 0;
+}
+
+FrameworkReturnCode DescriptorIndex::train(uint32_t /* nbIterations */)
+{
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode DescriptorIndex::search(const DescriptorBuffer & queries, uint32_t k, std::vector<std::vector<DescriptorMatch>> & matches) const
+{
+    matches.clear();
+    matches.resize(queries.getNbDescriptors());
+    std::vector<std::pair<uint32_t, float>> neighbours;
+    for (uint32_t i = 0; i < queries.getNbDescriptors(); i++) {
+        if (search(queries.getDescriptor(i), k, neighbours) != FrameworkReturnCode::_SUCCESS)
+            return FrameworkReturnCode::_ERROR_;
+        matches[i].reserve(neighbours.size());
+        for (const auto & neighbour : neighbours)
+            matches[i].emplace_back(i, neighbour.first, neighbour.second);
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode DescriptorIndex::match(const DescriptorBuffer & queries, float distanceRatio, std::vector<DescriptorMatch> & matches) const
+{
+    matches.clear();
+    std::vector<std::pair<uint32_t, float>> neighbours;
+    for (uint32_t i = 0; i < queries.getNbDescriptors(); i++) {
+        if (search(queries.getDescriptor(i), 2, neighbours) != FrameworkReturnCode::_SUCCESS)
+            return FrameworkReturnCode::_ERROR_;
+        if (neighbours.empty())
+            continue;
+        if ((neighbours.size() == 1) || (neighbours[0].second < distanceRatio * neighbours[1].second))
+            matches.emplace_back(i, neighbours[0].first, neighbours[0].second);
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+template<typename Archive>
+void DescriptorIndex::serialize(Archive &ar, const unsigned int /* version */) {
+    ar & m_descriptorType;
+    ar & m_dataType;
+    ar & m_nbElements;
+    ar & m_removed;
+}
+
+IMPLEMENTSERIALIZE(DescriptorIndex);
+
+}
+}
@@ -21,31 +21,44 @@
 
 BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::Frame);
 
-std::mutex						m_mutexPose;
-std::mutex						m_mutexKeypoint;
-std::mutex						m_mutexReferenceKeyframe;
-std::mutex						m_mutexDescriptors;
-std::mutex						m_mutexVisibility;
-
 namespace xpcf  = org::bcom::xpcf;
 
 namespace SolAR {
 namespace datastructure {
 
 Frame::Frame(const SRef<Frame> frame) :
-                m_pose(frame->m_pose),
                 m_view(frame->m_view),
                 m_maskIDs(frame->m_maskIDs),
-                m_referenceKeyFrame(frame->m_referenceKeyFrame),
-                m_descriptors(frame->m_descriptors),
                 m_globalDescriptor(frame->m_globalDescriptor),
-                m_keypoints(frame->m_keypoints),
-                m_keypointsUndistort(frame->m_keypointsUndistort),
                 m_imageName(frame->m_imageName),
                 m_camID(frame->m_camID),
                 m_isFixedPose(frame->m_isFixedPose),
-                m_serializeImage(frame->m_serializeImage),
-                m_mapVisibility(frame->m_mapVisibility){}
+                m_serializeImage(frame->m_serializeImage)
+{
+    // the members guarded by a lock can be modified while the frame is copied
+    {
+        std::unique_lock lock(frame->m_mutexPose);
+        m_pose = frame->m_pose;
+    }
+    {
+        std::unique_lock lock(frame->m_mutexReferenceKeyframe);
+        m_referenceKeyFrame = frame->m_referenceKeyFrame;
+    }
+    {
+        std::unique_lock lock(frame->m_mutexDescriptors);
+        m_descriptors = frame->m_descriptors;
+    }
+    {
+        std::shared_lock lock(frame->m_mutexKeypoint);
+        m_keypoints = frame->m_keypoints;
+        m_keypointsUndistort = frame->m_keypointsUndistort;
+    }
+    {
+        std::shared_lock lock(frame->m_mutexVisibility);
+        m_visibility = frame->m_visibility;
+        m_nbVisibilities = frame->m_nbVisibilities;
+    }
+}
 
 Frame::Frame(const std::vector<Keypoint>& keypoints, const SRef<DescriptorBuffer> descriptors, const SRef<Image> view, const uint32_t camID, const Transform3Df pose) : m_pose(pose), m_view(view), m_descriptors(descriptors), m_keypoints(keypoints), m_camID(camID) {}
 
@@ -60,7 +73,7 @@ const SRef<Image>& Frame::getView() const
 
 const std::vector<uint32_t>& Frame::getMaskIDs() const
 {
-	return m_maskIDs;
+	return *m_maskIDs;
 }
 
 void Frame::setView(const SRef<Image>& view)
@@ -70,18 +83,18 @@ void Frame::setView(const SRef<Image>& view)
 
 void Frame::setMaskIDs(const std::vector<uint32_t>& maskIDs)
 {
-	m_maskIDs = maskIDs;
+	m_maskIDs.set(maskIDs);
 }
 
-const Transform3Df& Frame::getPose() const
+Transform3Df Frame::getPose() const
 {
-	std::unique_lock<std::mutex> lock(m_mutexPose);
+	std::unique_lock lock(m_mutexPose);
     return m_pose;
 }
 
 void Frame::setPose(const Transform3Df & pose)
 {
-	std::unique_lock<std::mutex> lock(m_mutexPose);
+	std::unique_lock lock(m_mutexPose);
     m_pose = pose;
 }
 
@@ -96,107 +109,318 @@ void Frame::setFixedPose(bool value)
 }
 
 void Frame::setKeypoints(const std::vector<Keypoint> & kpts){
-	std::unique_lock<std::mutex> lock(m_mutexKeypoint);
-    m_keypoints  = kpts;
+	std::unique_lock lock(m_mutexKeypoint);
+    m_keypoints.set(kpts);
+    m_keypointGrid.reset();
+    m_keypointSet.reset();
+}
+
+void Frame::setKeypointSet(const KeypointSet & kpts)
+{
+    std::vector<Keypoint> keypoints;
+    kpts.toKeypoints(keypoints);
+    SRef<KeypointSet> keypointSet;
+    if (kpts.hasAttributes(KeypointSet::ALL))
+        keypointSet = xpcf::utils::make_shared<KeypointSet>(kpts);
+    std::unique_lock lock(m_mutexKeypoint);
+    m_keypoints.set(std::move(keypoints));
+    m_keypointGrid.reset();
+    m_keypointSet = keypointSet;
+}
+
+SRef<const KeypointSet> Frame::getKeypointSet() const
+{
+    {
+        std::shared_lock lock(m_mutexKeypoint);
+        if (m_keypointSet)
+            return m_keypointSet;
+    }
+    std::unique_lock lock(m_mutexKeypoint);
+    if (!m_keypointSet)
+        m_keypointSet = xpcf::utils::make_shared<KeypointSet>(*m_keypoints);
+    return m_keypointSet;
+}
+
+SRef<KeypointGrid> Frame::getKeypointGrid() const
+{
+    SRef<const std::vector<Keypoint>> keypoints;
+    return getKeypointGrid(keypoints);
+}
+
+SRef<KeypointGrid> Frame::getKeypointGrid(SRef<const std::vector<Keypoint>> & keypoints) const
+{
+    {
+        std::shared_lock lock(m_mutexKeypoint);
+        if (m_keypointGrid) {
+            keypoints = m_keypoints.share();
+            return m_keypointGrid;
+        }
+    }
+    std::unique_lock lock(m_mutexKeypoint);
+    if (!m_keypointGrid)
+        m_keypointGrid = xpcf::utils::make_shared<KeypointGrid>(*m_keypoints);
+    keypoints = m_keypoints.share();
+    return m_keypointGrid;
 }
 
 bool Frame::updateKeypointClassId(int i, int classId) 
 {
-    if (i < 0 || i >= static_cast<int>(m_keypoints.size()) || i >= static_cast<int>(m_keypointsUndistort.size())) {
+    std::unique_lock lock(m_mutexKeypoint);
+    if (i < 0 || i >= static_cast<int>(m_keypoints->size()) || i >= static_cast<int>(m_keypointsUndistort->size())) {
         std::cerr << "keypoint index " << i << " out of range" << std::endl;
         return false;
     }
-    m_keypoints[i].setClassId(classId);
-    m_keypointsUndistort[i].setClassId(classId);
+    m_keypoints.edit()[i].setClassId(classId);
+    m_keypointsUndistort.edit()[i].setClassId(classId);
+    m_keypointSet.reset();
+    m_keypointSetUndistort.reset();
     return true;
 }
 
 const std::vector<Keypoint>& Frame::getUndistortedKeypoints() const
 {
-	std::unique_lock<std::mutex> lock(m_mutexKeypoint);
-	return m_keypointsUndistort;
+	std::shared_lock lock(m_mutexKeypoint);
+	return *m_keypointsUndistort;
+}
+
+SRef<const std::vector<Keypoint>> Frame::getUndistortedKeypointsSnapshot() const
+{
+	std::shared_lock lock(m_mutexKeypoint);
+	return m_keypointsUndistort.share();
 }
 
 const Keypoint & Frame::getUndistortedKeypoint(int i) const
 {
-	std::unique_lock<std::mutex> lock(m_mutexKeypoint);
-	return m_keypointsUndistort[i];
+	std::shared_lock lock(m_mutexKeypoint);
+	return (*m_keypointsUndistort)[i];
 }
 
 void Frame::setUndistortedKeypoints(const std::vector<Keypoint>& kpts)
 {
-	std::unique_lock<std::mutex> lock(m_mutexKeypoint);
-	m_keypointsUndistort = kpts;
+	std::unique_lock lock(m_mutexKeypoint);
+	m_keypointsUndistort.set(kpts);
+	m_keypointSetUndistort.reset();
+}
+
+void Frame::setUndistortedKeypointSet(const KeypointSet& kpts)
+{
+	std::vector<Keypoint> keypoints;
+	kpts.toKeypoints(keypoints);
+	SRef<KeypointSet> keypointSet;
+	if (kpts.hasAttributes(KeypointSet::ALL))
+		keypointSet = xpcf::utils::make_shared<KeypointSet>(kpts);
+	std::unique_lock lock(m_mutexKeypoint);
+	m_keypointsUndistort.set(std::move(keypoints));
+	m_keypointSetUndistort = keypointSet;
+}
+
+SRef<const KeypointSet> Frame::getUndistortedKeypointSet() const
+{
+	{
+		std::shared_lock lock(m_mutexKeypoint);
+		if (m_keypointSetUndistort)
+			return m_keypointSetUndistort;
+	}
+	std::unique_lock lock(m_mutexKeypoint);
+	if (!m_keypointSetUndistort)
+		m_keypointSetUndistort = xpcf::utils::make_shared<KeypointSet>(*m_keypointsUndistort);
+	return m_keypointSetUndistort;
 }
 
-const SRef<DescriptorBuffer>& Frame::getDescriptors() const
+SRef<DescriptorBuffer> Frame::getDescriptors() const
 {
-	std::unique_lock<std::mutex> lock(m_mutexDescriptors);
+	std::unique_lock lock(m_mutexDescriptors);
     return m_descriptors;
 }
 
 void Frame::setDescriptors(const SRef<DescriptorBuffer> &descriptors)
 {
-	std::unique_lock<std::mutex> lock(m_mutexDescriptors);
+	std::unique_lock lock(m_mutexDescriptors);
 	m_descriptors = descriptors;
 }
 
 const std::map<uint32_t, uint32_t>& Frame::getVisibility() const
 {
-	std::unique_lock<std::mutex> lock(m_mutexVisibility);
-	return m_mapVisibility;
+	{
+		std::shared_lock lock(m_mutexVisibility);
+		if (m_hasMapVisibility)
+			return *m_mapVisibility;
+	}
+	std::unique_lock lock(m_mutexVisibility);
+	if (!m_hasMapVisibility)
+		buildMapVisibility();
+	return *m_mapVisibility;
+}
+
+SRef<const std::map<uint32_t, uint32_t>> Frame::getVisibilitySnapshot() const
+{
+	{
+		std::shared_lock lock(m_mutexVisibility);
+		if (m_hasMapVisibility)
+			return m_mapVisibility.share();
+	}
+	std::unique_lock lock(m_mutexVisibility);
+	if (!m_hasMapVisibility)
+		buildMapVisibility();
+	return m_mapVisibility.share();
+}
+
+const std::vector<uint32_t>& Frame::getDenseVisibility() const
+{
+	std::shared_lock lock(m_mutexVisibility);
+	return *m_visibility;
+}
+
+SRef<const std::vector<uint32_t>> Frame::getDenseVisibilitySnapshot() const
+{
+	std::shared_lock lock(m_mutexVisibility);
+	return m_visibility.share();
+}
+
+bool Frame::getVisibility(const uint32_t& id_keypoint, uint32_t& id_cloudPoint) const
+{
+	std::shared_lock lock(m_mutexVisibility);
+	const std::vector<uint32_t>& visibility = *m_visibility;
+	if (id_keypoint >= visibility.size() || visibility[id_keypoint] == NO_VISIBILITY)
+		return false;
+	id_cloudPoint = visibility[id_keypoint];
+	return true;
+}
+
+uint32_t Frame::getNbVisibilities() const
+{
+	std::shared_lock lock(m_mutexVisibility);
+	return m_nbVisibilities;
 }
 
 void Frame::setVisibility(const std::map<uint32_t, uint32_t>& visibilities)
 {
-	std::unique_lock<std::mutex> lock(m_mutexVisibility);
-	m_mapVisibility = visibilities;
+	std::unique_lock lock(m_mutexVisibility);
+	setDenseVisibility(visibilities);
 }
 
 void Frame::addVisibilities(const std::map<uint32_t, uint32_t>& visibilites)
 {
-	std::unique_lock<std::mutex> lock(m_mutexVisibility);
-	m_mapVisibility.insert(visibilites.begin(), visibilites.end());
+	if (visibilites.empty())
+		return;
+	std::unique_lock lock(m_mutexVisibility);
+	std::vector<uint32_t>& visibility = m_visibility.edit();
+	if (visibilites.rbegin()->first >= visibility.size())
+		visibility.resize(visibilites.rbegin()->first + 1, NO_VISIBILITY);
+	// as std::map::insert, the existing visibilities are kept
+	for (const auto& [id_keypoint, id_cloudPoint] : visibilites) {
+		if (visibility[id_keypoint] != NO_VISIBILITY)
+			continue;
+		visibility[id_keypoint] = id_cloudPoint;
+		m_nbVisibilities++;
+		if (m_hasMapVisibility)
+			m_mapVisibility.edit().emplace(id_keypoint, id_cloudPoint);
+	}
 }
 
 void Frame::addVisibility(const uint32_t& id_keypoint, const uint32_t& id_cloudPoint)
 {
-	std::unique_lock<std::mutex> lock(m_mutexVisibility);
-	m_mapVisibility[id_keypoint] = id_cloudPoint;
+	std::unique_lock lock(m_mutexVisibility);
+	std::vector<uint32_t>& visibility = m_visibility.edit();
+	if (id_keypoint >= visibility.size())
+		visibility.resize(id_keypoint + 1, NO_VISIBILITY);
+	if (visibility[id_keypoint] == NO_VISIBILITY)
+		m_nbVisibilities++;
+	visibility[id_keypoint] = id_cloudPoint;
+	if (m_hasMapVisibility)
+		m_mapVisibility.edit()[id_keypoint] = id_cloudPoint;
 }
 
 bool Frame::removeVisibility(const uint32_t& id_keypoint, const uint32_t& /* id_cloudPoint */)
 {
-	std::unique_lock<std::mutex> lock(m_mutexVisibility);
-	if (m_mapVisibility.find(id_keypoint) == m_mapVisibility.end())
+	std::unique_lock lock(m_mutexVisibility);
+	if (id_keypoint >= m_visibility->size() || (*m_visibility)[id_keypoint] == NO_VISIBILITY)
 		return false;
 	else {
-		m_mapVisibility.erase(id_keypoint);
+		m_visibility.edit()[id_keypoint] = NO_VISIBILITY;
+		m_nbVisibilities--;
+		if (m_hasMapVisibility)
+			m_mapVisibility.edit().erase(id_keypoint);
 		return true;
 	}
 }
 
+void Frame::recycle()
+{
+    m_pose = Transform3Df::Identity();
+    m_view.reset();
+    m_maskIDs.overwrite().clear();
+    m_referenceKeyFrame.reset();
+    // an unshared descriptor buffer is kept empty, with its memory, to be reshaped by the next extraction
+    if (m_descriptors && (m_descriptors.use_count() == 1))
+        m_descriptors->reshape(m_descriptors->getDescriptorType(), m_descriptors->getDescriptorDataType(), m_descriptors->getNbElements(), 0);
+    else
+        m_descriptors.reset();
+    m_globalDescriptor.reset();
+    m_keypoints.overwrite().clear();
+    m_keypointsUndistort.overwrite().clear();
+    m_keypointGrid.reset();
+    m_keypointSet.reset();
+    m_keypointSetUndistort.reset();
+    m_imageName.clear();
+    m_camID = 0;
+    m_isFixedPose = false;
+    m_serializeImage = true;
+    m_visibility.overwrite().clear();
+    m_nbVisibilities = 0;
+    m_mapVisibility.overwrite().clear();
+    m_hasMapVisibility = false;
+}
+
+void Frame::buildMapVisibility() const
+{
+    std::map<uint32_t, uint32_t> mapVisibility;
+    const std::vector<uint32_t>& visibility = *m_visibility;
+    for (uint32_t i = 0; i < visibility.size(); i++)
+        if (visibility[i] != NO_VISIBILITY)
+            mapVisibility.emplace_hint(mapVisibility.end(), i, visibility[i]);
+    m_mapVisibility.set(std::move(mapVisibility));
+    m_hasMapVisibility = true;
+}
+
+void Frame::setDenseVisibility(const std::map<uint32_t, uint32_t>& visibilities)
+{
+    std::vector<uint32_t> visibility(visibilities.empty() ? 0 : visibilities.rbegin()->first + 1, NO_VISIBILITY);
+    for (const auto& [id_keypoint, id_cloudPoint] : visibilities)
+        visibility[id_keypoint] = id_cloudPoint;
+    m_visibility.set(std::move(visibility));
+    m_nbVisibilities = static_cast<uint32_t>(visibilities.size());
+    m_mapVisibility.set(std::map<uint32_t, uint32_t>());
+    m_hasMapVisibility = false;
+}
+
 const std::vector<Keypoint> & Frame::getKeypoints() const
 {
-	std::unique_lock<std::mutex> lock(m_mutexKeypoint);
-    return m_keypoints;
+	std::shared_lock lock(m_mutexKeypoint);
+    return *m_keypoints;
+}
+
+SRef<const std::vector<Keypoint>> Frame::getKeypointsSnapshot() const
+{
+	std::shared_lock lock(m_mutexKeypoint);
+	return m_keypoints.share();
 }
 
 const Keypoint& Frame::getKeypoint(int i) const
 {
-    std::unique_lock<std::mutex> lock(m_mutexKeypoint);
-    return m_keypoints[i];
+    std::shared_lock lock(m_mutexKeypoint);
+    return (*m_keypoints)[i];
 }
 
 void Frame::setReferenceKeyframe(const SRef<Keyframe>& keyframe)
 {
-	std::unique_lock<std::mutex> lock(m_mutexReferenceKeyframe);
+	std::unique_lock lock(m_mutexReferenceKeyframe);
     m_referenceKeyFrame = keyframe;
 }
 
-const SRef<Keyframe>& Frame::getReferenceKeyframe() const
+SRef<Keyframe> Frame::getReferenceKeyframe() const
 {
-	std::unique_lock<std::mutex> lock(m_mutexReferenceKeyframe);
+	std::unique_lock lock(m_mutexReferenceKeyframe);
     return m_referenceKeyFrame;
 }
 
@@ -235,6 +459,18 @@ void Frame::nextSerializationWithoutImage()
     m_serializeImage = false;
 }
 
+namespace {
+// saving reads the shared value, loading writes a value of its own
+template<typename Archive, typename T>
+void serializeShared(Archive &ar, CopyOnWrite<T> &value)
+{
+    if (Archive::is_saving::value)
+        ar & const_cast<T&>(value.get());
+    else
+        ar & value.edit();
+}
+}
+
 template<typename Archive>
 void Frame::serialize(Archive &ar, const unsigned int version) {
 	ar & boost::serialization::make_array(m_pose.data(), 12);
@@ -252,15 +488,32 @@ void Frame::serialize(Archive &ar, const unsigned int version) {
         ar & emptyImage;
     }
     else {
-        ar & m_maskIDs;
+        serializeShared(ar, m_maskIDs);
     }
 	ar & m_descriptors;
-	ar & m_keypoints;
-	ar & m_keypointsUndistort;	
+	serializeShared(ar, m_keypoints);
+	serializeShared(ar, m_keypointsUndistort);
+    if (Archive::is_loading::value) {
+        m_keypointGrid.reset();
+        m_keypointSet.reset();
+        m_keypointSetUndistort.reset();
+    }
 	ar & m_imageName;
     ar & m_camID;
     ar & m_isFixedPose;
-	ar & m_mapVisibility;
+	{
+		// archived as a map, as before the dense visibility
+		std::map<uint32_t, uint32_t> visibility;
+		if (Archive::is_saving::value) {
+			const std::vector<uint32_t>& denseVisibility = *m_visibility;
+			for (uint32_t i = 0; i < denseVisibility.size(); i++)
+				if (denseVisibility[i] != NO_VISIBILITY)
+					visibility.emplace_hint(visibility.end(), i, denseVisibility[i]);
+		}
+		ar & visibility;
+		if (Archive::is_loading::value)
+			setDenseVisibility(visibility);
+	}
 	ar & m_globalDescriptor;
 }
 
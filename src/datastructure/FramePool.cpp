@@ -0,0 +1,82 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "datastructure/FramePool.h"
+
+#include <mutex>
+#include <vector>
+
+#include <xpcf/core/helpers.h>
+
+namespace xpcf  = org::bcom::xpcf;
+
+namespace SolAR {
+namespace datastructure {
+
+struct FramePool::FreeFrames {
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Frame>> frames;
+    uint32_t maxFrames;
+};
+
+FramePool::FramePool(uint32_t maxFreeFrames) : m_freeFrames(xpcf::utils::make_shared<FreeFrames>())
+{
+    m_freeFrames->maxFrames = maxFreeFrames;
+}
+
+SRef<Frame> FramePool::acquire()
+{
+    std::unique_ptr<Frame> frame;
+    {
+        std::unique_lock lock(m_freeFrames->mutex);
+        if (!m_freeFrames->frames.empty()) {
+            frame = std::move(m_freeFrames->frames.back());
+            m_freeFrames->frames.pop_back();
+        }
+    }
+    if (!frame)
+        frame = std::make_unique<Frame>();
+    std::weak_ptr<FreeFrames> pool = m_freeFrames;
+    return SRef<Frame>(frame.release(), [pool](Frame * released) {
+        std::unique_ptr<Frame> frame(released);
+        SRef<FreeFrames> freeFrames = pool.lock();
+        if (!freeFrames || (freeFrames->maxFrames == 0))
+            return;
+        frame->recycle();
+        std::unique_lock lock(freeFrames->mutex);
+        if (freeFrames->frames.size() < freeFrames->maxFrames)
+            freeFrames->frames.push_back(std::move(frame));
+    });
+}
+
+uint32_t FramePool::getNbFreeFrames() const
+{
+    std::unique_lock lock(m_freeFrames->mutex);
+    return static_cast<uint32_t>(m_freeFrames->frames.size());
+}
+
+void FramePool::clear()
+{
+    std::vector<std::unique_ptr<Frame>> frames;
+    {
+        std::unique_lock lock(m_freeFrames->mutex);
+        frames.swap(m_freeFrames->frames);
+    }
+}
+
+}
+}
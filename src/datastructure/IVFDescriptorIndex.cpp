@@ -0,0 +1,273 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "datastructure/IVFDescriptorIndex.h"
+#include "datastructure/DescriptorDistance.h"
+#include "core/Log.h"
+
+#include <algorithm>
+#include <numeric>
+#include <xpcf/core/helpers.h>
+
+BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::IVFDescriptorIndex);
+
+namespace xpcf = org::bcom::xpcf;
+
+namespace SolAR {
+namespace datastructure {
+
+namespace {
+
+// Return a pointer on the float elements of a descriptor, converted in buffer if needed
+inline const float * toFloat(const DescriptorView & descriptor, std::vector<float> & buffer)
+{
+    if (descriptor.dataType() == DescriptorDataType::TYPE_32F)
+        return static_cast<const float *>(descriptor.data());
+    buffer.resize(descriptor.length());
+    convertDescriptorData(static_cast<const uint8_t *>(descriptor.data()), buffer.data(), descriptor.length());
+    return buffer.data();
+}
+
+}
+
+IVFDescriptorIndex::IVFDescriptorIndex(DescriptorType descriptorType, uint32_t nbLists, uint32_t nbProbes) :
+    DescriptorIndex(descriptorType), m_nbLists(std::max(nbLists, 1u)), m_nbProbes(std::max(nbProbes, 1u))
+{
+    if ((getDescriptorDistanceType(descriptorType) != DescriptorDistanceType::L2) || (m_nbElements == 0)) {
+        LOG_ERROR("IVFDescriptorIndex: cannot index {} descriptors", toString(descriptorType));
+        m_descriptorType = DescriptorType::UNDEFINED;
+    }
+    m_listDescriptors.emplace_back(m_descriptorType, m_dataType, m_nbElements, 0);
+    m_listIds.resize(1);
+}
+
+SRef<DescriptorIndex> IVFDescriptorIndex::clone() const
+{
+    SRef<IVFDescriptorIndex> index = xpcf::utils::make_shared<IVFDescriptorIndex>(*this);
+    // DescriptorBuffer copies share their memory
+    for (auto & descriptors : index->m_listDescriptors) {
+        DescriptorBuffer copy(m_descriptorType, m_dataType, m_nbElements, 0);
+        copy.append(descriptors);
+        descriptors = copy;
+    }
+    return index;
+}
+
+FrameworkReturnCode IVFDescriptorIndex::train(const DescriptorBuffer & descriptors, uint32_t nbIterations)
+{
+    if ((descriptors.getDescriptorType() != m_descriptorType) || (descriptors.getNbElements() != m_nbElements)
+            || (descriptors.getNbDescriptors() < m_nbLists)) {
+        LOG_ERROR("IVFDescriptorIndex: cannot train {} lists with {} descriptors", m_nbLists, descriptors.getNbDescriptors());
+        return FrameworkReturnCode::_ERROR_;
+    }
+    DescriptorBuffer data;
+    descriptors.convertTo(DescriptorDataType::TYPE_32F, data);
+    std::vector<float> centroids;
+    if (computeKMeans(static_cast<const float *>(data.data()), data.getNbDescriptors(), m_nbElements,
+                      m_nbLists, nbIterations, centroids) != FrameworkReturnCode::_SUCCESS)
+        return FrameworkReturnCode::_ERROR_;
+    m_centroids.swap(centroids);
+    distribute();
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode IVFDescriptorIndex::train(uint32_t nbIterations)
+{
+    DescriptorBuffer descriptors(m_descriptorType, m_dataType, m_nbElements, 0);
+    descriptors.reserve(getNbDescriptors());
+    for (size_t l = 0; l < m_listDescriptors.size(); l++) {
+        std::vector<uint32_t> rows;
+        for (uint32_t i = 0; i < m_listIds[l].size(); i++) {
+            if ((m_listIds[l][i] != MOVED_ID) && !isRemoved(m_listIds[l][i]))
+                rows.push_back(i);
+        }
+        descriptors.append(m_listDescriptors[l], rows);
+    }
+    return train(descriptors, nbIterations);
+}
+
+uint32_t IVFDescriptorIndex::findList(const DescriptorView & descriptor) const
+{
+    if (!isTrained())
+        return 0;
+    thread_local std::vector<float> buffer;
+    float distance;
+    return findNearestCentroid(toFloat(descriptor, buffer), m_centroids.data(), m_nbLists, m_nbElements, distance);
+}
+
+void IVFDescriptorIndex::distribute()
+{
+    std::vector<DescriptorBuffer> listDescriptors;
+    std::vector<std::vector<uint32_t>> listIds(isTrained() ? m_nbLists : 1);
+    for (size_t l = 0; l < listIds.size(); l++)
+        listDescriptors.emplace_back(m_descriptorType, m_dataType, m_nbElements, 0);
+    m_nbEntries = 0;
+    for (size_t l = 0; l < m_listDescriptors.size(); l++) {
+        for (uint32_t i = 0; i < m_listDescriptors[l].getNbDescriptors(); i++) {
+            uint32_t id = m_listIds[l][i];
+            if ((id == MOVED_ID) || isRemoved(id))
+                continue;
+            DescriptorView descriptor = m_listDescriptors[l].getDescriptor(i);
+            uint32_t list = findList(descriptor);
+            listDescriptors[list].append(descriptor);
+            listIds[list].push_back(id);
+            m_nbEntries++;
+        }
+    }
+    m_listDescriptors.swap(listDescriptors);
+    m_listIds.swap(listIds);
+    m_removed.clear();
+    buildSlots();
+}
+
+void IVFDescriptorIndex::buildSlots()
+{
+    m_slots.clear();
+    m_slots.reserve(m_nbEntries);
+    m_nbMoved = 0;
+    for (uint32_t l = 0; l < m_listIds.size(); l++) {
+        for (uint32_t i = 0; i < m_listIds[l].size(); i++) {
+            if (m_listIds[l][i] == MOVED_ID)
+                m_nbMoved++;
+            else
+                m_slots[m_listIds[l][i]] = {l, i};
+        }
+    }
+}
+
+void IVFDescriptorIndex::insert(uint32_t id, const DescriptorView & descriptor)
+{
+    uint32_t list = findList(descriptor);
+    m_slots[id] = {list, m_listDescriptors[list].getNbDescriptors()};
+    m_listDescriptors[list].append(descriptor);
+    m_listIds[list].push_back(id);
+    m_nbEntries++;
+}
+
+bool IVFDescriptorIndex::update(uint32_t id, const DescriptorView & descriptor)
+{
+    auto slotIt = m_slots.find(id);
+    if (slotIt == m_slots.end())
+        return false;
+    auto [list, row] = slotIt->second;
+    uint32_t newList = findList(descriptor);
+    if (newList == list) {
+        // overwrite the row: scale 0 ignores its previous content
+        m_listDescriptors[list].accumulate(row, descriptor, 1.f, 0.f);
+        return true;
+    }
+    // the descriptor moves to the list of its new nearest centroid, its previous slot is skipped until compact()
+    m_listIds[list][row] = MOVED_ID;
+    m_nbMoved++;
+    slotIt->second = {newList, m_listDescriptors[newList].getNbDescriptors()};
+    m_listDescriptors[newList].append(descriptor);
+    m_listIds[newList].push_back(id);
+    if (m_nbMoved * 4 > m_nbEntries)
+        compact();
+    return true;
+}
+
+FrameworkReturnCode IVFDescriptorIndex::search(const DescriptorView & query, uint32_t k,
+                                               std::vector<std::pair<uint32_t, float>> & neighbours) const
+{
+    neighbours.clear();
+    if (!isCompatible(query) || m_listDescriptors.empty())
+        return FrameworkReturnCode::_ERROR_;
+    if (k == 0)
+        return FrameworkReturnCode::_SUCCESS;
+    // lists to scan: the nbProbes lists with the nearest centroids
+    std::vector<uint32_t> probes(1, 0);
+    if (isTrained()) {
+        thread_local std::vector<float> buffer;
+        const float * q = toFloat(query, buffer);
+        std::vector<std::pair<float, uint32_t>> centroidDistances(m_nbLists);
+        for (uint32_t l = 0; l < m_nbLists; l++)
+            centroidDistances[l] = {l2SquaredDistance(q, &m_centroids[static_cast<size_t>(l) * m_nbElements], m_nbElements), l};
+        uint32_t nbProbes = std::min(m_nbProbes, m_nbLists);
+        std::partial_sort(centroidDistances.begin(), centroidDistances.begin() + nbProbes, centroidDistances.end());
+        probes.resize(nbProbes);
+        for (uint32_t p = 0; p < nbProbes; p++)
+            probes[p] = centroidDistances[p].second;
+    }
+    // k best candidates in a max heap on the distance
+    auto isCloser = [](const std::pair<uint32_t, float> & a, const std::pair<uint32_t, float> & b) { return a.second < b.second; };
+    thread_local std::vector<float> distances;
+    for (const auto & list : probes) {
+        if (m_listDescriptors[list].getNbDescriptors() == 0)
+            continue;
+        computeDistances(query, m_listDescriptors[list], distances);
+        const std::vector<uint32_t> & ids = m_listIds[list];
+        for (size_t i = 0; i < distances.size(); i++) {
+            if ((neighbours.size() == k) && (distances[i] >= neighbours.front().second))
+                continue;
+            if ((ids[i] == MOVED_ID) || (!m_removed.empty() && isRemoved(ids[i])))
+                continue;
+            if (neighbours.size() == k) {
+                std::pop_heap(neighbours.begin(), neighbours.end(), isCloser);
+                neighbours.pop_back();
+            }
+            neighbours.emplace_back(ids[i], distances[i]);
+            std::push_heap(neighbours.begin(), neighbours.end(), isCloser);
+        }
+    }
+    std::sort_heap(neighbours.begin(), neighbours.end(), isCloser);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+void IVFDescriptorIndex::compact()
+{
+    if (m_removed.empty() && (m_nbMoved == 0))
+        return;
+    m_nbEntries = 0;
+    for (size_t l = 0; l < m_listDescriptors.size(); l++) {
+        std::vector<uint32_t> kept;
+        std::vector<uint32_t> keptIds;
+        for (uint32_t i = 0; i < m_listIds[l].size(); i++) {
+            if ((m_listIds[l][i] != MOVED_ID) && !isRemoved(m_listIds[l][i])) {
+                kept.push_back(i);
+                keptIds.push_back(m_listIds[l][i]);
+            }
+        }
+        if (kept.size() != m_listIds[l].size()) {
+            DescriptorBuffer descriptors(m_descriptorType, m_dataType, m_nbElements, 0);
+            descriptors.append(m_listDescriptors[l], kept);
+            m_listDescriptors[l] = descriptors;
+            m_listIds[l].swap(keptIds);
+        }
+        m_nbEntries += static_cast<uint32_t>(m_listIds[l].size());
+    }
+    m_removed.clear();
+    buildSlots();
+}
+
+template<typename Archive>
+void IVFDescriptorIndex::serialize(Archive &ar, const unsigned int /* version */) {
+    ar & boost::serialization::base_object<DescriptorIndex>(*this);
+    ar & m_nbLists;
+    ar & m_nbProbes;
+    ar & m_nbEntries;
+    ar & m_centroids;
+    ar & m_listDescriptors;
+    ar & m_listIds;
+    // the slots are not stored, they are rebuilt from the lists
+    if (Archive::is_loading::value)
+        buildSlots();
+}
+
+IMPLEMENTSERIALIZE(IVFDescriptorIndex);
+
+}
+}
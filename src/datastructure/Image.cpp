@@ -15,8 +15,15 @@
  */
 
 #include "datastructure/Image.h"
+#include "datastructure/ImageBufferPool.h"
+#include "core/ThreadPool.h"
 #include <vector>
 #include <map>
+#include <utility>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
 
 #include <xpcf/core/helpers.h>
 
@@ -27,6 +34,14 @@
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imagebufalgo.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define SOLAR_IMAGE_X86
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SOLAR_IMAGE_NEON
+#include <arm_neon.h>
+#endif
+
 namespace xpcf  = org::bcom::xpcf;
 using namespace org::bcom::xpcf;
 
@@ -45,34 +60,90 @@ ImageInternal::ImageInternal(void* data,uint32_t size)
    setData(data,size);
 }
 
+ImageInternal::ImageInternal(void* data, uint32_t size, std::function<void(void*)> release) : m_bufferSize(size)
+{
+    m_externalData = std::shared_ptr<uint8_t>(static_cast<uint8_t*>(data), [release](uint8_t* p) {
+        if (release)
+            release(p);
+    });
+}
+
+ImageInternal::ImageInternal(std::vector<uint8_t> && data) : m_bufferSize(static_cast<uint32_t>(data.size()))
+{
+    // the vector is kept alive by the storage, outside of the pool
+    auto adopted = std::make_shared<std::vector<uint8_t>>(std::move(data));
+    m_storageData = std::shared_ptr<uint8_t>(adopted, adopted->data());
+    m_storageCapacity = m_bufferSize;
+}
+
 ImageInternal::~ImageInternal()
 {
-    m_storageData.clear();
+    m_storageData.reset();
+}
+
+void ImageInternal::reserveStorage(uint32_t size)
+{
+    if (size <= m_storageCapacity)
+        return;
+    m_storageData = ImageBufferPool::instance().acquire(size);
+    m_storageCapacity = ImageBufferPool::getCapacity(size);
 }
 
 void ImageInternal::setBufferSize(uint32_t size)
 {
+    detach();
     m_bufferSize = size;
     if (m_bufferSize == 0) { // invalid size
         return;
     }
-    m_storageData.reserve(m_bufferSize);
-    m_storageData.resize(m_bufferSize);
+    // the content is not preserved nor initialized when the storage grows
+    reserveStorage(m_bufferSize);
 }
 
 void ImageInternal::setData(void * data, uint32_t size)
 {
+    m_externalData.reset();
+    m_detached = false;
     setBufferSize(size);
+    if (m_bufferSize > 0)
+        std::memcpy(m_storageData.get(), data, m_bufferSize);
+}
 
-    m_storageData.clear();
-    m_storageData.insert(m_storageData.begin(), static_cast<uint8_t *>(data), static_cast<uint8_t *>(data) + m_bufferSize);
+void ImageInternal::detach()
+{
+    if (!isExternal())
+        return;
+    // concurrent callers of the non-const data() wait for a single copy
+    std::unique_lock lock(m_mutexDetach);
+    if (m_detached.load(std::memory_order_relaxed))
+        return;
+    reserveStorage(m_bufferSize);
+    if (m_bufferSize > 0)
+        std::memcpy(m_storageData.get(), m_externalData.get(), m_bufferSize);
+    // publish the storage to the readers of the const data()
+    m_detached.store(true, std::memory_order_release);
 }
 
 template<typename Archive>
 void ImageInternal::serialize(Archive &ar, const unsigned int /* version */)
 {
-    ar & m_storageData;
-    ar & m_bufferSize;
+    // the pixels are archived as a vector, as before the storage was pooled
+    if (Archive::is_saving::value) {
+        const uint8_t* pixels = static_cast<const uint8_t*>(std::as_const(*this).data());
+        std::vector<uint8_t> storageData(pixels, pixels + (pixels ? m_bufferSize : 0));
+        ar & storageData;
+        ar & m_bufferSize;
+    }
+    else {
+        std::vector<uint8_t> storageData;
+        ar & storageData;
+        ar & m_bufferSize;
+        m_externalData.reset();
+        m_detached = false;
+        m_storageCapacity = static_cast<uint32_t>(storageData.size());
+        auto adopted = std::make_shared<std::vector<uint8_t>>(std::move(storageData));
+        m_storageData = std::shared_ptr<uint8_t>(adopted, adopted->data());
+    }
 }
 
 IMPLEMENTSERIALIZE(ImageInternal);
@@ -91,7 +162,7 @@ static std::map<Image::DataType,uint32_t> typeSizeMapInfos = {{Image::DataType::
 //Add stride notion
 // Hypothese : pas de bits per component : only full format image YUV444, RGB888, RGB 555 but not YUV420, RGB565 and so on or YUV422 with splatting
 
-uint32_t Image::computeImageBufferSize()
+uint32_t Image::computeImageBufferSize() const
 {
     return m_size.width * m_size.height * m_nbChannels * (m_nbBitsPerComponent/8);
 }
@@ -122,46 +193,109 @@ Image::Image(void* imageData, uint32_t width, uint32_t height, enum ImageLayout
     }
     else {
         // JPEG or PNG decoding
-        OIIO::Filesystem::IOMemReader memreader(imageData, computeImageBufferSize());
-
-        std::string filename;
-        switch (encoding)
-        {
-            case ENCODING_JPEG:
-                filename="in.jpg";
-                break;
-            case ENCODING_PNG:
-                filename = "in.png";
-                break;
-            case ENCODING_NONE:
-            default:
-                filename="in.jpg";
-                break;
-        }
+        decode(imageData, computeImageBufferSize(), encoding);
+    }
+}
 
-        auto in = OIIO::ImageInput::open (filename, nullptr, &memreader);
-        const OIIO::ImageSpec & spec = in->spec();
+// wrap external pointer data without copy: the data is copied on the first modification of the image
 
-        OIIO::imagesize_t buffersize = spec.image_bytes(true);
-        auto pixels = std::make_unique<unsigned char[]>(buffersize);
-        in->read_image(0, 0, 0, m_nbChannels, OIIO::TypeDesc::UNKNOWN, pixels.get());
+Image::Image(void* imageData, uint32_t width, uint32_t height, enum ImageLayout imgLayout, enum PixelOrder pixOrder,
+             DataType type, std::function<void(void*)> release):Image(imgLayout, pixOrder, type)
+{
+    m_size.width = width;
+    m_size.height = height;
+    m_internalImpl = utils::make_shared<ImageInternal>(imageData, computeImageBufferSize(), release);
+}
 
-        m_internalImpl = utils::make_shared<ImageInternal>();
-        m_internalImpl->setData(pixels.get(), spec.image_bytes(true));
-        in->close();
-    }
+Image::Image(std::vector<uint8_t> && imageData, uint32_t width, uint32_t height, enum ImageLayout imgLayout, enum PixelOrder pixOrder,
+             DataType type):Image(imgLayout, pixOrder, type)
+{
+    m_size.width = width;
+    m_size.height = height;
+    imageData.resize(computeImageBufferSize());
+    m_internalImpl = utils::make_shared<ImageInternal>(std::move(imageData));
 }
 
 SRef<Image> Image::copy() const
 {
     // NB : maybe we should consider redefining the image copy constructor
-    return xpcf::utils::make_shared<Image>(m_internalImpl->data(), m_size.width, m_size.height, m_layout, m_pixOrder, m_type);
+    SRef<Image> image = xpcf::utils::make_shared<Image>(m_size.width, m_size.height, m_layout, m_pixOrder, m_type);
+    copyPixels(image->data());
+    return image;
+}
+
+void Image::copyPixels(void* dst) const
+{
+    const uint8_t* src = static_cast<const uint8_t*>(data());
+    if (isContinuous()) {
+        std::memcpy(dst, src, computeImageBufferSize());
+        return;
+    }
+    uint32_t rowSize = m_size.width * getPixelSize();
+    for (uint32_t row = 0; row < m_size.height; row++)
+        std::memcpy(static_cast<uint8_t*>(dst) + static_cast<size_t>(row) * rowSize, src + static_cast<size_t>(row) * getStep(), rowSize);
+}
+
+const void* Image::getContinuousData(std::vector<uint8_t>& storage) const
+{
+    if (isContinuous())
+        return data();
+    storage.resize(computeImageBufferSize());
+    copyPixels(storage.data());
+    return storage.data();
+}
+
+SRef<Image> Image::extractRegion(Rectanglei region)
+{
+    if (m_pixOrder != PixelOrder::INTERLEAVED) {
+        std::cerr << "Image::extractRegion - a region of a multiplanar image must be extracted for a single plane" << std::endl;
+        return nullptr;
+    }
+    if ((region.startX + region.size.width > m_size.width) || (region.startY + region.size.height > m_size.height)) {
+        std::cerr << "Image::extractRegion - the region is not inside the image" << std::endl;
+        return nullptr;
+    }
+    SRef<Image> image = xpcf::utils::make_shared<Image>(*this);
+    image->m_size = region.size;
+    image->m_rowStride = getStep();
+    image->m_offset = m_offset + region.startY * getStep() + region.startX * getPixelSize();
+    return image;
+}
+
+SRef<Image> Image::extractRegion(Rectanglei region, uint32_t channel)
+{
+    if ((m_pixOrder != PixelOrder::PER_CHANNEL) || (channel >= m_nbPlanes)) {
+        std::cerr << "Image::extractRegion - a single plane can only be extracted from a multiplanar image" << std::endl;
+        return nullptr;
+    }
+    if ((region.startX + region.size.width > m_size.width) || (region.startY + region.size.height > m_size.height)) {
+        std::cerr << "Image::extractRegion - the region is not inside the image" << std::endl;
+        return nullptr;
+    }
+    // each plane stores one component per pixel
+    uint32_t componentSize = m_nbBitsPerComponent / 8;
+    uint32_t planeStep = m_size.width * componentSize;
+    SRef<Image> image = xpcf::utils::make_shared<Image>(*this);
+    image->m_layout = ImageLayout::LAYOUT_GREY;
+    image->m_pixOrder = PixelOrder::INTERLEAVED;
+    image->m_nbChannels = 1;
+    image->m_nbPlanes = 1;
+    image->m_size = region.size;
+    image->m_rowStride = planeStep;
+    image->m_offset = m_offset + channel * planeStep * m_size.height + region.startY * planeStep + region.startX * componentSize;
+    return image;
 }
 
 // reserve new space depending on the image layers and bitspercomponent infos
 // TODO handle bad size error : add return code
 void Image::setSize(uint32_t width, uint32_t height)
 {
+    if (isRegion()) {
+        // stop sharing the memory of the parent image
+        m_internalImpl = utils::make_shared<ImageInternal>();
+        m_rowStride = 0;
+        m_offset = 0;
+    }
     m_size.width = width;
     m_size.height = height;
     m_internalImpl->setBufferSize(computeImageBufferSize());
@@ -171,26 +305,27 @@ void Image::setSize(uint32_t width, uint32_t height)
 // TODO handle bad size error : add return code
 void Image::setSize(Sizei size)
 {
-    m_size = size;
-    m_internalImpl->setBufferSize(computeImageBufferSize());
+    setSize(size.width, size.height);
 }
 
 
 uint32_t Image::getBufferSize()
 {
-    return m_internalImpl->getBufferSize();
+    if (!isRegion())
+        return m_internalImpl->getBufferSize();
+    return (m_size.height > 0) ? (m_size.height - 1) * getStep() + m_size.width * getPixelSize() : 0;
 }
 
 
 void* Image::data()
 {
-    return m_internalImpl->data();
+    return static_cast<uint8_t*>(m_internalImpl->data()) + m_offset;
 }
 
 
 const void* Image::data() const
 {
-    return m_internalImpl->data();
+    return static_cast<const uint8_t*>(std::as_const(*m_internalImpl).data()) + m_offset;
 }
 
 void Image::setImageEncoding(enum ImageEncoding encoding)
@@ -239,6 +374,165 @@ static std::map<Image::ImageLayout,std::vector<std::string>> SolAR2OIIOLayout =
                                                                                  {Image::ImageLayout::LAYOUT_RGBX, {"R","G","B","A"}}};
 
 
+namespace {
+// encoders and decoders are reused by the serializations running on a thread, per file format
+OIIO::ImageOutput* getEncoder(const std::string & filename)
+{
+    thread_local std::map<std::string, std::unique_ptr<OIIO::ImageOutput>> encoders;
+    auto & encoder = encoders[filename];
+    if (!encoder)
+        encoder = OIIO::ImageOutput::create(filename);
+    return encoder.get();
+}
+
+OIIO::ImageInput* getDecoder(const std::string & filename)
+{
+    thread_local std::map<std::string, std::unique_ptr<OIIO::ImageInput>> decoders;
+    auto & decoder = decoders[filename];
+    if (!decoder)
+        decoder = OIIO::ImageInput::create(filename);
+    return decoder.get();
+}
+
+// images encoded by Image::preEncode, waiting for their serialization on this thread
+struct PreEncodedImage {
+    std::weak_ptr<const Image> image;
+    std::vector<uint8_t> encodedData;
+};
+thread_local std::map<const Image*, PreEncodedImage> t_preEncodedImages;
+}
+
+FrameworkReturnCode Image::encode(std::vector<uint8_t>& encodedData) const
+{
+    // ImageSpec describing the image we want to write.
+    OIIO::ImageSpec spec;
+    OIIO::TypeDesc type = OIIO::TypeDesc::UNKNOWN;
+    if (SolAR2OIIOType.find(m_type) == SolAR2OIIOType.end())
+        spec = OIIO::ImageSpec(m_size.width, m_size.height, m_nbChannels);
+    else {
+        type = SolAR2OIIOType.at(m_type);
+        spec = OIIO::ImageSpec(m_size.width, m_size.height, m_nbChannels, type);
+    }
+
+    if (SolAR2OIIOLayout.find(m_layout) != SolAR2OIIOLayout.end())
+        spec.channelnames=SolAR2OIIOLayout.at(m_layout);
+
+    std::string filename;
+    switch (m_imageEncoding)
+    {
+        case ENCODING_JPEG:
+            filename="out.jpeg";
+            spec.attribute ("Compression","jpeg:" + std::to_string(m_imageEncodingQuality));
+            break;
+        case ENCODING_PNG:
+            filename = "out.png";
+            if (m_imageEncodingQuality==0)
+                spec.attribute ("png:compressionLevel", 0);
+            else if (m_imageEncodingQuality>=100)
+                spec.attribute ("png:compressionLevel", 9);
+            else
+            {
+                // PNG encoding quality should be defined between 0 and 9.
+                spec.attribute ("png:compressionLevel", (int)floor(m_imageEncodingQuality/10.0f));
+            }
+            break;
+        case ENCODING_NONE:
+        default:
+            filename = "out";
+    }
+
+    OIIO::ImageOutput* out = getEncoder(filename);
+    if (!out) {
+        std::cerr << "ImageOutput::create : " << OIIO::geterror() << std::endl;
+        return FrameworkReturnCode::_ERROR_;
+    }
+    if (!out->supports("ioproxy"))
+        return FrameworkReturnCode::_NOT_IMPLEMENTED;
+
+    encodedData.clear();
+    OIIO::Filesystem::IOVecOutput encodingBuffer (encodedData);  // I/O proxy object;
+    if (!out->set_ioproxy(&encodingBuffer) || !out->open(filename, spec)) {
+        std::cerr << "Error while opening the " << filename << " encoder. " << std::endl << out->geterror() << std::endl;
+        out->set_ioproxy(nullptr);
+        return FrameworkReturnCode::_ERROR_;
+    }
+
+    std::vector<uint8_t> continuousData;
+    bool written = out->write_image(type, getContinuousData(continuousData));
+    out->close();
+    out->set_ioproxy(nullptr);
+    if (!written)
+    {
+        std::cerr << "Error while writing the " << filename << " image to the serialization buffer. " << std::endl << OIIO::geterror() << std::endl;
+        return FrameworkReturnCode::_ERROR_;
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode Image::decode(const void* encodedData, size_t size, enum ImageEncoding encoding)
+{
+    OIIO::Filesystem::IOMemReader memreader(const_cast<void*>(encodedData), size);
+
+    std::string filename;
+    switch (encoding)
+    {
+        case ENCODING_JPEG:
+            filename="in.jpg";
+            break;
+        case ENCODING_PNG:
+            filename = "in.png";
+            break;
+        case ENCODING_NONE:
+        default:
+            filename="in.jpg";
+            break;
+    }
+
+    OIIO::ImageInput* in = getDecoder(filename);
+    OIIO::ImageSpec spec;
+    if (!in || !in->set_ioproxy(&memreader) || !in->open(filename, spec)) {
+        std::cerr << "Error while decoding an image: " << (in ? in->geterror() : OIIO::geterror()) << std::endl;
+        if (in)
+            in->set_ioproxy(nullptr);
+        return FrameworkReturnCode::_ERROR_LOAD_IMAGE;
+    }
+
+    OIIO::imagesize_t buffersize = spec.image_bytes(true);
+    // decode into uninitialized pooled storage
+    m_internalImpl = utils::make_shared<ImageInternal>(static_cast<uint32_t>(buffersize));
+    m_rowStride = 0;
+    m_offset = 0;
+    bool read = in->read_image(0, 0, 0, m_nbChannels, OIIO::TypeDesc::UNKNOWN, m_internalImpl->data());
+    in->close();
+    in->set_ioproxy(nullptr);
+    return read ? FrameworkReturnCode::_SUCCESS : FrameworkReturnCode::_ERROR_LOAD_IMAGE;
+}
+
+void Image::preEncode(const std::vector<SRef<Image>> & images)
+{
+    std::vector<SRef<Image>> encodedImages;
+    for (const auto & image : images)
+        if (image && ((image->m_imageEncoding == ENCODING_JPEG) || (image->m_imageEncoding == ENCODING_PNG)))
+            encodedImages.push_back(image);
+
+    // each thread of the pool encodes with its own encoders
+    std::vector<std::vector<uint8_t>> encodedData(encodedImages.size());
+    std::vector<FrameworkReturnCode> results(encodedImages.size(), FrameworkReturnCode::_ERROR_);
+    ThreadPool::instance().parallelFor(static_cast<uint32_t>(encodedImages.size()), [&](uint32_t i) {
+        results[i] = encodedImages[i]->encode(encodedData[i]);
+    });
+
+    // images which failed to encode are encoded again, and reported, when serialized
+    for (size_t i = 0; i < encodedImages.size(); i++)
+        if (results[i] == FrameworkReturnCode::_SUCCESS)
+            t_preEncodedImages[encodedImages[i].get()] = {encodedImages[i], std::move(encodedData[i])};
+}
+
+void Image::clearPreEncoded()
+{
+    t_preEncodedImages.clear();
+}
+
 FrameworkReturnCode Image::save(std::string imagePath) const
 {
     Image::ImageEncoding encoding;
@@ -288,7 +582,8 @@ FrameworkReturnCode Image::save(std::string imagePath) const
             break;
     }
 
-    OIIO::ImageBuf sourceBuf = OIIO::ImageBuf(spec, m_internalImpl->data());
+    std::vector<uint8_t> continuousData;
+    OIIO::ImageBuf sourceBuf = OIIO::ImageBuf(spec, const_cast<void*>(getContinuousData(continuousData)));
 
     // Convert to BGR or GRB to RGB channel format
     if (m_layout == Image::ImageLayout::LAYOUT_BGR)
@@ -302,6 +597,20 @@ FrameworkReturnCode Image::save(std::string imagePath) const
 template<class Archive>
 void Image::save(Archive & ar, const unsigned int /* version */) const
 {
+    // a region is compacted, so that the archive only contains its pixels
+    auto savePixels = [this, &ar]() {
+        const bool compacted = isRegion();
+        ar & compacted;
+        if (compacted) {
+            std::vector<uint8_t> pixels(computeImageBufferSize());
+            copyPixels(pixels.data());
+            ar & pixels;
+        }
+        else {
+            ar & m_internalImpl;
+        }
+    };
+
     ar & m_size;
     ar & m_layout;
     ar & m_pixOrder;
@@ -313,69 +622,33 @@ void Image::save(Archive & ar, const unsigned int /* version */) const
     ar & m_imageEncoding;
 
     if ((m_imageEncoding == ENCODING_JPEG) || (m_imageEncoding == ENCODING_PNG)) {
-
-        // ImageSpec describing the image we want to write.
-        OIIO::ImageSpec spec;
-        if (SolAR2OIIOType.find(m_type) == SolAR2OIIOType.end())
-            spec = OIIO::ImageSpec(m_size.width, m_size.height, m_nbChannels);
-        else
-            spec = OIIO::ImageSpec(m_size.width, m_size.height, m_nbChannels, SolAR2OIIOType.at(m_type));
-
-        if (SolAR2OIIOLayout.find(m_layout) != SolAR2OIIOLayout.end())
-            spec.channelnames=SolAR2OIIOLayout.at(m_layout);
-
-        std::vector<unsigned char> file_buffer;  // bytes will go here
-        OIIO::Filesystem::IOVecOutput encodingBuffer (file_buffer);  // I/O proxy object;
-
-        std::string filename;
-        switch (m_imageEncoding)
-        {
-            case ENCODING_JPEG:
-                filename="out.jpeg";
-                spec.attribute ("Compression","jpeg:" + std::to_string(m_imageEncodingQuality));
-                break;
-            case ENCODING_PNG:
-                filename = "out.png";
-                if (m_imageEncodingQuality==0)
-                    spec.attribute ("png:compressionLevel", 0);
-                else if (m_imageEncodingQuality>=100)
-                    spec.attribute ("png:compressionLevel", 9);
-                else
-                {
-                    // PNG encoding quality should be defined between 0 and 9.
-                    spec.attribute ("png:compressionLevel", (int)floor(m_imageEncodingQuality/10.0f));
-                }
-                break;
-            case ENCODING_NONE:
-            default:
-                filename = "out";
-        }
-
-        auto out = OIIO::ImageOutput::create (filename, &encodingBuffer);
-        if (!out) {
-            std::cerr << "ImageOutput::create : " << OIIO::geterror() << std::endl;
-            return;
+        std::vector<uint8_t> file_buffer;  // bytes will go here
+        FrameworkReturnCode result = FrameworkReturnCode::_ERROR_;
+        auto preEncoded = t_preEncodedImages.find(this);
+        if (preEncoded != t_preEncodedImages.end()) {
+            // the address may have been reused since preEncode
+            if (preEncoded->second.image.lock().get() == this) {
+                file_buffer = std::move(preEncoded->second.encodedData);
+                result = FrameworkReturnCode::_SUCCESS;
+            }
+            t_preEncodedImages.erase(preEncoded);
         }
+        if (result != FrameworkReturnCode::_SUCCESS)
+            result = encode(file_buffer);
 
-        if (!out->supports("ioproxy"))
+        if (result == FrameworkReturnCode::_NOT_IMPLEMENTED)
         {
             std::cout << "Decoding image to a buffer based on OIIO::ioporxy is not supported for this image format. Save image in raw format.)";
-            ar & m_internalImpl;
+            savePixels();
             return;
         }
-        out->open (filename, spec);
-
-        if (!out->write_image (SolAR2OIIOType[m_type], m_internalImpl->data()))
-        {
-            std::cerr << "Error while writing the " << filename << " image to the serialization buffer. " << std::endl << OIIO::geterror() << std::endl;
+        if (result != FrameworkReturnCode::_SUCCESS)
             return;
-        }
-        out->close ();
 
         ar & file_buffer;
     }
     else {
-        ar & m_internalImpl;
+        savePixels();
     }
 }
 
@@ -394,8 +667,8 @@ FrameworkReturnCode Image::load(std::string imagePath)
     m_nbChannels = spec.nchannels;
 
     OIIO::imagesize_t buffersize = spec.image_bytes(true);
-    auto pixels = std::make_unique<unsigned char[]>(buffersize);
-    in->read_image(0, 0, 0, m_nbChannels, OIIO::TypeDesc::UNKNOWN, pixels.get());
+    SRef<ImageInternal> pixels = utils::make_shared<ImageInternal>(static_cast<uint32_t>(buffersize));
+    in->read_image(0, 0, 0, m_nbChannels, OIIO::TypeDesc::UNKNOWN, pixels->data());
 
     if (OIIO2SolARType.find(spec.format) != OIIO2SolARType.end())
     {
@@ -431,16 +704,19 @@ FrameworkReturnCode Image::load(std::string imagePath)
            return FrameworkReturnCode::_ERROR_LOAD_IMAGE;
     }
 
-    m_internalImpl = utils::make_shared<ImageInternal>();
-    m_internalImpl->setData(pixels.get(), spec.image_bytes(true));
+    m_internalImpl = pixels;
+    m_rowStride = 0;
+    m_offset = 0;
     in->close();
 
     return FrameworkReturnCode::_SUCCESS;
 }
 
 template<class Archive>
-void Image::load(Archive & ar, const unsigned int /* version */)
+void Image::load(Archive & ar, const unsigned int version)
 {
+     m_rowStride = 0;
+     m_offset = 0;
      ar & m_size;
      ar & m_layout;
      ar & m_pixOrder;
@@ -456,104 +732,392 @@ void Image::load(Archive & ar, const unsigned int /* version */)
          std::vector<unsigned char> decodingBuffer;
          ar & decodingBuffer;
 
-         OIIO::Filesystem::IOMemReader memreader(decodingBuffer.data(), decodingBuffer.size());
-
-         std::string filename;
-         switch (m_imageEncoding)
-         {
-             case ENCODING_JPEG:
-                 filename="in.jpg";
-                 break;
-             case ENCODING_PNG:
-                 filename = "in.png";
-                 break;
-             case ENCODING_NONE:
-             default:
-                 filename="in.jpg";
-                 break;
+         decode(decodingBuffer.data(), decodingBuffer.size(), m_imageEncoding);
+     }
+     else {
+         bool compacted = false;
+         if (version > 0)
+             ar & compacted;
+         if (compacted) {
+             std::vector<uint8_t> pixels;
+             ar & pixels;
+             m_internalImpl = utils::make_shared<ImageInternal>(std::move(pixels));
+         }
+         else {
+             ar & m_internalImpl;
          }
+     }
+}
 
-         auto in = OIIO::ImageInput::open (filename, nullptr, &memreader);
-         const OIIO::ImageSpec & spec = in->spec();
+namespace {
+// ---------------------------------------------------------------------------
+// Pixel transformation kernels: pixels are moved as blocks of N bytes, row steps may be negative
+// ---------------------------------------------------------------------------
 
-         OIIO::imagesize_t buffersize = spec.image_bytes(true);
-         auto pixels = std::make_unique<unsigned char[]>(buffersize);
-         in->read_image(0, 0, 0, m_nbChannels, OIIO::TypeDesc::UNKNOWN, pixels.get());
+inline const uint8_t* rowAt(const uint8_t* base, ptrdiff_t step, uint32_t row)
+{
+    return base + static_cast<ptrdiff_t>(row) * step;
+}
 
-         m_internalImpl = utils::make_shared<ImageInternal>();
-         m_internalImpl->setData(pixels.get(), spec.image_bytes(true));
-         in->close();
-         decodingBuffer.clear();
-         memreader.close();
-     }
-     else {
-         ar & m_internalImpl;
-     }
+inline uint8_t* rowAt(uint8_t* base, ptrdiff_t step, uint32_t row)
+{
+    return base + static_cast<ptrdiff_t>(row) * step;
 }
 
-FrameworkReturnCode Image::rotate(RotateQuantity degrees)
+// dst(c, r) = src(r, c) for r in [r0, r1) and c in [c0, c1)
+template<uint32_t N>
+void transposeScalar(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep,
+                     uint32_t r0, uint32_t r1, uint32_t c0, uint32_t c1)
 {
-    OIIO::TypeDesc type;
-    if (SolAR2OIIOType.find(m_type) != SolAR2OIIOType.end())
-        type = SolAR2OIIOType.at(m_type);
-    else
-        type = OIIO::TypeDesc::UNKNOWN;
+    for (uint32_t c = c0; c < c1; c++) {
+        uint8_t* dstRow = rowAt(dst, dstStep, c);
+        for (uint32_t r = r0; r < r1; r++)
+            std::memcpy(dstRow + r * N, rowAt(src, srcStep, r) + c * N, N);
+    }
+}
 
-    OIIO::ImageSpec spec = OIIO::ImageSpec(m_size.width, m_size.height, m_nbChannels, type);
+// transpose the tile by blocks of B x B pixels, the borders of the tile are transposed by the scalar kernel
+template<uint32_t N, uint32_t B, typename BlockKernel>
+void transposeBlocks(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep,
+                     uint32_t r0, uint32_t r1, uint32_t c0, uint32_t c1, BlockKernel block)
+{
+    uint32_t r = r0;
+    for (; r + B <= r1; r += B) {
+        uint32_t c = c0;
+        for (; c + B <= c1; c += B)
+            block(rowAt(src, srcStep, r) + c * N, srcStep, rowAt(dst, dstStep, c) + r * N, dstStep);
+        transposeScalar<N>(src, srcStep, dst, dstStep, r, r + B, c, c1);
+    }
+    transposeScalar<N>(src, srcStep, dst, dstStep, r, r1, c0, c1);
+}
 
-    spec.nchannels = m_nbChannels;
-    if (SolAR2OIIOLayout.find(m_layout) != SolAR2OIIOLayout.end())
-        spec.channelnames = SolAR2OIIOLayout.at(m_layout);
+#ifdef SOLAR_IMAGE_X86
+inline void transpose8x8U8(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep)
+{
+    __m128i a[8];
+    for (uint32_t i = 0; i < 8; i++)
+        a[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rowAt(src, srcStep, i)));
+    __m128i t0 = _mm_unpacklo_epi8(a[0], a[1]);
+    __m128i t1 = _mm_unpacklo_epi8(a[2], a[3]);
+    __m128i t2 = _mm_unpacklo_epi8(a[4], a[5]);
+    __m128i t3 = _mm_unpacklo_epi8(a[6], a[7]);
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+    // each vector holds two columns of 8 bytes
+    __m128i v[4] = {_mm_unpacklo_epi32(u0, u2), _mm_unpackhi_epi32(u0, u2), _mm_unpacklo_epi32(u1, u3), _mm_unpackhi_epi32(u1, u3)};
+    for (uint32_t i = 0; i < 4; i++) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(rowAt(dst, dstStep, 2 * i)), v[i]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(rowAt(dst, dstStep, 2 * i + 1)), _mm_unpackhi_epi64(v[i], v[i]));
+    }
+}
 
-    spec.attribute ("oiio:ColorSpace", "sRGB");
+inline void transpose4x4U32(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep)
+{
+    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowAt(src, srcStep, 0)));
+    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowAt(src, srcStep, 1)));
+    __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowAt(src, srcStep, 2)));
+    __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowAt(src, srcStep, 3)));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rowAt(dst, dstStep, 0)), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rowAt(dst, dstStep, 1)), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rowAt(dst, dstStep, 2)), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rowAt(dst, dstStep, 3)), _mm_unpackhi_epi64(t2, t3));
+}
+#elif defined(SOLAR_IMAGE_NEON)
+inline void transpose4x4U32(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep)
+{
+    uint32x4x2_t p01 = vtrnq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(rowAt(src, srcStep, 0))),
+                                 vld1q_u32(reinterpret_cast<const uint32_t*>(rowAt(src, srcStep, 1))));
+    uint32x4x2_t p23 = vtrnq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(rowAt(src, srcStep, 2))),
+                                 vld1q_u32(reinterpret_cast<const uint32_t*>(rowAt(src, srcStep, 3))));
+    vst1q_u32(reinterpret_cast<uint32_t*>(rowAt(dst, dstStep, 0)), vcombine_u32(vget_low_u32(p01.val[0]), vget_low_u32(p23.val[0])));
+    vst1q_u32(reinterpret_cast<uint32_t*>(rowAt(dst, dstStep, 1)), vcombine_u32(vget_low_u32(p01.val[1]), vget_low_u32(p23.val[1])));
+    vst1q_u32(reinterpret_cast<uint32_t*>(rowAt(dst, dstStep, 2)), vcombine_u32(vget_high_u32(p01.val[0]), vget_high_u32(p23.val[0])));
+    vst1q_u32(reinterpret_cast<uint32_t*>(rowAt(dst, dstStep, 3)), vcombine_u32(vget_high_u32(p01.val[1]), vget_high_u32(p23.val[1])));
+}
+#endif
 
-    OIIO::ImageBuf sourceBuf = OIIO::ImageBuf(spec, m_internalImpl->data());
+template<uint32_t N>
+void transposeTile(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep,
+                   uint32_t r0, uint32_t r1, uint32_t c0, uint32_t c1)
+{
+#ifdef SOLAR_IMAGE_X86
+    if constexpr (N == 1)
+        return transposeBlocks<N, 8>(src, srcStep, dst, dstStep, r0, r1, c0, c1, transpose8x8U8);
+#endif
+#if defined(SOLAR_IMAGE_X86) || defined(SOLAR_IMAGE_NEON)
+    if constexpr (N == 4)
+        return transposeBlocks<N, 4>(src, srcStep, dst, dstStep, r0, r1, c0, c1, transpose4x4U32);
+#endif
+    transposeScalar<N>(src, srcStep, dst, dstStep, r0, r1, c0, c1);
+}
 
-    // Convert to BGR or GRB to RGB channel format
-    if (m_layout == Image::ImageLayout::LAYOUT_BGR)
-        sourceBuf = OIIO::ImageBufAlgo::channels(sourceBuf, 3, { 2, 1, 0 });
+// dst(c, r) = src(r, c) for the width x height source, tiled to keep source and destination rows in cache
+template<uint32_t N>
+void transpose(const uint8_t* src, ptrdiff_t srcStep, uint8_t* dst, ptrdiff_t dstStep, uint32_t width, uint32_t height)
+{
+    constexpr uint32_t tileSize = 32;
+    for (uint32_t r0 = 0; r0 < height; r0 += tileSize)
+        for (uint32_t c0 = 0; c0 < width; c0 += tileSize)
+            transposeTile<N>(src, srcStep, dst, dstStep, r0, std::min(r0 + tileSize, height), c0, std::min(c0 + tileSize, width));
+}
 
-    OIIO::ImageBuf rotatedBuf;
-    bool rotateSuccess = false;
+// dst[width - 1 - c] = src[c]
+template<uint32_t N>
+void reverseRow(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    uint32_t c = 0;
+#ifdef SOLAR_IMAGE_X86
+    if constexpr (N == 1) {
+        for (; c + 16 <= width; c += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c));
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + width - c - 16), v);
+        }
+    }
+    if constexpr (N == 4) {
+        for (; c + 4 <= width; c += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (width - c - 4) * 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+        }
+    }
+#elif defined(SOLAR_IMAGE_NEON)
+    if constexpr (N == 1) {
+        for (; c + 16 <= width; c += 16) {
+            uint8x16_t v = vrev64q_u8(vld1q_u8(src + c));
+            vst1q_u8(dst + width - c - 16, vextq_u8(v, v, 8));
+        }
+    }
+    if constexpr (N == 4) {
+        for (; c + 4 <= width; c += 4) {
+            uint32x4_t v = vrev64q_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(src + c * 4)));
+            vst1q_u32(reinterpret_cast<uint32_t*>(dst + (width - c - 4) * 4), vextq_u32(v, v, 2));
+        }
+    }
+#endif
+    for (; c < width; c++)
+        std::memcpy(dst + (width - 1 - c) * N, src + c * N, N);
+}
+
+// call kernel with the pixel size as a compile-time constant
+template<typename Kernel>
+bool dispatchPixelSize(uint32_t pixelSize, Kernel && kernel)
+{
+    switch (pixelSize) {
+    case 1: kernel(std::integral_constant<uint32_t, 1>()); return true;
+    case 2: kernel(std::integral_constant<uint32_t, 2>()); return true;
+    case 3: kernel(std::integral_constant<uint32_t, 3>()); return true;
+    case 4: kernel(std::integral_constant<uint32_t, 4>()); return true;
+    case 6: kernel(std::integral_constant<uint32_t, 6>()); return true;
+    case 8: kernel(std::integral_constant<uint32_t, 8>()); return true;
+    case 12: kernel(std::integral_constant<uint32_t, 12>()); return true;
+    case 16: kernel(std::integral_constant<uint32_t, 16>()); return true;
+    case 24: kernel(std::integral_constant<uint32_t, 24>()); return true;
+    case 32: kernel(std::integral_constant<uint32_t, 32>()); return true;
+    default: return false;
+    }
+}
+}
+
+FrameworkReturnCode Image::transform(Transformation transformation, Image & destination) const
+{
+    if (&destination == this) {
+        std::cerr << "Image::transform - the destination must be another image" << std::endl;
+        return FrameworkReturnCode::_ERROR_;
+    }
+    // a planar image is transformed plane by plane, a plane storing one component per pixel
+    const bool planar = (m_pixOrder == PixelOrder::PER_CHANNEL);
+    const uint32_t pixelSize = planar ? m_nbBitsPerComponent / 8 : getPixelSize();
+    const uint32_t nbPlanes = planar ? m_nbPlanes : 1;
+    const uint32_t width = m_size.width;
+    const uint32_t height = m_size.height;
+    const bool transposed = (transformation == Transformation::ROTATE_90) || (transformation == Transformation::ROTATE_270);
+
+    // the destination gets storage of its own if it shares pixels, borrowed memory included, with an image
+    if (!destination.m_internalImpl || (destination.m_internalImpl == m_internalImpl) || destination.isRegion() || destination.m_internalImpl->isExternal()) {
+        destination.m_internalImpl = utils::make_shared<ImageInternal>();
+        destination.m_rowStride = 0;
+        destination.m_offset = 0;
+    }
+    destination.m_layout = m_layout;
+    destination.m_pixOrder = m_pixOrder;
+    destination.m_type = m_type;
+    destination.m_nbChannels = m_nbChannels;
+    destination.m_nbPlanes = m_nbPlanes;
+    destination.m_nbBitsPerComponent = m_nbBitsPerComponent;
+    destination.m_imageEncoding = m_imageEncoding;
+    destination.m_imageEncodingQuality = m_imageEncodingQuality;
+    if (transposed)
+        destination.setSize(height, width);
+    else
+        destination.setSize(width, height);
+    if ((width == 0) || (height == 0))
+        return FrameworkReturnCode::_SUCCESS;
+
+    const ptrdiff_t srcStep = planar ? width * pixelSize : getStep();
+    const ptrdiff_t dstStep = destination.m_size.width * pixelSize;
+    const uint8_t* srcPlane = static_cast<const uint8_t*>(data());
+    uint8_t* dstPlane = static_cast<uint8_t*>(destination.data());
+    bool supported = dispatchPixelSize(pixelSize, [&](auto pixelBytes) {
+        constexpr uint32_t N = decltype(pixelBytes)::value;
+        for (uint32_t plane = 0; plane < nbPlanes; plane++) {
+            const uint8_t* src = srcPlane + plane * srcStep * height;
+            uint8_t* dst = dstPlane + plane * dstStep * destination.m_size.height;
+            switch (transformation) {
+            case Transformation::ROTATE_90:
+                // dst(c, height - 1 - r) = src(r, c): transposition of the source read bottom-up
+                transpose<N>(rowAt(src, srcStep, height - 1), -srcStep, dst, dstStep, width, height);
+                break;
+            case Transformation::ROTATE_270:
+                // dst(width - 1 - c, r) = src(r, c): transposition written bottom-up
+                transpose<N>(src, srcStep, rowAt(dst, dstStep, width - 1), -dstStep, width, height);
+                break;
+            case Transformation::ROTATE_180:
+                for (uint32_t r = 0; r < height; r++)
+                    reverseRow<N>(rowAt(src, srcStep, r), rowAt(dst, dstStep, height - 1 - r), width);
+                break;
+            case Transformation::FLIP_HORIZONTAL:
+                for (uint32_t r = 0; r < height; r++)
+                    reverseRow<N>(rowAt(src, srcStep, r), rowAt(dst, dstStep, r), width);
+                break;
+            case Transformation::FLIP_VERTICAL:
+                for (uint32_t r = 0; r < height; r++)
+                    std::memcpy(rowAt(dst, dstStep, height - 1 - r), rowAt(src, srcStep, r), width * N);
+                break;
+            case Transformation::COPY:
+            default:
+                for (uint32_t r = 0; r < height; r++)
+                    std::memcpy(rowAt(dst, dstStep, r), rowAt(src, srcStep, r), width * N);
+                break;
+            }
+        }
+    });
+    if (!supported) {
+        std::cerr << "Image::transform - pixels of " << pixelSize << " bytes are not supported" << std::endl;
+        return FrameworkReturnCode::_ERROR_;
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode Image::transform(Transformation transformation)
+{
+    // the copy shares the pixels of the image, so that they are transformed into a new storage:
+    // the storage of the parent of a region or of borrowed memory is left untouched
+    Image transformed(*this);
+    FrameworkReturnCode result = transform(transformation, transformed);
+    if (result != FrameworkReturnCode::_SUCCESS)
+        return result;
+    m_internalImpl = transformed.m_internalImpl;
+    m_size = transformed.m_size;
+    m_rowStride = 0;
+    m_offset = 0;
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode Image::rotate(RotateQuantity degrees)
+{
     switch (degrees) {
+    case RotateQuantity::DEGREE_0:
+        return FrameworkReturnCode::_SUCCESS;
     case RotateQuantity::DEGREE_90:
-        rotateSuccess = OIIO::ImageBufAlgo::rotate90(rotatedBuf, sourceBuf);
-        break;
+        return transform(Transformation::ROTATE_90);
     case RotateQuantity::DEGREE_180:
-        rotateSuccess = OIIO::ImageBufAlgo::rotate180(rotatedBuf, sourceBuf);
-        break;
+        return transform(Transformation::ROTATE_180);
     case RotateQuantity::DEGREE_270:
-        rotateSuccess = OIIO::ImageBufAlgo::rotate270(rotatedBuf, sourceBuf);
-        break;
+        return transform(Transformation::ROTATE_270);
+    default:
+        std::cerr << "Image rotation which is not 90, 180 or 270 degrees is not supported" << std::endl;
+        return FrameworkReturnCode::_ERROR_;
+    }
+}
+
+FrameworkReturnCode Image::rotate(RotateQuantity degrees, Image & destination) const
+{
+    if (&destination == this)
+        return destination.rotate(degrees);
+    switch (degrees) {
     case RotateQuantity::DEGREE_0:
-        return FrameworkReturnCode::_SUCCESS;
+        return transform(Transformation::COPY, destination);
+    case RotateQuantity::DEGREE_90:
+        return transform(Transformation::ROTATE_90, destination);
+    case RotateQuantity::DEGREE_180:
+        return transform(Transformation::ROTATE_180, destination);
+    case RotateQuantity::DEGREE_270:
+        return transform(Transformation::ROTATE_270, destination);
     default:
-        // not supported by OpenImageIO
         std::cerr << "Image rotation which is not 90, 180 or 270 degrees is not supported" << std::endl;
         return FrameworkReturnCode::_ERROR_;
     }
+}
 
-    if (!rotateSuccess)
+FrameworkReturnCode Image::rotate(float angle)
+{
+    // multiples of 90 degrees are exact, whatever the sign
+    double quarters = std::round(angle / 90.0);
+    if (std::abs(angle / 90.0 - quarters) < 1e-6) {
+        static const RotateQuantity rotations[] = {RotateQuantity::DEGREE_0, RotateQuantity::DEGREE_90,
+                                                   RotateQuantity::DEGREE_180, RotateQuantity::DEGREE_270};
+        return rotate(rotations[((static_cast<long long>(quarters) % 4) + 4) % 4]);
+    }
+
+    if (m_pixOrder != PixelOrder::INTERLEAVED) {
+        std::cerr << "Image rotation by an arbitrary angle is only supported for interleaved images" << std::endl;
         return FrameworkReturnCode::_ERROR_;
-    
-    if (rotatedBuf.has_error())
+    }
+
+    OIIO::TypeDesc type;
+    if (SolAR2OIIOType.find(m_type) != SolAR2OIIOType.end())
+        type = SolAR2OIIOType.at(m_type);
+    else
+        type = OIIO::TypeDesc::UNKNOWN;
+
+    OIIO::ImageSpec spec = OIIO::ImageSpec(m_size.width, m_size.height, m_nbChannels, type);
+
+    spec.nchannels = m_nbChannels;
+    if (SolAR2OIIOLayout.find(m_layout) != SolAR2OIIOLayout.end())
+        spec.channelnames = SolAR2OIIOLayout.at(m_layout);
+
+    std::vector<uint8_t> continuousData;
+    OIIO::ImageBuf sourceBuf = OIIO::ImageBuf(spec, const_cast<void*>(std::as_const(*this).getContinuousData(continuousData)));
+
+    // OpenImageIO angles are in radians, clockwise
+    constexpr double pi = 3.14159265358979323846;
+    OIIO::ImageBuf rotatedBuf;
+    if (!OIIO::ImageBufAlgo::rotate(rotatedBuf, sourceBuf, static_cast<float>(angle * pi / 180.0)) || rotatedBuf.has_error())
     {
         std::cerr << "error: " << rotatedBuf.geterror() << std::endl;
         return FrameworkReturnCode::_ERROR_;
     }
 
-    if (degrees == RotateQuantity::DEGREE_90 || degrees == RotateQuantity::DEGREE_270)
-        setSize(m_size.height, m_size.width);
-
-    std::vector<unsigned char> result;
-    result.resize (m_size.width * m_size.height * m_nbBitsPerComponent * m_nbChannels);
-
-    if (!rotatedBuf.get_pixels(OIIO::ROI::All(), type, &result[0]))
+    // a region gets its own storage instead of overwriting its parent image
+    SRef<ImageInternal> pixels = utils::make_shared<ImageInternal>(computeImageBufferSize());
+    if (!rotatedBuf.get_pixels(sourceBuf.roi(), type, pixels->data()))
         return FrameworkReturnCode::_ERROR_;
-    m_internalImpl->setData(&result[0], m_internalImpl->getBufferSize());
+    m_internalImpl = pixels;
+    m_rowStride = 0;
+    m_offset = 0;
     return FrameworkReturnCode::_SUCCESS;
 }
 
+FrameworkReturnCode Image::flip(FlipDirection direction)
+{
+    return transform((direction == FlipDirection::HORIZONTAL) ? Transformation::FLIP_HORIZONTAL : Transformation::FLIP_VERTICAL);
+}
+
+FrameworkReturnCode Image::flip(FlipDirection direction, Image & destination) const
+{
+    if (&destination == this)
+        return destination.flip(direction);
+    return transform((direction == FlipDirection::HORIZONTAL) ? Transformation::FLIP_HORIZONTAL : Transformation::FLIP_VERTICAL, destination);
+}
+
 FrameworkReturnCode Image::rotate90() 
 {
     return rotate(Image::RotateQuantity::DEGREE_90);
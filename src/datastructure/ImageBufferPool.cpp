@@ -0,0 +1,151 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "datastructure/ImageBufferPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <xpcf/core/helpers.h>
+
+namespace xpcf  = org::bcom::xpcf;
+
+namespace SolAR {
+namespace datastructure {
+
+// size classes are multiples of a quarter of the power of two below the size, and of a page
+static constexpr uint32_t minSizeClassStep = 4096;
+
+struct ImageBufferPool::FreeBuffers {
+    mutable std::mutex mutex;
+    // released buffers by capacity
+    std::map<uint32_t, std::vector<std::unique_ptr<uint8_t[]>>> buffers;
+    uint64_t nbBytes = 0;
+    uint64_t maxBytes;
+    uint32_t maxBuffersPerSizeClass;
+
+    // delete the buffers exceeding the limits, must be called with the mutex locked
+    void trim(std::vector<std::unique_ptr<uint8_t[]>> & deleted)
+    {
+        for (auto it = buffers.rbegin(); it != buffers.rend(); ++it) {
+            auto & classBuffers = it->second;
+            while (!classBuffers.empty() && ((nbBytes > maxBytes) || (classBuffers.size() > maxBuffersPerSizeClass))) {
+                deleted.push_back(std::move(classBuffers.back()));
+                classBuffers.pop_back();
+                nbBytes -= it->first;
+            }
+        }
+    }
+};
+
+ImageBufferPool::ImageBufferPool(uint64_t maxFreeBytes, uint32_t maxFreeBuffersPerSizeClass) :
+    m_freeBuffers(xpcf::utils::make_shared<FreeBuffers>())
+{
+    m_freeBuffers->maxBytes = maxFreeBytes;
+    m_freeBuffers->maxBuffersPerSizeClass = maxFreeBuffersPerSizeClass;
+}
+
+ImageBufferPool & ImageBufferPool::instance()
+{
+    static ImageBufferPool pool;
+    return pool;
+}
+
+uint32_t ImageBufferPool::getCapacity(uint32_t size)
+{
+    if (size <= minSizeClassStep)
+        return minSizeClassStep;
+    uint32_t highestBit = 31;
+    while (((size - 1) >> highestBit) == 0)
+        highestBit--;
+    uint32_t step = std::max(minSizeClassStep, (highestBit >= 2) ? (1u << (highestBit - 2)) : 1u);
+    uint64_t capacity = ((static_cast<uint64_t>(size) + step - 1) / step) * step;
+    return (capacity > UINT32_MAX) ? size : static_cast<uint32_t>(capacity);
+}
+
+std::shared_ptr<uint8_t> ImageBufferPool::acquire(uint32_t size)
+{
+    if (size == 0)
+        return nullptr;
+    uint32_t capacity = getCapacity(size);
+    std::unique_ptr<uint8_t[]> buffer;
+    {
+        std::unique_lock lock(m_freeBuffers->mutex);
+        auto it = m_freeBuffers->buffers.find(capacity);
+        if ((it != m_freeBuffers->buffers.end()) && !it->second.empty()) {
+            buffer = std::move(it->second.back());
+            it->second.pop_back();
+            m_freeBuffers->nbBytes -= capacity;
+        }
+    }
+    // default initialization: the content is not zero-filled
+    if (!buffer)
+        buffer.reset(new uint8_t[capacity]);
+    std::weak_ptr<FreeBuffers> pool = m_freeBuffers;
+    return std::shared_ptr<uint8_t>(buffer.release(), [pool, capacity](uint8_t * released) {
+        std::unique_ptr<uint8_t[]> buffer(released);
+        SRef<FreeBuffers> freeBuffers = pool.lock();
+        if (!freeBuffers)
+            return;
+        std::unique_lock lock(freeBuffers->mutex);
+        auto & classBuffers = freeBuffers->buffers[capacity];
+        if ((classBuffers.size() < freeBuffers->maxBuffersPerSizeClass) && (freeBuffers->nbBytes + capacity <= freeBuffers->maxBytes)) {
+            classBuffers.push_back(std::move(buffer));
+            freeBuffers->nbBytes += capacity;
+        }
+    });
+}
+
+void ImageBufferPool::setLimits(uint64_t maxFreeBytes, uint32_t maxFreeBuffersPerSizeClass)
+{
+    std::vector<std::unique_ptr<uint8_t[]>> deleted;
+    std::unique_lock lock(m_freeBuffers->mutex);
+    m_freeBuffers->maxBytes = maxFreeBytes;
+    m_freeBuffers->maxBuffersPerSizeClass = maxFreeBuffersPerSizeClass;
+    m_freeBuffers->trim(deleted);
+}
+
+uint32_t ImageBufferPool::getNbFreeBuffers() const
+{
+    std::unique_lock lock(m_freeBuffers->mutex);
+    size_t nbBuffers = 0;
+    for (const auto & [capacity, classBuffers] : m_freeBuffers->buffers)
+        nbBuffers += classBuffers.size();
+    return static_cast<uint32_t>(nbBuffers);
+}
+
+uint64_t ImageBufferPool::getNbFreeBytes() const
+{
+    std::unique_lock lock(m_freeBuffers->mutex);
+    return m_freeBuffers->nbBytes;
+}
+
+void ImageBufferPool::clear()
+{
+    std::map<uint32_t, std::vector<std::unique_ptr<uint8_t[]>>> buffers;
+    {
+        std::unique_lock lock(m_freeBuffers->mutex);
+        buffers.swap(m_freeBuffers->buffers);
+        m_freeBuffers->nbBytes = 0;
+    }
+}
+
+}
+}
@@ -0,0 +1,61 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "datastructure/ImageView.h"
+#include <cstring>
+#include <xpcf/core/helpers.h>
+
+namespace xpcf = org::bcom::xpcf;
+
+namespace SolAR {
+namespace datastructure {
+
+ImageView::ImageView(Image & image)
+{
+    if (image.getPixelOrder() != Image::PixelOrder::INTERLEAVED)
+        return;
+    m_data = static_cast<uint8_t*>(image.data());
+    m_size = image.getSize();
+    m_step = image.getStep();
+    m_layout = image.getImageLayout();
+    m_type = image.getDataType();
+    m_nbChannels = image.getNbChannels();
+    m_nbBitsPerComponent = image.getNbBitsPerComponent();
+}
+
+ImageView ImageView::extractRegion(const Rectanglei & region) const
+{
+    if ((region.startX + region.size.width > m_size.width) || (region.startY + region.size.height > m_size.height))
+        return ImageView();
+    ImageView view(*this);
+    view.m_data = m_data + static_cast<size_t>(region.startY) * m_step + region.startX * getPixelSize();
+    view.m_size = region.size;
+    return view;
+}
+
+SRef<Image> ImageView::toImage() const
+{
+    SRef<Image> image = xpcf::utils::make_shared<Image>(m_size.width, m_size.height, m_layout, Image::PixelOrder::INTERLEAVED, m_type);
+    uint32_t rowSize = m_size.width * getPixelSize();
+    uint8_t* dst = static_cast<uint8_t*>(image->data());
+    for (uint32_t row = 0; row < m_size.height; row++)
+        std::memcpy(dst + static_cast<size_t>(row) * rowSize, getRow(row), rowSize);
+    return image;
+}
+
+}
+}
@@ -38,9 +38,9 @@ bool Keyframe::setKeypointStatusToMatched(uint32_t id_keypoint)
 	if (m_isKeypointMatchedStatusFrozen)
 		return false;
 	if (m_isKeypointMatched.empty()) {
-		if (m_keypoints.empty())
+		if (m_keypoints->empty())
 			return false;
-		m_isKeypointMatched.resize(m_keypoints.size(), false);
+		m_isKeypointMatched.resize(m_keypoints->size(), false);
 	}
 	if (id_keypoint >= m_isKeypointMatched.size())
 		return false;
@@ -15,8 +15,11 @@
  */
 
 #include "datastructure/KeyframeCollection.h"
+#include "datastructure/IVFDescriptorIndex.h"
+#include "datastructure/LSHDescriptorIndex.h"
 #include <xpcf/core/helpers.h>
 #include "core/Log.h"
+#include <limits>
 
 BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::KeyframeCollection);
 
@@ -65,6 +68,8 @@ void KeyframeCollection::addKeyframeInternal(const SRef<Keyframe> keyframe, bool
         keyframe->setId(m_id++);
     }
     m_keyframes[keyframe->getId()] = keyframe;
+    // the descriptors of a replaced keyframe are overwritten in place in the index
+    indexKeyframe(keyframe);
     if (keyframe->getReferenceKeyframe()) {
         m_refKeyframeToKeyframes[keyframe->getReferenceKeyframe()->getId()].insert(keyframe->getId());
     }
@@ -160,6 +165,7 @@ FrameworkReturnCode KeyframeCollection::suppressKeyframe(const uint32_t id)
         }
     }
     // remove keyframe_id
+    indexKeyframe(keyframeIt->second, true);
     m_keyframes.erase(keyframeIt);
     return FrameworkReturnCode::_SUCCESS;
 }
@@ -199,6 +205,104 @@ uint32_t KeyframeCollection::getNbKeyframesHavingImage() const
     return n;
 }
 
+const SRef<DescriptorIndex> & KeyframeCollection::getDescriptorIndex() const
+{
+    return m_descriptorIndex;
+}
+
+FrameworkReturnCode KeyframeCollection::setDescriptorIndex(const SRef<DescriptorIndex> index)
+{
+    if (index && (index->getNbDescriptors() > 0)) {
+        LOG_ERROR("KeyframeCollection::setDescriptorIndex - the descriptor index must be empty");
+        return FrameworkReturnCode::_ERROR_;
+    }
+    m_descriptorIndex = index;
+    m_descriptorIndexRanges.clear();
+    m_descriptorIndexRangeKeyframes.clear();
+    m_nextDescriptorIndexId = 0;
+    for (const auto& [id, kf] : m_keyframes) {
+        indexKeyframe(kf);
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode KeyframeCollection::getDescriptorIndexId(const uint32_t keyframeId, const uint32_t keypointIndex, uint32_t & descriptorIndexId) const
+{
+    auto rangeIt = m_descriptorIndexRanges.find(keyframeId);
+    if ((rangeIt == m_descriptorIndexRanges.end()) || (keypointIndex >= rangeIt->second.second)) {
+        LOG_DEBUG("KeyframeCollection::getDescriptorIndexId - descriptor {} of keyframe {} is not indexed", keypointIndex, keyframeId);
+        return FrameworkReturnCode::_ERROR_;
+    }
+    descriptorIndexId = rangeIt->second.first + keypointIndex;
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode KeyframeCollection::getKeyframeDescriptor(const uint32_t descriptorIndexId, uint32_t & keyframeId, uint32_t & keypointIndex) const
+{
+    // the range starting at or before the id
+    auto keyframeIt = m_descriptorIndexRangeKeyframes.upper_bound(descriptorIndexId);
+    if (keyframeIt != m_descriptorIndexRangeKeyframes.begin()) {
+        --keyframeIt;
+        const auto & [firstId, nbIds] = m_descriptorIndexRanges.at(keyframeIt->second);
+        if (descriptorIndexId - firstId < nbIds) {
+            keyframeId = keyframeIt->second;
+            keypointIndex = descriptorIndexId - firstId;
+            return FrameworkReturnCode::_SUCCESS;
+        }
+    }
+    LOG_DEBUG("KeyframeCollection::getKeyframeDescriptor - id {} is not allocated to a keyframe", descriptorIndexId);
+    return FrameworkReturnCode::_ERROR_;
+}
+
+void KeyframeCollection::releaseDescriptorIndexRange(const uint32_t keyframeId)
+{
+    auto rangeIt = m_descriptorIndexRanges.find(keyframeId);
+    if (rangeIt == m_descriptorIndexRanges.end()) {
+        return;
+    }
+    const auto & [firstId, nbIds] = rangeIt->second;
+    for (uint32_t i = 0; i < nbIds; i++) {
+        m_descriptorIndex->remove(firstId + i);
+    }
+    m_descriptorIndexRangeKeyframes.erase(firstId);
+    m_descriptorIndexRanges.erase(rangeIt);
+}
+
+void KeyframeCollection::indexKeyframe(const SRef<Keyframe> & keyframe, bool remove)
+{
+    if (!m_descriptorIndex) {
+        return;
+    }
+    const SRef<DescriptorBuffer>& descriptors = keyframe->getDescriptors();
+    uint32_t nbDescriptors = (remove || !descriptors) ? 0 : descriptors->getNbDescriptors();
+    // the range of a re-added keyframe is reused when it is large enough, its descriptors are then overwritten in place
+    auto rangeIt = m_descriptorIndexRanges.find(keyframe->getId());
+    if ((rangeIt != m_descriptorIndexRanges.end()) && ((nbDescriptors == 0) || (rangeIt->second.second < nbDescriptors))) {
+        releaseDescriptorIndexRange(keyframe->getId());
+        rangeIt = m_descriptorIndexRanges.end();
+    }
+    if (nbDescriptors == 0) {
+        return;
+    }
+    if (rangeIt == m_descriptorIndexRanges.end()) {
+        if (nbDescriptors > std::numeric_limits<uint32_t>::max() - m_nextDescriptorIndexId) {
+            LOG_ERROR("KeyframeCollection::indexKeyframe - no more ids in the descriptor index for the {} descriptors of keyframe {}", nbDescriptors, keyframe->getId());
+            return;
+        }
+        rangeIt = m_descriptorIndexRanges.emplace(keyframe->getId(), std::make_pair(m_nextDescriptorIndexId, nbDescriptors)).first;
+        m_descriptorIndexRangeKeyframes[m_nextDescriptorIndexId] = keyframe->getId();
+        m_nextDescriptorIndexId += nbDescriptors;
+    }
+    const auto & [firstId, nbIds] = rangeIt->second;
+    for (uint32_t i = 0; i < nbDescriptors; i++) {
+        m_descriptorIndex->add(firstId + i, descriptors->getDescriptor(i));
+    }
+    // the ids of a reused range beyond the new descriptors
+    for (uint32_t i = nbDescriptors; i < nbIds; i++) {
+        m_descriptorIndex->remove(firstId + i);
+    }
+}
+
 void KeyframeCollection::nextSerializationWithoutKeyframeImages()
 {
     for (const auto& [id, kf]: m_keyframes) {
@@ -228,13 +332,38 @@ void KeyframeCollection::serialize(Archive &ar, const unsigned int version)
 {
 	ar & m_id;
 	ar & m_descriptorType;
-	ar & m_keyframes;
+    if (Archive::is_saving::value) {
+        // encode the keyframe images concurrently, then stream them with their keyframes
+        std::vector<SRef<Image>> images;
+        for (const auto & [id, keyframe] : m_keyframes)
+            if (keyframe->m_serializeImage && keyframe->getView())
+                images.push_back(keyframe->getView());
+        Image::preEncode(images);
+        struct PreEncodedImagesCleaner {
+            ~PreEncodedImagesCleaner() { Image::clearPreEncoded(); }
+        } cleaner;
+        ar & m_keyframes;
+    }
+    else {
+        ar & m_keyframes;
+    }
     if (version == 0) { // load an old keyframeCollection (version == 0)
         regularizeReferenceKeyframes(); // fill m_refKeyframeToKeyframes
     }
     else {
         ar & m_refKeyframeToKeyframes;
     }
+    if (version > 1) {
+        ar & m_descriptorIndex;
+        ar & m_descriptorIndexRanges;
+        ar & m_nextDescriptorIndexId;
+    }
+    if (Archive::is_loading::value) {
+        m_descriptorIndexRangeKeyframes.clear();
+        for (const auto& [id, range] : m_descriptorIndexRanges) {
+            m_descriptorIndexRangeKeyframes[range.first] = id;
+        }
+    }
 }
 
 IMPLEMENTSERIALIZE(KeyframeCollection);
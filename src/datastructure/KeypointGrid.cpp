@@ -0,0 +1,133 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "datastructure/KeypointGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace SolAR {
+namespace datastructure {
+
+namespace {
+// mean number of points per cell when the cell size is chosen from the density of the points
+constexpr float POINTS_PER_CELL = 4.f;
+// maximum number of cells per point, bounds the memory of grids with a small cell size
+constexpr float CELLS_PER_POINT = 4.f;
+}
+
+KeypointGrid::KeypointGrid(const std::vector<Point2Df> & points, float cellSize)
+{
+    build(static_cast<uint32_t>(points.size()), [&](uint32_t i) { return points[i].getX(); },
+          [&](uint32_t i) { return points[i].getY(); }, cellSize);
+}
+
+KeypointGrid::KeypointGrid(const std::vector<Keypoint> & keypoints, float cellSize)
+{
+    build(static_cast<uint32_t>(keypoints.size()), [&](uint32_t i) { return keypoints[i].getX(); },
+          [&](uint32_t i) { return keypoints[i].getY(); }, cellSize);
+}
+
+KeypointGrid::KeypointGrid(const KeypointSet & keypoints, float cellSize)
+{
+    const float * xs = keypoints.getX().data();
+    const float * ys = keypoints.getY().data();
+    build(keypoints.size(), [xs](uint32_t i) { return xs[i]; }, [ys](uint32_t i) { return ys[i]; }, cellSize);
+}
+
+template <typename X, typename Y>
+void KeypointGrid::build(uint32_t nbPoints, const X & x, const Y & y, float cellSize)
+{
+    if (nbPoints == 0)
+        return;
+    float maxX = x(0);
+    float maxY = y(0);
+    m_minX = maxX;
+    m_minY = maxY;
+    for (uint32_t i = 0; i < nbPoints; i++) {
+        m_minX = std::min(m_minX, x(i));
+        m_minY = std::min(m_minY, y(i));
+        maxX = std::max(maxX, x(i));
+        maxY = std::max(maxY, y(i));
+    }
+    float area = std::max(maxX - m_minX, 1.f) * std::max(maxY - m_minY, 1.f);
+    if (cellSize <= 0.f)
+        cellSize = std::sqrt(area * POINTS_PER_CELL / static_cast<float>(nbPoints));
+    m_cellSize = std::max({cellSize, std::sqrt(area / (CELLS_PER_POINT * static_cast<float>(nbPoints))), 1.f});
+    m_nbCols = static_cast<uint32_t>((maxX - m_minX) / m_cellSize) + 1;
+    m_nbRows = static_cast<uint32_t>((maxY - m_minY) / m_cellSize) + 1;
+
+    // counting sort of the points by cell
+    std::vector<uint32_t> cells(nbPoints);
+    m_cellStarts.assign(m_nbCols * m_nbRows + 1, 0);
+    for (uint32_t i = 0; i < nbPoints; i++) {
+        uint32_t col = std::min(static_cast<uint32_t>((x(i) - m_minX) / m_cellSize), m_nbCols - 1);
+        uint32_t row = std::min(static_cast<uint32_t>((y(i) - m_minY) / m_cellSize), m_nbRows - 1);
+        cells[i] = row * m_nbCols + col;
+        m_cellStarts[cells[i] + 1]++;
+    }
+    std::partial_sum(m_cellStarts.begin(), m_cellStarts.end(), m_cellStarts.begin());
+    std::vector<uint32_t> next(m_cellStarts.begin(), m_cellStarts.end() - 1);
+    m_indices.resize(nbPoints);
+    m_coordinates.resize(2 * nbPoints);
+    for (uint32_t i = 0; i < nbPoints; i++) {
+        uint32_t slot = next[cells[i]]++;
+        m_indices[slot] = i;
+        m_coordinates[2 * slot] = x(i);
+        m_coordinates[2 * slot + 1] = y(i);
+    }
+}
+
+void KeypointGrid::getPointsInRadius(const Point2Df & center, float radius, std::vector<uint32_t> & indices) const
+{
+    indices.clear();
+    if (radius < 0.f) {
+        indices.resize(m_indices.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        return;
+    }
+    if (m_indices.empty())
+        return;
+    // cells overlapping the bounding box of the circle
+    float colBegin = std::floor((center.getX() - radius - m_minX) / m_cellSize);
+    float colEnd = std::floor((center.getX() + radius - m_minX) / m_cellSize);
+    float rowBegin = std::floor((center.getY() - radius - m_minY) / m_cellSize);
+    float rowEnd = std::floor((center.getY() + radius - m_minY) / m_cellSize);
+    if (!(colEnd >= 0.f) || !(rowEnd >= 0.f) || !(colBegin < m_nbCols) || !(rowBegin < m_nbRows))
+        return;
+    uint32_t col0 = static_cast<uint32_t>(std::max(colBegin, 0.f));
+    uint32_t col1 = static_cast<uint32_t>(std::min(colEnd, static_cast<float>(m_nbCols - 1)));
+    uint32_t row0 = static_cast<uint32_t>(std::max(rowBegin, 0.f));
+    uint32_t row1 = static_cast<uint32_t>(std::min(rowEnd, static_cast<float>(m_nbRows - 1)));
+    float radius2 = radius * radius;
+    for (uint32_t row = row0; row <= row1; row++) {
+        // the cells of a row are contiguous
+        uint32_t begin = m_cellStarts[row * m_nbCols + col0];
+        uint32_t end = m_cellStarts[row * m_nbCols + col1 + 1];
+        for (uint32_t slot = begin; slot < end; slot++) {
+            float dx = m_coordinates[2 * slot] - center.getX();
+            float dy = m_coordinates[2 * slot + 1] - center.getY();
+            if (dx * dx + dy * dy <= radius2)
+                indices.push_back(m_indices[slot]);
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+}
+
+}
+}
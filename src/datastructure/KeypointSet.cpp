@@ -0,0 +1,143 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "datastructure/KeypointSet.h"
+
+BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::KeypointSet);
+
+namespace SolAR {
+namespace datastructure {
+
+KeypointSet::KeypointSet(uint32_t attributes) : m_attributes(attributes & ALL)
+{
+}
+
+KeypointSet::KeypointSet(const std::vector<Keypoint> & keypoints, uint32_t attributes) : m_attributes(attributes & ALL)
+{
+    reserve(static_cast<uint32_t>(keypoints.size()));
+    for (const auto & keypoint : keypoints)
+        append(keypoint);
+}
+
+void KeypointSet::reserve(uint32_t nbKeypoints)
+{
+    m_x.reserve(nbKeypoints);
+    m_y.reserve(nbKeypoints);
+    if (m_attributes & ID)
+        m_ids.reserve(nbKeypoints);
+    if (m_attributes & SIZE)
+        m_sizes.reserve(nbKeypoints);
+    if (m_attributes & ANGLE)
+        m_angles.reserve(nbKeypoints);
+    if (m_attributes & RESPONSE)
+        m_responses.reserve(nbKeypoints);
+    if (m_attributes & OCTAVE)
+        m_octaves.reserve(nbKeypoints);
+    if (m_attributes & CLASS_ID)
+        m_classIds.reserve(nbKeypoints);
+    if (m_attributes & RGB)
+        m_colors.reserve(3 * nbKeypoints);
+    if (m_attributes & DEPTH)
+        m_depths.reserve(nbKeypoints);
+}
+
+void KeypointSet::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_ids.clear();
+    m_sizes.clear();
+    m_angles.clear();
+    m_responses.clear();
+    m_octaves.clear();
+    m_classIds.clear();
+    m_colors.clear();
+    m_depths.clear();
+}
+
+void KeypointSet::append(const Keypoint & keypoint)
+{
+    m_x.push_back(keypoint.getX());
+    m_y.push_back(keypoint.getY());
+    if (m_attributes & ID)
+        m_ids.push_back(static_cast<uint32_t>(keypoint.getId()));
+    if (m_attributes & SIZE)
+        m_sizes.push_back(keypoint.getSize());
+    if (m_attributes & ANGLE)
+        m_angles.push_back(keypoint.getAngle());
+    if (m_attributes & RESPONSE)
+        m_responses.push_back(keypoint.getResponse());
+    if (m_attributes & OCTAVE)
+        m_octaves.push_back(keypoint.getOctave());
+    if (m_attributes & CLASS_ID)
+        m_classIds.push_back(keypoint.getClassId());
+    if (m_attributes & RGB)
+        m_colors.insert(m_colors.end(), keypoint.getRGB().data(), keypoint.getRGB().data() + 3);
+    if (m_attributes & DEPTH)
+        m_depths.push_back(keypoint.getDepth());
+}
+
+void KeypointSet::append(float x, float y)
+{
+    // no color, no size and an undefined angle, as getKeypoint returns for the attributes not stored
+    Keypoint keypoint(size(), x, y, 0.f, 0.f, 0.f, 0.f, -1.f);
+    append(keypoint);
+}
+
+Keypoint KeypointSet::getKeypoint(uint32_t i) const
+{
+    Keypoint keypoint((m_attributes & ID) ? m_ids[i] : i, m_x[i], m_y[i],
+                      (m_attributes & RGB) ? m_colors[3 * i] : 0.f,
+                      (m_attributes & RGB) ? m_colors[3 * i + 1] : 0.f,
+                      (m_attributes & RGB) ? m_colors[3 * i + 2] : 0.f,
+                      (m_attributes & SIZE) ? m_sizes[i] : 0.f,
+                      (m_attributes & ANGLE) ? m_angles[i] : -1.f,
+                      (m_attributes & RESPONSE) ? m_responses[i] : 0.f,
+                      (m_attributes & OCTAVE) ? m_octaves[i] : 0,
+                      (m_attributes & CLASS_ID) ? m_classIds[i] : -1);
+    if (m_attributes & DEPTH)
+        keypoint.setDepth(m_depths[i]);
+    return keypoint;
+}
+
+void KeypointSet::toKeypoints(std::vector<Keypoint> & keypoints) const
+{
+    keypoints.clear();
+    keypoints.reserve(size());
+    for (uint32_t i = 0; i < size(); i++)
+        keypoints.push_back(getKeypoint(i));
+}
+
+template<typename Archive>
+void KeypointSet::serialize(Archive &ar, const unsigned int /* version */) {
+    ar & m_attributes;
+    ar & m_x;
+    ar & m_y;
+    ar & m_ids;
+    ar & m_sizes;
+    ar & m_angles;
+    ar & m_responses;
+    ar & m_octaves;
+    ar & m_classIds;
+    ar & m_colors;
+    ar & m_depths;
+}
+
+IMPLEMENTSERIALIZE(KeypointSet);
+
+}
+}
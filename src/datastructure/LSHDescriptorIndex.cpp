@@ -0,0 +1,225 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "datastructure/LSHDescriptorIndex.h"
+#include "datastructure/DescriptorDistance.h"
+#include "core/Log.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <xpcf/core/helpers.h>
+
+BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::LSHDescriptorIndex);
+
+namespace xpcf = org::bcom::xpcf;
+
+namespace SolAR {
+namespace datastructure {
+
+LSHDescriptorIndex::LSHDescriptorIndex(DescriptorType descriptorType, uint32_t nbTables, uint32_t keySize, uint32_t probeLevel) :
+    DescriptorIndex(descriptorType), m_nbTables(std::max(nbTables, 1u)), m_keySize(std::min(std::max(keySize, 1u), 32u)),
+    m_probeLevel(std::min(probeLevel, 2u))
+{
+    if (getDescriptorDistanceType(descriptorType) != DescriptorDistanceType::HAMMING) {
+        LOG_ERROR("LSHDescriptorIndex: cannot index {} descriptors", toString(descriptorType));
+        m_descriptorType = DescriptorType::UNDEFINED;
+    }
+    // the hash functions of descriptors of runtime length are drawn at the first insertion
+    if (m_nbElements > 0)
+        initHashFunctions();
+}
+
+SRef<DescriptorIndex> LSHDescriptorIndex::clone() const
+{
+    SRef<LSHDescriptorIndex> index = xpcf::utils::make_shared<LSHDescriptorIndex>(*this);
+    // DescriptorBuffer copies share their memory
+    index->m_descriptors = DescriptorBuffer(m_descriptorType, m_dataType, m_nbElements, 0);
+    index->m_descriptors.append(m_descriptors);
+    return index;
+}
+
+void LSHDescriptorIndex::initHashFunctions()
+{
+    // keys of more bits than the descriptors are meaningless
+    m_keySize = std::min(m_keySize, m_nbElements * 8);
+    std::mt19937 generator(0);
+    std::vector<uint32_t> positions(m_nbElements * 8);
+    std::iota(positions.begin(), positions.end(), 0);
+    m_bitPositions.clear();
+    m_bitPositions.reserve(m_nbTables * m_keySize);
+    for (uint32_t t = 0; t < m_nbTables; t++) {
+        // distinct positions inside a key
+        for (uint32_t b = 0; b < m_keySize; b++) {
+            std::uniform_int_distribution<uint32_t> draw(b, static_cast<uint32_t>(positions.size()) - 1);
+            std::swap(positions[b], positions[draw(generator)]);
+            m_bitPositions.push_back(positions[b]);
+        }
+    }
+    m_descriptors = DescriptorBuffer(m_descriptorType, m_dataType, m_nbElements, 0);
+    m_tables.assign(m_nbTables, {});
+}
+
+uint32_t LSHDescriptorIndex::computeKey(const uint8_t * descriptor, uint32_t table) const
+{
+    const uint32_t * positions = &m_bitPositions[table * m_keySize];
+    uint32_t key = 0;
+    for (uint32_t b = 0; b < m_keySize; b++)
+        key |= static_cast<uint32_t>((descriptor[positions[b] >> 3] >> (positions[b] & 7)) & 1) << b;
+    return key;
+}
+
+void LSHDescriptorIndex::buildTables()
+{
+    m_tables.assign(m_nbTables, {});
+    m_rows.clear();
+    m_rows.reserve(m_ids.size());
+    for (uint32_t row = 0; row < m_descriptors.getNbDescriptors(); row++) {
+        const uint8_t * descriptor = static_cast<const uint8_t *>(m_descriptors.getDescriptor(row).data());
+        for (uint32_t t = 0; t < m_nbTables; t++)
+            m_tables[t][computeKey(descriptor, t)].push_back(row);
+        m_rows[m_ids[row]] = row;
+    }
+}
+
+void LSHDescriptorIndex::insert(uint32_t id, const DescriptorView & descriptor)
+{
+    if (m_bitPositions.empty())
+        initHashFunctions();
+    uint32_t row = m_descriptors.getNbDescriptors();
+    m_descriptors.append(descriptor);
+    m_ids.push_back(id);
+    m_rows[id] = row;
+    const uint8_t * data = static_cast<const uint8_t *>(descriptor.data());
+    for (uint32_t t = 0; t < m_nbTables; t++)
+        m_tables[t][computeKey(data, t)].push_back(row);
+}
+
+bool LSHDescriptorIndex::update(uint32_t id, const DescriptorView & descriptor)
+{
+    auto rowIt = m_rows.find(id);
+    if (rowIt == m_rows.end())
+        return false;
+    uint32_t row = rowIt->second;
+    const uint8_t * data = static_cast<const uint8_t *>(descriptor.data());
+    for (uint32_t t = 0; t < m_nbTables; t++) {
+        uint32_t previousKey = computeKey(static_cast<const uint8_t *>(m_descriptors.getDescriptor(row).data()), t);
+        uint32_t key = computeKey(data, t);
+        if (key == previousKey)
+            continue;
+        // move the row to the bucket of its new key
+        auto bucketIt = m_tables[t].find(previousKey);
+        if (bucketIt != m_tables[t].end()) {
+            std::vector<uint32_t> & bucket = bucketIt->second;
+            auto rowInBucket = std::find(bucket.begin(), bucket.end(), row);
+            if (rowInBucket != bucket.end())
+                bucket.erase(rowInBucket);
+            if (bucket.empty())
+                m_tables[t].erase(bucketIt);
+        }
+        m_tables[t][key].push_back(row);
+    }
+    // overwrite the row: scale 0 ignores its previous content
+    m_descriptors.accumulate(row, descriptor, 1.f, 0.f);
+    return true;
+}
+
+FrameworkReturnCode LSHDescriptorIndex::search(const DescriptorView & query, uint32_t k,
+                                               std::vector<std::pair<uint32_t, float>> & neighbours) const
+{
+    neighbours.clear();
+    if (!isCompatible(query))
+        return FrameworkReturnCode::_ERROR_;
+    if ((k == 0) || m_ids.empty())
+        return FrameworkReturnCode::_SUCCESS;
+    const uint8_t * q = static_cast<const uint8_t *>(query.data());
+    // candidates: rows in the buckets of the query keys and of the keys differing from them by up to probeLevel bits
+    thread_local std::vector<uint32_t> candidates;
+    candidates.clear();
+    auto probe = [&](uint32_t table, uint32_t key) {
+        auto bucketIt = m_tables[table].find(key);
+        if (bucketIt != m_tables[table].end())
+            candidates.insert(candidates.end(), bucketIt->second.begin(), bucketIt->second.end());
+    };
+    for (uint32_t t = 0; t < m_nbTables; t++) {
+        uint32_t key = computeKey(q, t);
+        probe(t, key);
+        for (uint32_t b1 = 0; (m_probeLevel > 0) && (b1 < m_keySize); b1++) {
+            probe(t, key ^ (1u << b1));
+            for (uint32_t b2 = b1 + 1; (m_probeLevel > 1) && (b2 < m_keySize); b2++)
+                probe(t, key ^ (1u << b1) ^ (1u << b2));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    // verification of the candidates with the Hamming distance, k best kept in a max heap
+    auto isCloser = [](const std::pair<uint32_t, float> & a, const std::pair<uint32_t, float> & b) { return a.second < b.second; };
+    uint32_t nbBytes = m_descriptors.getDescriptorByteSize();
+    for (const auto & row : candidates) {
+        if (!m_removed.empty() && isRemoved(m_ids[row]))
+            continue;
+        float distance = static_cast<float>(hammingDistance(q, static_cast<const uint8_t *>(m_descriptors.getDescriptor(row).data()), nbBytes));
+        if (neighbours.size() == k) {
+            if (distance >= neighbours.front().second)
+                continue;
+            std::pop_heap(neighbours.begin(), neighbours.end(), isCloser);
+            neighbours.pop_back();
+        }
+        neighbours.emplace_back(m_ids[row], distance);
+        std::push_heap(neighbours.begin(), neighbours.end(), isCloser);
+    }
+    std::sort_heap(neighbours.begin(), neighbours.end(), isCloser);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+void LSHDescriptorIndex::compact()
+{
+    if (m_removed.empty())
+        return;
+    std::vector<uint32_t> kept;
+    std::vector<uint32_t> keptIds;
+    for (uint32_t row = 0; row < m_ids.size(); row++) {
+        if (!isRemoved(m_ids[row])) {
+            kept.push_back(row);
+            keptIds.push_back(m_ids[row]);
+        }
+    }
+    DescriptorBuffer descriptors(m_descriptorType, m_dataType, m_nbElements, 0);
+    descriptors.append(m_descriptors, kept);
+    m_descriptors = descriptors;
+    m_ids.swap(keptIds);
+    m_removed.clear();
+    buildTables();
+}
+
+template<typename Archive>
+void LSHDescriptorIndex::serialize(Archive &ar, const unsigned int /* version */) {
+    ar & boost::serialization::base_object<DescriptorIndex>(*this);
+    ar & m_nbTables;
+    ar & m_keySize;
+    ar & m_probeLevel;
+    ar & m_bitPositions;
+    ar & m_descriptors;
+    ar & m_ids;
+    // the hash tables are not stored, they are rebuilt from the descriptors
+    if (Archive::is_loading::value)
+        buildTables();
+}
+
+IMPLEMENTSERIALIZE(LSHDescriptorIndex);
+
+}
+}
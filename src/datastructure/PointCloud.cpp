@@ -15,8 +15,11 @@
  */
 
 #include "datastructure/PointCloud.h"
+#include "datastructure/IVFDescriptorIndex.h"
+#include "datastructure/LSHDescriptorIndex.h"
 #include <xpcf/core/helpers.h>
 #include "core/Log.h"
+#include <algorithm>
 
 BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::PointCloud);
 
@@ -29,6 +32,7 @@ FrameworkReturnCode PointCloud::addPoint(const SRef<CloudPoint> point)
 {
 	point->setId(m_id);
 	m_pointCloud[m_id] = point;
+	indexPoint(point);
 	m_id++;
 	return FrameworkReturnCode::_SUCCESS;
 }
@@ -38,6 +42,7 @@ FrameworkReturnCode PointCloud::addPoints(const std::vector<SRef<CloudPoint>>& p
 	for (auto &it : points) {
 		it->setId(m_id);
 		m_pointCloud[m_id] = it;
+		indexPoint(it);
 		m_id++;
 	}
 	return FrameworkReturnCode::_SUCCESS;
@@ -48,6 +53,7 @@ FrameworkReturnCode PointCloud::addPoint(const CloudPoint & point)
 	SRef<CloudPoint> point_ptr = xpcf::utils::make_shared<CloudPoint>(point);
 	point_ptr->setId(m_id);
 	m_pointCloud[m_id] = point_ptr;
+	indexPoint(point_ptr);
 	m_id++;
 	return FrameworkReturnCode::_SUCCESS;
 }
@@ -61,6 +67,7 @@ FrameworkReturnCode PointCloud::addPoints(const std::vector<CloudPoint>& points,
 		SRef<CloudPoint> point_ptr = xpcf::utils::make_shared<CloudPoint>(it);
 		point_ptr->setId(m_id);
 		m_pointCloud[m_id] = point_ptr;
+		indexPoint(point_ptr);
 		m_id++;
         }
 	}
@@ -69,7 +76,12 @@ FrameworkReturnCode PointCloud::addPoints(const std::vector<CloudPoint>& points,
         for (auto &it : points)
         {
         SRef<CloudPoint> point_ptr = xpcf::utils::make_shared<CloudPoint>(it);
+        // a compressed point keeps its code
+        if (!point_ptr->isDescriptorCompressed())
+            removeCode(point_ptr->getId());
         m_pointCloud[point_ptr->getId()] = point_ptr;
+        // the descriptor of a replaced point is overwritten in place in the index
+        indexPoint(point_ptr);
         }
     }
 	return FrameworkReturnCode::_SUCCESS;
@@ -113,6 +125,9 @@ FrameworkReturnCode PointCloud::suppressPoint(const uint32_t id)
 	auto pointIt = m_pointCloud.find(id);
 	if (pointIt != m_pointCloud.end()) {
 		m_pointCloud.erase(pointIt);
+		if (m_descriptorIndex)
+			m_descriptorIndex->remove(id);
+		removeCode(id);
 		return FrameworkReturnCode::_SUCCESS;
 	}
 	else {
@@ -130,6 +145,9 @@ FrameworkReturnCode PointCloud::suppressPoints(const std::vector<uint32_t>& ids)
 			return FrameworkReturnCode::_ERROR_;
 		}
 		m_pointCloud.erase(pointIt);
+		if (m_descriptorIndex)
+			m_descriptorIndex->remove(it);
+		removeCode(it);
 	}
 	return FrameworkReturnCode::_SUCCESS;
 }
@@ -145,6 +163,116 @@ FrameworkReturnCode PointCloud::setDescriptorType(const DescriptorType & type)
 	return FrameworkReturnCode::_SUCCESS;
 }
 
+const SRef<ProductQuantizer> & PointCloud::getQuantizer() const
+{
+	return m_quantizer;
+}
+
+void PointCloud::setQuantizer(const SRef<ProductQuantizer> quantizer)
+{
+	m_quantizer = quantizer;
+	m_codes.clear();
+	m_hasCode.clear();
+}
+
+uint32_t PointCloud::getCodeSize() const
+{
+	return m_quantizer ? m_quantizer->getNbSubQuantizers() : 0;
+}
+
+bool PointCloud::hasCode(const uint32_t id) const
+{
+	return (id < m_hasCode.size()) && m_hasCode[id];
+}
+
+const uint8_t * PointCloud::getCode(const uint32_t id) const
+{
+	if (!hasCode(id))
+		return nullptr;
+	return m_codes.data() + static_cast<size_t>(id) * getCodeSize();
+}
+
+FrameworkReturnCode PointCloud::getCodes(const std::vector<uint32_t> & ids, DescriptorBuffer & codes) const
+{
+	uint32_t codeSize = getCodeSize();
+	if (codeSize == 0) {
+		LOG_ERROR("The descriptors of the point cloud are not compressed");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	codes.reshape(DescriptorType::PQ, DescriptorDataType::TYPE_8U, codeSize, static_cast<uint32_t>(ids.size()));
+	uint8_t * code = static_cast<uint8_t *>(codes.data());
+	for (const auto & id : ids) {
+		if (!hasCode(id)) {
+			LOG_DEBUG("Cannot find the code of cloud point {}", id);
+			return FrameworkReturnCode::_ERROR_;
+		}
+		std::copy_n(m_codes.data() + static_cast<size_t>(id) * codeSize, codeSize, code);
+		code += codes.getDescriptorStride();
+	}
+	return FrameworkReturnCode::_SUCCESS;
+}
+
+const std::vector<uint8_t> & PointCloud::getCodes() const
+{
+	return m_codes;
+}
+
+FrameworkReturnCode PointCloud::setCode(const uint32_t id, const uint8_t * code)
+{
+	uint32_t codeSize = getCodeSize();
+	if (codeSize == 0) {
+		LOG_ERROR("The descriptors of the point cloud are not compressed");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	if (id >= m_hasCode.size()) {
+		// grow geometrically, the ids of the points are increasing
+		size_t capacity = std::max(static_cast<size_t>(id) + 1, m_hasCode.size() + m_hasCode.size() / 2);
+		m_hasCode.resize(capacity, false);
+		m_codes.resize(capacity * codeSize);
+	}
+	std::copy_n(code, codeSize, m_codes.data() + static_cast<size_t>(id) * codeSize);
+	m_hasCode[id] = true;
+	return FrameworkReturnCode::_SUCCESS;
+}
+
+void PointCloud::removeCode(const uint32_t id)
+{
+	if (id < m_hasCode.size())
+		m_hasCode[id] = false;
+}
+
+const SRef<DescriptorIndex> & PointCloud::getDescriptorIndex() const
+{
+	return m_descriptorIndex;
+}
+
+FrameworkReturnCode PointCloud::setDescriptorIndex(const SRef<DescriptorIndex> index)
+{
+	if (index && (index->getNbDescriptors() > 0)) {
+		LOG_ERROR("The descriptor index of a point cloud must be empty");
+		return FrameworkReturnCode::_ERROR_;
+	}
+	m_descriptorIndex = index;
+	for (const auto& pointIt : m_pointCloud)
+		indexPoint(pointIt.second);
+	return FrameworkReturnCode::_SUCCESS;
+}
+
+void PointCloud::indexPoint(const SRef<CloudPoint> & point)
+{
+	if (!m_descriptorIndex)
+		return;
+	if (!point->getDescriptor() || (point->getDescriptor()->getNbDescriptors() == 0)) {
+		// a replaced point without descriptor must not be found with its previous one
+		m_descriptorIndex->remove(point->getId());
+		return;
+	}
+	if (m_descriptorIndex->add(point->getId(), point->getDescriptor()->getDescriptor(0)) != FrameworkReturnCode::_SUCCESS) {
+		LOG_DEBUG("Cannot index the descriptor of cloud point {}", point->getId());
+		m_descriptorIndex->remove(point->getId());
+	}
+}
+
 bool PointCloud::isExistPoint(const uint32_t id) const
 {
 	if (m_pointCloud.find(id) != m_pointCloud.end())
@@ -159,11 +287,17 @@ int PointCloud::getNbPoints() const
 }
 
 template <typename Archive>
-void PointCloud::serialize(Archive &ar, const unsigned int /* version */)
+void PointCloud::serialize(Archive &ar, const unsigned int version)
 {
 	ar & m_id;
 	ar & m_descriptorType;
 	ar & m_pointCloud;
+	if (version > 0) {
+		ar & m_quantizer;
+		ar & m_descriptorIndex;
+		ar & m_codes;
+		ar & m_hasCode;
+	}
 }
 
 IMPLEMENTSERIALIZE(PointCloud);
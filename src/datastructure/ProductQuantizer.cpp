@@ -0,0 +1,268 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "datastructure/ProductQuantizer.h"
+#include "datastructure/DescriptorDistance.h"
+#include "datastructure/PointCloud.h"
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <xpcf/core/helpers.h>
+
+BOOST_CLASS_EXPORT_IMPLEMENT(SolAR::datastructure::ProductQuantizer);
+
+namespace xpcf = org::bcom::xpcf;
+
+namespace SolAR {
+namespace datastructure {
+
+namespace {
+
+// Return a pointer on the float elements of a descriptor, converted in buffer if needed
+inline const float * toFloat(const void * descriptor, DescriptorDataType dataType, uint32_t nbElements, std::vector<float> & buffer)
+{
+    if (dataType == DescriptorDataType::TYPE_32F)
+        return static_cast<const float *>(descriptor);
+    buffer.resize(nbElements);
+    convertDescriptorData(static_cast<const uint8_t *>(descriptor), buffer.data(), nbElements);
+    return buffer.data();
+}
+
+}
+
+ProductQuantizer::ProductQuantizer(DescriptorType descriptorType, uint32_t nbSubQuantizers, uint32_t nbCentroids)
+{
+    DescriptorProperties properties = getDescriptorProperties(descriptorType);
+    if ((properties.distanceType != DescriptorDistanceType::L2) || (properties.nbElements == 0)) {
+        LOG_ERROR("ProductQuantizer: cannot quantize {} descriptors", toString(descriptorType));
+        return;
+    }
+    if ((nbSubQuantizers == 0) || (properties.nbElements % nbSubQuantizers != 0)) {
+        LOG_ERROR("ProductQuantizer: the number of sub-quantizers ({}) must divide the descriptor size ({})", nbSubQuantizers, properties.nbElements);
+        return;
+    }
+    if ((nbCentroids == 0) || (nbCentroids > 256)) {
+        LOG_ERROR("ProductQuantizer: the number of centroids ({}) must be in [1, 256]", nbCentroids);
+        return;
+    }
+    m_descriptorType = descriptorType;
+    m_dataType = properties.dataType;
+    m_nbElements = properties.nbElements;
+    m_nbSubQuantizers = nbSubQuantizers;
+    m_nbCentroids = nbCentroids;
+    m_subDimension = m_nbElements / m_nbSubQuantizers;
+}
+
+FrameworkReturnCode ProductQuantizer::train(const DescriptorBuffer & descriptors, uint32_t nbIterations)
+{
+    uint32_t nbDescriptors = descriptors.getNbDescriptors();
+    if ((m_nbSubQuantizers == 0) || (descriptors.getDescriptorType() != m_descriptorType)
+            || (descriptors.getNbElements() != m_nbElements)) {
+        LOG_ERROR("ProductQuantizer: training descriptors do not match the quantizer");
+        return FrameworkReturnCode::_ERROR_;
+    }
+    if (nbDescriptors < m_nbCentroids) {
+        LOG_ERROR("ProductQuantizer: {} training descriptors, at least {} are required", nbDescriptors, m_nbCentroids);
+        return FrameworkReturnCode::_ERROR_;
+    }
+    DescriptorBuffer data;
+    descriptors.convertTo(DescriptorDataType::TYPE_32F, data);
+    const float * X = static_cast<const float *>(data.data());
+
+    std::vector<float> centroids(static_cast<size_t>(m_nbSubQuantizers) * m_nbCentroids * m_subDimension);
+    std::vector<float> subVectors(static_cast<size_t>(nbDescriptors) * m_subDimension);
+    std::vector<float> subCentroids;
+    for (uint32_t m = 0; m < m_nbSubQuantizers; m++) {
+        for (uint32_t i = 0; i < nbDescriptors; i++)
+            std::memcpy(&subVectors[static_cast<size_t>(i) * m_subDimension],
+                        X + static_cast<size_t>(i) * m_nbElements + m * m_subDimension, m_subDimension * sizeof(float));
+        computeKMeans(subVectors.data(), nbDescriptors, m_subDimension, m_nbCentroids, nbIterations, subCentroids);
+        std::copy(subCentroids.begin(), subCentroids.end(), centroids.begin() + static_cast<size_t>(m) * m_nbCentroids * m_subDimension);
+    }
+    m_centroids.swap(centroids);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode ProductQuantizer::train(const SRef<PointCloud> pointCloud, uint32_t maxTrainingDescriptors, uint32_t nbIterations)
+{
+    if ((pointCloud == nullptr) || (maxTrainingDescriptors == 0))
+        return FrameworkReturnCode::_ERROR_;
+    std::vector<SRef<CloudPoint>> points;
+    pointCloud->getAllPoints(points);
+    std::vector<SRef<DescriptorBuffer>> descriptors;
+    for (const auto & point : points) {
+        const SRef<DescriptorBuffer> & descriptor = point->getDescriptor();
+        if ((descriptor != nullptr) && (descriptor->getDescriptorType() == m_descriptorType)
+                && (descriptor->getNbElements() == m_nbElements) && (descriptor->getNbDescriptors() > 0))
+            descriptors.push_back(descriptor);
+    }
+    // regular sampling of the point cloud
+    uint32_t step = static_cast<uint32_t>((descriptors.size() + maxTrainingDescriptors - 1) / maxTrainingDescriptors);
+    DescriptorBuffer trainingDescriptors(m_descriptorType, m_dataType, m_nbElements, 0);
+    trainingDescriptors.reserve(static_cast<uint32_t>(descriptors.size() / std::max(step, 1u) + 1));
+    for (size_t i = 0; i < descriptors.size(); i += std::max(step, 1u)) {
+        DescriptorView descriptor = descriptors[i]->getDescriptor(0);
+        if (descriptor.dataType() == m_dataType)
+            trainingDescriptors.append(descriptor);
+    }
+    return train(trainingDescriptors, nbIterations);
+}
+
+bool ProductQuantizer::isTrained() const
+{
+    return !m_centroids.empty();
+}
+
+bool ProductQuantizer::isCompatible(const DescriptorView & descriptor) const
+{
+    return isTrained() && (descriptor.type() == m_descriptorType) && (descriptor.length() == m_nbElements);
+}
+
+void ProductQuantizer::encode(const float * descriptor, uint8_t * code) const
+{
+    for (uint32_t m = 0; m < m_nbSubQuantizers; m++) {
+        float distance;
+        code[m] = static_cast<uint8_t>(findNearestCentroid(descriptor + m * m_subDimension,
+                                                           &m_centroids[static_cast<size_t>(m) * m_nbCentroids * m_subDimension],
+                                                           m_nbCentroids, m_subDimension, distance));
+    }
+}
+
+FrameworkReturnCode ProductQuantizer::encode(const DescriptorBuffer & descriptors, DescriptorBuffer & codes) const
+{
+    if (!isTrained() || (descriptors.getDescriptorType() != m_descriptorType) || (descriptors.getNbElements() != m_nbElements))
+        return FrameworkReturnCode::_ERROR_;
+    if (&codes == &descriptors)
+        return FrameworkReturnCode::_ERROR_;
+    uint32_t nbDescriptors = descriptors.getNbDescriptors();
+    codes.reshape(DescriptorType::PQ, DescriptorDataType::TYPE_8U, m_nbSubQuantizers, nbDescriptors);
+    uint32_t codeStride = codes.getDescriptorStride();
+    uint8_t * code = static_cast<uint8_t *>(codes.data());
+    std::vector<float> row;
+    for (uint32_t i = 0; i < nbDescriptors; i++) {
+        DescriptorView descriptor = descriptors.getDescriptor(i);
+        encode(toFloat(descriptor.data(), descriptor.dataType(), m_nbElements, row), code + static_cast<size_t>(i) * codeStride);
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode ProductQuantizer::encode(const SRef<PointCloud> pointCloud) const
+{
+    if ((pointCloud == nullptr) || !isTrained())
+        return FrameworkReturnCode::_ERROR_;
+    pointCloud->setQuantizer(xpcf::utils::make_shared<ProductQuantizer>(*this));
+    std::vector<SRef<CloudPoint>> points;
+    pointCloud->getAllPoints(points);
+    std::vector<uint8_t> code(m_nbSubQuantizers);
+    std::vector<float> row;
+    for (const auto & point : points) {
+        const SRef<DescriptorBuffer> & descriptor = point->getDescriptor();
+        if ((descriptor == nullptr) || (descriptor->getDescriptorType() != m_descriptorType)
+                || (descriptor->getNbElements() != m_nbElements) || (descriptor->getNbDescriptors() == 0))
+            continue;
+        DescriptorView view = descriptor->getDescriptor(0);
+        encode(toFloat(view.data(), view.dataType(), m_nbElements, row), code.data());
+        // the code is stored in the contiguous code buffer of the point cloud, the point does not keep its own buffer
+        pointCloud->setCode(point->getId(), code.data());
+        point->releaseDescriptor();
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode ProductQuantizer::decode(const DescriptorBuffer & codes, DescriptorBuffer & descriptors) const
+{
+    if (!isTrained() || (codes.getDescriptorType() != DescriptorType::PQ) || (codes.getNbElements() != m_nbSubQuantizers))
+        return FrameworkReturnCode::_ERROR_;
+    if (&codes == &descriptors)
+        return FrameworkReturnCode::_ERROR_;
+    uint32_t nbDescriptors = codes.getNbDescriptors();
+    uint32_t codeStride = codes.getDescriptorStride();
+    const uint8_t * code = static_cast<const uint8_t *>(codes.data());
+    descriptors.reshape(m_descriptorType, m_dataType, m_nbElements, nbDescriptors);
+    std::vector<float> row(m_nbElements);
+    for (uint32_t i = 0; i < nbDescriptors; i++) {
+        for (uint32_t m = 0; m < m_nbSubQuantizers; m++) {
+            const float * centroid = &m_centroids[(static_cast<size_t>(m) * m_nbCentroids + code[i * codeStride + m]) * m_subDimension];
+            std::memcpy(row.data() + m * m_subDimension, centroid, m_subDimension * sizeof(float));
+        }
+        uint8_t * descriptor = static_cast<uint8_t *>(descriptors.data()) + i * descriptors.getDescriptorStride();
+        if (m_dataType == DescriptorDataType::TYPE_8U)
+            convertDescriptorData(row.data(), descriptor, m_nbElements);
+        else
+            std::memcpy(descriptor, row.data(), m_nbElements * sizeof(float));
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+FrameworkReturnCode ProductQuantizer::computeDistanceTable(const DescriptorView & query, std::vector<float> & table) const
+{
+    if (!isCompatible(query))
+        return FrameworkReturnCode::_ERROR_;
+    std::vector<float> row;
+    const float * q = toFloat(query.data(), query.dataType(), m_nbElements, row);
+    table.resize(static_cast<size_t>(m_nbSubQuantizers) * m_nbCentroids);
+    for (uint32_t m = 0; m < m_nbSubQuantizers; m++) {
+        const float * C = &m_centroids[static_cast<size_t>(m) * m_nbCentroids * m_subDimension];
+        for (uint32_t k = 0; k < m_nbCentroids; k++)
+            table[m * m_nbCentroids + k] = l2SquaredDistance(q + m * m_subDimension, C + k * m_subDimension, m_subDimension);
+    }
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+float ProductQuantizer::asymmetricDistance(const std::vector<float> & table, const uint8_t * code) const
+{
+    const float * t = table.data();
+    float distance = 0.f;
+    for (uint32_t m = 0; m < m_nbSubQuantizers; m++, t += m_nbCentroids)
+        distance += t[code[m]];
+    return std::sqrt(distance);
+}
+
+FrameworkReturnCode ProductQuantizer::computeDistances(const DescriptorView & query, const DescriptorBuffer & codes, std::vector<float> & distances) const
+{
+    if ((codes.getDescriptorType() != DescriptorType::PQ) || (codes.getNbElements() != m_nbSubQuantizers))
+        return FrameworkReturnCode::_ERROR_;
+    // the lookup table is reused between the calls of a thread
+    thread_local std::vector<float> table;
+    if (computeDistanceTable(query, table) != FrameworkReturnCode::_SUCCESS)
+        return FrameworkReturnCode::_ERROR_;
+    uint32_t nbCodes = codes.getNbDescriptors();
+    uint32_t codeStride = codes.getDescriptorStride();
+    const uint8_t * code = static_cast<const uint8_t *>(codes.data());
+    distances.resize(nbCodes);
+    for (uint32_t i = 0; i < nbCodes; i++)
+        distances[i] = asymmetricDistance(table, code + i * codeStride);
+    return FrameworkReturnCode::_SUCCESS;
+}
+
+template<typename Archive>
+void ProductQuantizer::serialize(Archive &ar, const unsigned int /* version */) {
+    ar & m_descriptorType;
+    ar & m_dataType;
+    ar & m_nbElements;
+    ar & m_nbSubQuantizers;
+    ar & m_nbCentroids;
+    ar & m_subDimension;
+    ar & m_centroids;
+}
+
+IMPLEMENTSERIALIZE(ProductQuantizer);
+
+}
+}
@@ -0,0 +1,177 @@
+/**
+ * @copyright Copyright (c) 2017 B-com http://www.b-com.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "datastructure/UndistortionMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SolAR {
+namespace datastructure {
+
+namespace {
+// iterations of the inversion of the distortion model, and convergence threshold in normalized coordinates
+constexpr uint32_t MAX_ITERATIONS = 20;
+constexpr double CONVERGENCE = 1e-12;
+}
+
+UndistortionMap::UndistortionMap(const CameraParameters & camParams, float step) :
+    m_intrinsic(camParams.intrinsic), m_distortion(camParams.distortion), m_resolution(camParams.resolution),
+    m_step(std::max(step, 1.f))
+{
+    m_isIdentity = m_distortion.isZero(0.f);
+    if (m_isIdentity)
+        return;
+    // the grid covers the image with one cell of margin on each side
+    m_minX = -m_step;
+    m_minY = -m_step;
+    m_nbCols = static_cast<uint32_t>(std::ceil(static_cast<float>(m_resolution.width) / m_step)) + 3;
+    m_nbRows = static_cast<uint32_t>(std::ceil(static_cast<float>(m_resolution.height) / m_step)) + 3;
+    m_nodesX.resize(m_nbCols * m_nbRows);
+    m_nodesY.resize(m_nbCols * m_nbRows);
+    for (uint32_t row = 0; row < m_nbRows; row++)
+        for (uint32_t col = 0; col < m_nbCols; col++) {
+            double x, y;
+            solve(m_minX + col * m_step, m_minY + row * m_step, x, y);
+            m_nodesX[row * m_nbCols + col] = static_cast<float>(x);
+            m_nodesY[row * m_nbCols + col] = static_cast<float>(y);
+        }
+    // the interpolation error is the largest at the center of the cells
+    for (uint32_t row = 0; row + 1 < m_nbRows; row++)
+        for (uint32_t col = 0; col + 1 < m_nbCols; col++) {
+            float centerX = m_minX + (col + 0.5f) * m_step;
+            float centerY = m_minY + (row + 0.5f) * m_step;
+            double x, y;
+            float interpolatedX, interpolatedY;
+            solve(centerX, centerY, x, y);
+            interpolate(centerX, centerY, interpolatedX, interpolatedY);
+            m_maxError = std::max(m_maxError, static_cast<float>(std::hypot(interpolatedX - x, interpolatedY - y)));
+        }
+}
+
+bool UndistortionMap::isBuiltFor(const CameraParameters & camParams) const
+{
+    return (camParams.resolution.width == m_resolution.width) && (camParams.resolution.height == m_resolution.height) &&
+           (camParams.intrinsic == m_intrinsic) && (camParams.distortion == m_distortion);
+}
+
+void UndistortionMap::solve(double x, double y, double & undistortedX, double & undistortedY) const
+{
+    double fx = m_intrinsic(0, 0);
+    double fy = m_intrinsic(1, 1);
+    double skew = m_intrinsic(0, 1);
+    double cx = m_intrinsic(0, 2);
+    double cy = m_intrinsic(1, 2);
+    double k1 = m_distortion(0), k2 = m_distortion(1), p1 = m_distortion(2), p2 = m_distortion(3), k3 = m_distortion(4);
+    // distorted normalized coordinates
+    double yd = (y - cy) / fy;
+    double xd = (x - cx - skew * yd) / fx;
+    double xu = xd;
+    double yu = yd;
+    for (uint32_t i = 0; i < MAX_ITERATIONS; i++) {
+        double r2 = xu * xu + yu * yu;
+        double icdist = 1. / (1. + ((k3 * r2 + k2) * r2 + k1) * r2);
+        double deltaX = 2. * p1 * xu * yu + p2 * (r2 + 2. * xu * xu);
+        double deltaY = p1 * (r2 + 2. * yu * yu) + 2. * p2 * xu * yu;
+        double nextX = (xd - deltaX) * icdist;
+        double nextY = (yd - deltaY) * icdist;
+        bool converged = std::abs(nextX - xu) + std::abs(nextY - yu) < CONVERGENCE;
+        xu = nextX;
+        yu = nextY;
+        if (converged)
+            break;
+    }
+    undistortedX = fx * xu + skew * yu + cx;
+    undistortedY = fy * yu + cy;
+}
+
+void UndistortionMap::interpolate(float x, float y, float & undistortedX, float & undistortedY) const
+{
+    float gridX = (x - m_minX) / m_step;
+    float gridY = (y - m_minY) / m_step;
+    if (!(gridX >= 0.f) || !(gridY >= 0.f) || !(gridX < m_nbCols - 1) || !(gridY < m_nbRows - 1)) {
+        double solvedX, solvedY;
+        solve(x, y, solvedX, solvedY);
+        undistortedX = static_cast<float>(solvedX);
+        undistortedY = static_cast<float>(solvedY);
+        return;
+    }
+    uint32_t col = static_cast<uint32_t>(gridX);
+    uint32_t row = static_cast<uint32_t>(gridY);
+    float wx = gridX - col;
+    float wy = gridY - row;
+    uint32_t node = row * m_nbCols + col;
+    const float * nodesX = m_nodesX.data() + node;
+    const float * nodesY = m_nodesY.data() + node;
+    float topX = nodesX[0] + wx * (nodesX[1] - nodesX[0]);
+    float bottomX = nodesX[m_nbCols] + wx * (nodesX[m_nbCols + 1] - nodesX[m_nbCols]);
+    float topY = nodesY[0] + wx * (nodesY[1] - nodesY[0]);
+    float bottomY = nodesY[m_nbCols] + wx * (nodesY[m_nbCols + 1] - nodesY[m_nbCols]);
+    undistortedX = topX + wy * (bottomX - topX);
+    undistortedY = topY + wy * (bottomY - topY);
+}
+
+Point2Df UndistortionMap::undistort(const Point2Df & point) const
+{
+    if (m_isIdentity)
+        return point;
+    float x, y;
+    interpolate(point.getX(), point.getY(), x, y);
+    return Point2Df(x, y);
+}
+
+void UndistortionMap::undistort(const float * x, const float * y, uint32_t nbPoints, float * undistortedX, float * undistortedY) const
+{
+    if (m_isIdentity) {
+        std::copy(x, x + nbPoints, undistortedX);
+        std::copy(y, y + nbPoints, undistortedY);
+        return;
+    }
+    for (uint32_t i = 0; i < nbPoints; i++) {
+        float pointX = x[i];
+        float pointY = y[i];
+        interpolate(pointX, pointY, undistortedX[i], undistortedY[i]);
+    }
+}
+
+void UndistortionMap::undistort(const std::vector<Point2Df> & points, std::vector<Point2Df> & undistortedPoints) const
+{
+    undistortedPoints.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        undistortedPoints[i] = undistort(points[i]);
+}
+
+void UndistortionMap::undistort(const std::vector<Keypoint> & keypoints, std::vector<Keypoint> & undistortedKeypoints) const
+{
+    undistortedKeypoints = keypoints;
+    for (auto & keypoint : undistortedKeypoints) {
+        Point2Df point = undistort(Point2Df(keypoint.getX(), keypoint.getY()));
+        keypoint.setX(point.getX());
+        keypoint.setY(point.getY());
+    }
+}
+
+void UndistortionMap::undistort(const KeypointSet & keypoints, KeypointSet & undistortedKeypoints) const
+{
+    if (&undistortedKeypoints != &keypoints)
+        undistortedKeypoints = keypoints;
+    undistort(undistortedKeypoints.getXData(), undistortedKeypoints.getYData(), undistortedKeypoints.size(),
+              undistortedKeypoints.getXData(), undistortedKeypoints.getYData());
+}
+
+}
+}